@@ -0,0 +1,214 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class PageOwner;
+
+// Checkpoint file format (version 1)
+//
+//   CheckpointHeader
+//   sections: CheckpointSection header + payload, padded to 8 bytes
+//
+// A checkpoint holds the whole simulator state after `records` trace
+// records: frame allocator, reverse map and replacement engine, shared
+// frames, swap slots, CPU TLBs, every task's page table, swapped-out pages
+// and TLB, and the trace reader's position. Each component writes its own
+// sections with save() and reads them back with restore(), in the same order.
+//
+// The file has no pointers, so it can be mapped at any address: the owner
+// of a frame is stored as its task's number (order of creation), or as
+// CHECKPOINT_OWNER_SHARED for the SharedFrames table. ARC's ghost entries
+// name the owner by PageOwner::getOwnerIndex() instead. Values are
+// fixed-width and little-endian; arrays are stored as a count and the raw
+// elements, 8-byte aligned, and are copied straight out of the mapping on
+// restore.
+
+#define CHECKPOINT_MAGIC 0x4B434D56u   // "VMCK"
+#define CHECKPOINT_VERSION 7
+
+#define CHECKPOINT_OWNER_NONE 0xFFFFFFFFu
+#define CHECKPOINT_OWNER_SHARED 0xFFFFFFFEu
+
+struct CheckpointHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t records;       // trace records replayed before the checkpoint
+};
+
+struct CheckpointSection {
+    uint32_t tag;           // four characters, e.g. "MMGR"
+    uint32_t checksum;      // checkpointChecksum() of the payload
+    uint64_t bytes;         // payload, excluding padding
+};
+
+// Builds a section tag from four characters
+inline uint32_t checkpointTag(const char (&name)[5]) {
+    return static_cast<uint32_t>(static_cast<uint8_t>(name[0])) |
+           static_cast<uint32_t>(static_cast<uint8_t>(name[1])) << 8 |
+           static_cast<uint32_t>(static_cast<uint8_t>(name[2])) << 16 |
+           static_cast<uint32_t>(static_cast<uint8_t>(name[3])) << 24;
+}
+
+// FNV-1a over a section payload: a damaged file is rejected before any of
+// its frame links or page-table entries are used
+uint32_t checkpointChecksum(const char* data, size_t bytes);
+
+// Writes a checkpoint file section by section
+// Sections are built in memory and written whole by endSection().
+class CheckpointWriter {
+private:
+    FILE* file;
+    bool failed;
+    std::vector<char> section;
+    uint32_t section_tag;
+    std::unordered_map<const PageOwner*, uint32_t> owner_ids;
+
+    void write(const void* data, size_t bytes);
+    void align();
+
+public:
+    CheckpointWriter() : file(nullptr), failed(false), section_tag(0) {}
+    ~CheckpointWriter();
+
+    CheckpointWriter(const CheckpointWriter&) = delete;
+    void operator=(const CheckpointWriter&) = delete;
+
+    // Creates the file and writes the header; prints an error and returns
+    // false on failure
+    bool open(const std::string& filename, uint64_t records);
+
+    // Flushes and closes the file; returns false if any write failed
+    bool close();
+
+    // Page owners are written as ids: register every owner before saving
+    void setOwnerId(const PageOwner* owner, uint32_t id) { owner_ids[owner] = id; }
+    uint32_t ownerId(const PageOwner* owner) const;
+
+    void beginSection(const char (&tag)[5]);
+    void endSection();
+
+    template <class T>
+    void put(const T& value) {
+        size_t at = section.size();
+        section.resize(at + sizeof(T));
+        memcpy(&section[at], &value, sizeof(T));
+    }
+
+    template <class T>
+    void putArray(const T* values, size_t count) {
+        put<uint64_t>(count);
+        align();
+        size_t at = section.size();
+        section.resize(at + count * sizeof(T));
+        if (count > 0) memcpy(&section[at], values, count * sizeof(T));
+        align();
+    }
+
+    template <class T>
+    void putVector(const std::vector<T>& values) {
+        putArray(values.empty() ? nullptr : &values[0], values.size());
+    }
+
+    void putString(const std::string& text) { putArray(text.data(), text.size()); }
+};
+
+// Reads a checkpoint file through a read-only mapping
+// Every read is bounds-checked: past the end of its section a read returns
+// a value-initialized T and marks the reader as failed, and so does a section with an
+// unexpected tag, so callers check ok() once after restoring.
+class CheckpointReader {
+private:
+    const char* data;
+    size_t size;
+    bool mapped;
+    const char* cursor;
+    const char* section_end;
+    bool failed;
+    uint64_t records;
+    std::vector<PageOwner*> owners;
+    PageOwner* shared_owner;
+
+    const char* take(size_t bytes);
+    void align();
+
+public:
+    CheckpointReader();
+    ~CheckpointReader();
+
+    CheckpointReader(const CheckpointReader&) = delete;
+    void operator=(const CheckpointReader&) = delete;
+
+    // Maps the file and checks the header; prints an error and returns
+    // false on failure
+    bool open(const std::string& filename);
+    void close();
+
+    uint64_t getRecords() const { return records; }
+
+    // Ids back to owners: register every owner before restoring
+    void setOwner(uint32_t id, PageOwner* owner);
+    void setSharedOwner(PageOwner* owner) { shared_owner = owner; }
+    PageOwner* owner(uint32_t id);
+
+    // Moves to the next section; fails unless it has the given tag and an
+    // intact payload
+    bool beginSection(const char (&tag)[5]);
+    void endSection();
+
+    void fail() { failed = true; }
+    bool ok() const { return !failed; }
+
+    template <class T>
+    T get() {
+        T value = T();
+        const char* p = take(sizeof(T));
+        if (p) memcpy(&value, p, sizeof(T));
+        return value;
+    }
+
+    // Array elements in place in the mapping (nullptr if count is 0 or the
+    // read failed)
+    template <class T>
+    const T* getArray(size_t& count) {
+        count = static_cast<size_t>(get<uint64_t>());
+        align();
+        const char* p = count > 0 && count <= size / sizeof(T) ? take(count * sizeof(T)) : nullptr;
+        if (p == nullptr) count = 0;
+        align();
+        return reinterpret_cast<const T*>(p);
+    }
+
+    // Copies an array into `out`, which must already have its size
+    template <class T>
+    void getArrayInto(T* out, size_t expected) {
+        size_t count;
+        const T* values = getArray<T>(count);
+        if (count != expected) {
+            fail();
+            return;
+        }
+        if (count > 0) memcpy(out, values, count * sizeof(T));
+    }
+
+    template <class T>
+    void getVector(std::vector<T>& out) {
+        size_t count;
+        const T* values = getArray<T>(count);
+        out.assign(values, values + count);
+    }
+
+    std::string getString() {
+        size_t count;
+        const char* text = getArray<char>(count);
+        return std::string(text ? text : "", count);
+    }
+};
+
+#endif // CHECKPOINT_H
@@ -9,14 +9,88 @@
 #define PAGE_SIZE_KB_4 4
 #define PAGE_SIZE_KB_16 16
 
-// Virtual and physical memory sizes (in bytes)
-#define VIRTUAL_MEMORY_SIZE (1ULL << 32)   // 4 GB virtual memory
+// Virtual addresses are 64-bit. A page table translates at most
+// VIRTUAL_ADDRESS_BITS of them (the 5-level table); the two-level table
+// covers the low 4 GB.
+#define VIRTUAL_ADDRESS_BITS 58
+#define VIRTUAL_MEMORY_SIZE (1ULL << VIRTUAL_ADDRESS_BITS)
 #define PHYSICAL_MEMORY_SIZE (1ULL << 30)  // 1 GB physical memory
 
 // Number of entries per level in a multi-level page table
 #define LEVEL1_ENTRIES 1024
 #define LEVEL2_ENTRIES 1024
 
+// 4- and 5-level page tables: 512 entries in every level above the
+// directory level, whose entries span LARGE_PAGE_SHIFT bits like the
+// two-level table's
+#define UPPER_LEVEL_BITS 9
+
+// Large pages: one directory entry maps a 4 MB page directly
+#define LARGE_PAGE_SIZE_KB 4096
+#define LARGE_PAGE_SHIFT 22
+
+// Default TLB geometry (sets x ways); can also be changed at runtime
+#ifndef TLB_SETS
+#define TLB_SETS 1
+#endif
+#ifndef TLB_WAYS
+#define TLB_WAYS 64
+#endif
+// Fully associative entries for large pages, kept apart from the base-page sets
+#ifndef TLB_LARGE_ENTRIES
+#define TLB_LARGE_ENTRIES 32
+#endif
+
+// Second-level TLB (0 sets = none) and the page-walk cache for directory entries
+#ifndef TLB_L2_SETS
+#define TLB_L2_SETS 0
+#endif
+#ifndef TLB_L2_WAYS
+#define TLB_L2_WAYS 8
+#endif
+#ifndef TLB_WALK_CACHE_ENTRIES
+#define TLB_WALK_CACHE_ENTRIES 32
+#endif
+
+// Translation cost model, in cycles: L1 and L2 TLB lookups, a page-walk
+// cache hit and one page-table read by the walker
+#ifndef TLB_L1_CYCLES
+#define TLB_L1_CYCLES 1
+#endif
+#ifndef TLB_L2_CYCLES
+#define TLB_L2_CYCLES 9
+#endif
+#ifndef WALK_CACHE_CYCLES
+#define WALK_CACHE_CYCLES 2
+#endif
+#ifndef WALK_MEMORY_CYCLES
+#define WALK_MEMORY_CYCLES 20
+#endif
+
+// Per-thread frame cache (magazine) size and refill/drain batch
+#define FRAME_CACHE_SIZE 64
+#define FRAME_CACHE_BATCH 32
+
+// Parallel replay: accesses per batch handed to a worker, and batches each
+// worker's queue holds before the trace reader waits for it
+#define REPLAY_BATCH_SIZE 1024
+#define REPLAY_QUEUE_BATCHES 16
+
+// Traces read from stdin or a pipe go through a window of this many bytes
+// (grown only for a line or binary block that doesn't fit)
+#define TRACE_STREAM_BUFFER (1 << 20)
+
+// Swap (--swap): pages per write batch of a replay thread, slots a thread
+// reserves at a time (a multiple of 64), and I/O threads that write and
+// read the backing file
+#define SWAP_BATCH_PAGES 32
+#define SWAP_CLUSTER_SLOTS 64
+#define SWAP_IO_THREADS 2
+
+// Metrics (--metrics): each thread times one operation of every kind in
+// METRICS_TIMER_SAMPLING, so the clock reads stay off most accesses
+#define METRICS_TIMER_SAMPLING 16
+
 // Base addresses for segments (hex format for clarity)
 #define TEXT_BASE_ADDR     0x00000000
 #define DATA_BASE_ADDR     0x10000000
@@ -0,0 +1,122 @@
+#ifndef CPU_TLB_H
+#define CPU_TLB_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "tlb.h"
+
+// What a context switch does to the outgoing task's TLB entries
+enum ContextSwitchMode {
+    SWITCH_FLUSH,   // flush the whole TLB on every switch
+    SWITCH_ASID     // keep entries; each task's are tagged with its ASID
+};
+
+struct CpuTLBConfig {
+    unsigned cpus;            // CPU-level TLBs shared by all tasks; 0 = one TLB per task
+    ContextSwitchMode mode;
+    uint32_t asids;           // ASIDs per CPU before rollover, 2..TLB::MAX_ASID + 1
+
+    CpuTLBConfig() : cpus(0), mode(SWITCH_ASID), asids(256) {}
+};
+
+// CPU-level TLBs shared by all tasks
+// Tasks are pinned to CPUs round-robin in order of creation and scheduled
+// in the order they appear in the trace: whenever a CPU runs a different
+// task than its last one, that is a context switch. In flush mode the
+// switch empties the TLB. In ASID mode a task keeps the ASID it was given
+// on its CPU for as long as that CPU's ASID generation lasts; when a CPU
+// runs out of ASIDs it starts a new generation, flushes its TLB and hands
+// out ASIDs from the start again, so every task gets a fresh one on its
+// next switch (the rollover scheme Linux uses).
+//
+// Each CPU is only ever used by the thread replaying its tasks; with
+// parallel replay the CPU count is a multiple of the worker count so that
+// all tasks of a CPU land on the same worker.
+class CpuTLBs {
+public:
+    // A task's address space on its CPU
+    struct Context {
+        unsigned cpu;
+        uint32_t asid;
+        uint64_t generation;   // CPU generation the ASID belongs to; 0 = none yet
+    };
+
+private:
+    struct Cpu {
+        TLB tlb;
+        const Context* current;
+        uint64_t generation;
+        uint32_t next_asid;
+
+        // Statistics
+        uint64_t context_switches;
+        uint64_t flushes;          // full TLB flushes (every switch, or rollovers)
+        uint64_t flushed_entries;  // valid entries discarded by flushes
+        uint64_t rollovers;        // ASID generations used up
+
+        Cpu() : current(nullptr), generation(1), next_asid(0), context_switches(0),
+                flushes(0), flushed_entries(0), rollovers(0) {}
+    };
+
+    CpuTLBConfig config;
+    std::vector<std::unique_ptr<Cpu>> cpus;
+    std::vector<std::unique_ptr<Context>> contexts;
+    std::mutex contexts_lock;
+
+    CpuTLBs() {}
+
+    void contextSwitch(Cpu& cpu, Context& context);
+
+    // True if the CPU's TLB may still hold entries of the context
+    bool holdsEntries(const Cpu& cpu, const Context& context) const;
+
+public:
+    static CpuTLBs& getInstance();
+
+    CpuTLBs(const CpuTLBs&) = delete;
+    void operator=(const CpuTLBs&) = delete;
+
+    // Creates the CPU TLBs (geometry from TLB::getDefaultConfig())
+    void configure(const CpuTLBConfig& cfg);
+
+    bool enabled() const { return !cpus.empty(); }
+
+    // Pins a new task to a CPU; nullptr when tasks have private TLBs
+    Context* registerTask();
+
+    // A forked task runs on its parent's CPU (and so on the parent's worker);
+    // must be called before the child's first access
+    void inherit(Context& child, const Context& parent) { child.cpu = parent.cpu; }
+
+    // The TLB of the context's CPU, switched to the context if needed
+    TLB& activate(Context& context) {
+        Cpu& cpu = *cpus[context.cpu];
+        if (cpu.current != &context) contextSwitch(cpu, context);
+        return cpu.tlb;
+    }
+
+    // Drops the context's entry for virtual_page, wherever it is cached
+    void invalidate(const Context& context, uint64_t virtual_page, bool large);
+
+    // Drops the context's page-walk cache entry for a freed page table
+    void invalidateWalk(const Context& context, uint64_t directory_key);
+
+    // Adds the counts of all CPU TLBs to stats
+    void addTranslationStats(TranslationStats& stats) const;
+
+    void printStats() const;
+
+    // CPU TLBs and every context (checkpoints). Contexts are stored in
+    // order of registration, so restore() expects the tasks to have been
+    // created again, in their original order, before it is called.
+    void save(CheckpointWriter& out) const;
+    void restore(CheckpointReader& in);
+
+    // Prints the cost model's totals for the run: the CPU TLBs' counts plus
+    // those of the tasks' private TLBs
+    void printTranslationCost(const TranslationStats& private_tlbs) const;
+};
+
+#endif // CPU_TLB_H
@@ -0,0 +1,163 @@
+#ifndef EVENT_TRACE_H
+#define EVENT_TRACE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "config.h"
+
+// Event tracing verbosity (compile time)
+// 0: compiled out entirely
+// 1: page misses, allocations, evictions, swapping and deallocations
+// 2: everything above plus TLB hits and page hits
+#ifndef EVENT_TRACE_LEVEL
+#define EVENT_TRACE_LEVEL 2
+#endif
+
+enum EventType {
+    EVENT_TLB_HIT = 1,
+    EVENT_PAGE_HIT,
+    EVENT_PAGE_MISS,
+    EVENT_ALLOCATE,
+    EVENT_EVICT,
+    EVENT_DEALLOCATE,
+    EVENT_COW_FAULT,     // physical_page: the frame the task writes from now on
+    EVENT_SWAP_OUT,      // physical_page: the swap slot the evicted page went to
+    EVENT_SWAP_IN        // physical_page: the swap slot the page came back from
+};
+
+// Which simulator produced the log (controls how the decoder prints pages)
+enum EventLogMode {
+    EVENT_LOG_SINGLE = 1,
+    EVENT_LOG_MULTI = 2
+};
+
+// Task index used for events that do not belong to any task
+#define EVENT_NO_TASK 0xFFFFFFFFu
+
+// Fixed-size binary event record (32 bytes on disk)
+struct EventRecord {
+    uint64_t sequence;       // global order across all tasks
+    uint64_t virtual_page;
+    uint32_t task;           // index into the log's task table
+    uint32_t physical_page;
+    uint32_t type;           // EventType
+    uint32_t reserved;
+};
+
+// On-disk layout
+// File header followed by blocks; every block starts with an EventBlockHeader.
+// EVENT_BLOCK_TASK payload: uint32 task index, then the task name bytes.
+// EVENT_BLOCK_RECORDS payload: an array of EventRecord.
+#define EVENT_LOG_MAGIC 0x56454D4Du   // "MMEV"
+#define EVENT_LOG_VERSION 4
+
+struct EventLogHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t mode;           // EventLogMode
+    uint32_t record_size;
+    uint32_t page_size_kb;   // base page size of the run (splits virtual pages)
+    uint32_t reserved;
+};
+
+enum EventBlockType {
+    EVENT_BLOCK_TASK = 1,
+    EVENT_BLOCK_RECORDS = 2
+};
+
+struct EventBlockHeader {
+    uint32_t type;           // EventBlockType
+    uint32_t length;         // payload bytes
+};
+
+class EventTracer;
+
+// Single-producer/single-consumer ring of event records for one task
+// The simulating thread pushes, the tracer's writer thread drains.
+class EventRing {
+private:
+    static const size_t CAPACITY = 4096;   // power of two
+
+    EventRecord records[CAPACITY];
+    std::atomic<size_t> head;   // next slot to write (producer)
+    std::atomic<size_t> tail;   // next slot to read (consumer)
+    uint32_t task_index;
+    EventTracer* tracer;
+
+    friend class EventTracer;
+
+public:
+    EventRing(uint32_t index, EventTracer* owner);
+
+    void record(EventType type, uint64_t virtual_page, uint32_t physical_page);
+
+    // Copies pending records into out; returns the number drained
+    size_t drain(std::vector<EventRecord>& out);
+};
+
+// Process-wide event tracer with a background writer thread
+class EventTracer {
+private:
+    FILE* file;
+    std::vector<EventRing*> rings;
+    std::mutex rings_mutex;
+    std::atomic<uint64_t> sequence;
+    EventRing* system_ring;
+
+    std::thread writer;
+    std::mutex wake_mutex;
+    std::condition_variable wake;
+    std::atomic<bool> stopping;
+
+    EventTracer();
+    void writerLoop();
+    size_t drainAll(std::vector<EventRecord>& buffer);
+    void writeBlock(uint32_t type, const void* data, uint32_t length);
+
+    friend class EventRing;
+
+public:
+    static EventTracer& getInstance();
+
+    EventTracer(const EventTracer&) = delete;
+    void operator=(const EventTracer&) = delete;
+    ~EventTracer();
+
+    // Starts tracing into the given file; returns false if it can't be opened
+    bool open(const std::string& filename, EventLogMode mode, uint32_t page_size_kb = MIN_PAGE_SIZE_KB);
+
+    // Drains every ring, stops the writer and closes the file
+    void close();
+
+    bool isOpen() const { return file != nullptr; }
+
+    // Ring for a new task, or nullptr when tracing is off
+    EventRing* registerTask(const std::string& task_id);
+
+    // Ring for events with no owning task (e.g. evictions)
+    EventRing* systemRing() { return system_ring; }
+
+    // Wake the writer (called by producers that found their ring full)
+    void notifyWriter();
+};
+
+// Records an event at the given verbosity level; compiles to nothing when
+// EVENT_TRACE_LEVEL is below that level.
+#if EVENT_TRACE_LEVEL > 0
+#define TRACE_EVENT(level, ring, type, virtual_page, physical_page)          \
+    do {                                                                     \
+        if (EVENT_TRACE_LEVEL >= (level) && (ring) != nullptr) {             \
+            (ring)->record((type), (virtual_page), (physical_page));         \
+        }                                                                    \
+    } while (0)
+#else
+#define TRACE_EVENT(level, ring, type, virtual_page, physical_page) do { } while (0)
+#endif
+
+#endif // EVENT_TRACE_H
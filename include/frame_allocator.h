@@ -0,0 +1,62 @@
+#ifndef FRAME_ALLOCATOR_H
+#define FRAME_ALLOCATOR_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+class CheckpointWriter;
+class CheckpointReader;
+
+// Dense physical frame allocator.
+//
+// Frames are tracked in a bitmap (bit set = frame free). Above it sit summary
+// levels where each bit says "the word below still has a free frame", up to a
+// single top word. Allocation walks down the levels with count-trailing-zeros,
+// so both allocate and free touch one word per level (3 levels for 131072
+// frames) and the lowest free frame is always handed out first.
+class FrameAllocator {
+private:
+    // levels[0] is the frame bitmap, levels.back() is a single summary word
+    std::vector<std::vector<uint64_t>> levels;
+    uint32_t first_frame;   // frame number of bit 0 (for partitioned pools)
+    uint32_t total_frames;
+    uint32_t free_frames;
+
+    // Bit index relative to first_frame
+    void markFree(uint32_t index);
+    void markUsed(uint32_t index);
+
+public:
+    // Manages frames [first, first + frame_count)
+    explicit FrameAllocator(uint32_t frame_count, uint32_t first = 0);
+
+    // Returns false when no frame is free
+    bool allocate(uint32_t& frame);
+
+    // Returns false if the frame was not allocated
+    bool free(uint32_t frame);
+
+    // Allocates `count` contiguous frames (a multiple of 64) aligned to
+    // `count`, e.g. for a large page. Scans the bitmap a word at a time;
+    // returns false when no aligned run is entirely free.
+    bool allocateRange(uint32_t count, uint32_t& first);
+    void freeRange(uint32_t first, uint32_t count);
+
+    bool isAllocated(uint32_t frame) const;
+
+    bool contains(uint32_t frame) const {
+        return frame >= first_frame && frame - first_frame < total_frames;
+    }
+
+    uint32_t getFirstFrame() const { return first_frame; }
+    uint32_t getTotalCount() const { return total_frames; }
+    uint32_t getFreeCount() const { return free_frames; }
+    uint32_t getAllocatedCount() const { return total_frames - free_frames; }
+
+    // Bitmaps and counts; restore() needs an allocator of the same size
+    void save(CheckpointWriter& out) const;
+    void restore(CheckpointReader& in);
+};
+
+#endif // FRAME_ALLOCATOR_H
@@ -0,0 +1,145 @@
+#ifndef INVERTED_PAGE_TABLE_H
+#define INVERTED_PAGE_TABLE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "page_table.h"
+
+// Hashed inverted page table
+// One table for all tasks, with an entry per physical frame instead of per
+// virtual page: entry n holds the mapping of frame n, so the table's size
+// follows physical memory however many tasks and mappings there are. A
+// lookup hashes (address space, virtual page) into the anchor table and
+// follows the bucket's chain of entries. A frame that several tasks map
+// (fork, shared regions) takes one entry per extra mapping from an alias
+// area past the frame entries.
+//
+// Every task's table is one address space in it (InvertedSpace); each
+// space also links its own entries, for fork, checkpoints and teardown.
+// Entries are allocated in blocks as their frames are first mapped and
+// never move, so PTE pointers stay valid until the mapping goes.
+//
+// There is one table for the whole run. A lookup can walk a chain through
+// any task's entries, so tasks on this table are replayed in trace order
+// even with --threads (SHARED_TABLE in page_table_layouts.h).
+
+// A task's address space in the inverted table
+struct InvertedSpace {
+    uint32_t id;      // hashed with the virtual page; unique per process
+    uint32_t head;    // first entry of the space, or INVERTED_NONE
+    uint32_t pages;   // entries of the space
+
+    InvertedSpace();
+};
+
+#define INVERTED_NONE 0xFFFFFFFFu
+
+// Counters of the table
+struct InvertedStats {
+    uint64_t lookups;
+    uint64_t probes;         // anchor and chain entries read by lookups
+    uint64_t aliases;        // mappings that took an alias entry
+    uint64_t peak_aliases;   // most alias entries in use at any one time
+
+    InvertedStats() : lookups(0), probes(0), aliases(0), peak_aliases(0) {}
+};
+
+class InvertedPageTable {
+private:
+    struct Entry {
+        uint64_t virtual_page;
+        uint32_t space;        // INVERTED_NONE when free
+        uint32_t pte;
+        uint32_t chain_next;   // next entry of the anchor bucket
+        uint32_t space_prev;   // the space's entries, most recent first
+        uint32_t space_next;
+        uint32_t unused;
+    };
+
+    static const uint32_t BLOCK_SHIFT = 12;
+    static const uint32_t BLOCK_ENTRIES = 1u << BLOCK_SHIFT;
+
+    uint32_t frame_count;        // entries below this are frame entries
+    uint32_t anchor_shift;       // 64 - log2(anchors)
+    std::vector<uint32_t> anchors;
+    std::vector<std::unique_ptr<Entry[]>> blocks;   // nullptr until used
+    uint32_t alias_end;          // alias entries ever used (from frame_count)
+    std::vector<uint32_t> free_aliases;
+    uint32_t alias_count;
+    uint32_t entry_count;
+    InvertedStats stats;
+
+    static std::mutex instance_lock;
+    static std::unique_ptr<InvertedPageTable> instance;   // created on first use
+
+    explicit InvertedPageTable(uint32_t frames);
+
+    Entry& at(uint32_t index) { return blocks[index >> BLOCK_SHIFT][index & (BLOCK_ENTRIES - 1)]; }
+    const Entry& at(uint32_t index) const { return blocks[index >> BLOCK_SHIFT][index & (BLOCK_ENTRIES - 1)]; }
+    uint32_t bucket(uint32_t space, uint64_t virtual_page) const {
+        uint64_t key = virtual_page ^ (static_cast<uint64_t>(space) << 40);
+        return static_cast<uint32_t>((key * 0x9E3779B97F4A7C15ULL) >> anchor_shift);
+    }
+    uint32_t takeEntry(uint32_t frame);
+    void freeEntry(uint32_t index);
+    void unlink(InvertedSpace& space, uint32_t index);
+
+public:
+    // The table, sized for the memory manager's frames
+    static InvertedPageTable& getInstance();
+
+    // Number for a new address space; spaces are created in trace order
+    static uint32_t nextSpaceId();
+
+    // The PTE of (space, virtual_page), or nullptr. probes is set to the
+    // entries read: the anchor plus every chain entry up to the match.
+    uint32_t* find(const InvertedSpace& space, uint64_t virtual_page, uint32_t& probes) {
+        probes = 1;
+        stats.lookups++;
+        for (uint32_t index = anchors[bucket(space.id, virtual_page)]; index != INVERTED_NONE;) {
+            Entry& entry = at(index);
+            probes++;
+            if (entry.virtual_page == virtual_page && entry.space == space.id) {
+                stats.probes += probes;
+                return &entry.pte;
+            }
+            index = entry.chain_next;
+        }
+        stats.probes += probes;
+        return nullptr;
+    }
+
+    // Maps virtual_page to frame, replacing any previous mapping of it
+    void map(InvertedSpace& space, uint64_t virtual_page, uint32_t frame, uint32_t flags);
+    // Removes the mapping; false if there is none
+    bool unmap(InvertedSpace& space, uint64_t virtual_page, uint32_t& frame);
+    // Removes every mapping of the space
+    void clear(InvertedSpace& space);
+
+    // Calls visit(virtual_page, pte) for every mapping of the space, most
+    // recently mapped first
+    template <class Visitor>
+    void forEach(const InvertedSpace& space, Visitor visit) {
+        for (uint32_t index = space.head; index != INVERTED_NONE;) {
+            Entry& entry = at(index);
+            uint32_t next = entry.space_next;
+            visit(entry.virtual_page, entry.pte);
+            index = next;
+        }
+    }
+
+    static size_t getEntrySize() { return sizeof(Entry); }
+    size_t getMemoryUsage() const;
+
+    // Size, occupancy and probes; prints nothing if the table was not used
+    static void printStats();
+
+    // The table, if it was used
+    static void save(CheckpointWriter& out);
+    static void restore(CheckpointReader& in);
+};
+
+#endif // INVERTED_PAGE_TABLE_H
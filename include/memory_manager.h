@@ -1,29 +1,184 @@
 #ifndef MEMORY_MANAGER_H
 #define MEMORY_MANAGER_H
 
-#include <unordered_set>
+#include <atomic>
 #include <cstdint>
 #include <iostream>
-#include <queue>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "config.h"
+#include "frame_allocator.h"
+#include "replacement.h"
+
+class CheckpointWriter;
+class CheckpointReader;
+
+// Physical frame manager (thread-safe)
+// Frames come from a global bitmap pool. Every thread keeps a small magazine
+// of free frames that it refills from, and drains back to, the pool in
+// batches of FRAME_CACHE_BATCH, so the pool lock is taken rarely. In
+// deterministic mode the frames are instead split into one partition per
+// worker; each worker allocates from its own partition first, so frame
+// numbers do not depend on thread scheduling.
+//
+// Pages are only evicted when no frame is free anywhere. Then a page is
+// taken back from its owner: one replacement engine holds every resident
+// page, whichever thread faulted it in, and the frame table is the reverse
+// map from frame to (owner, virtual page) used for that.
+//
+// A parallel replay (parallel_replay.h) gets the replacement results of a
+// serial run in two phases. While no record can find memory full, workers
+// run freely and the engine is left alone: each page faulted in is stamped
+// with its position in the trace (beginRecord). When the replay switches
+// to trace order, orderReplacement() inserts the resident pages in stamp
+// order, as a serial run would have. From then on one record runs at a
+// time, the magazines are bypassed and a worker whose partition is empty
+// takes frames from the other partitions.
 class MemoryManager {
 private:
-    std::unordered_set<uint32_t> free_pages;
-    std::unordered_set<uint32_t> allocated_pages;
-    std::queue<uint32_t> page_allocation_order;
+    // Stamp of a page: its record's sequence number above the page's
+    // position in the record (a record spans at most 2^20 pages)
+    static const uint32_t STAMP_SHIFT = 24;
+
+    struct FrameCache {
+        uint32_t frames[FRAME_CACHE_SIZE];
+        uint32_t count;
+        std::atomic<int64_t> allocated;   // allocations minus frees by this thread
+        unsigned worker;
+        FrameAllocator* partition;        // deterministic mode: this worker's frames
+        uint64_t stamp;                   // stamp of this thread's next page
+        // Deferred: stamp * 2 + 1 for each page faulted in, stamp * 2 for
+        // each one released (orderReplacement counts the faults and the
+        // most pages resident at once from these)
+        std::vector<uint64_t> residency;
+
+        FrameCache() : count(0), allocated(0), worker(0), partition(nullptr), stamp(0) {}
+    };
+
+    FrameAllocator frames;
+    mutable std::mutex pool_lock;
+    std::vector<std::unique_ptr<FrameAllocator>> partitions;
+    std::vector<FrameCache*> caches;        // live per-thread caches (under pool_lock)
+    int64_t retired_allocated;              // net allocations of detached threads
+    std::vector<uint64_t> retired_residency;   // deferred residency of detached threads
+    std::unique_ptr<std::atomic<uint64_t>[]> in_use;   // one bit per allocated frame
+    std::vector<FrameEntry> frame_table;    // reverse map, one entry per frame
+    std::vector<uint64_t> frame_stamps;     // deferred: stamp of the page in each frame
+    ReplacementPolicy policy;
+    std::unique_ptr<ReplacementEngine> engine;
+    ReplacementStats deferred_stats;        // faults of pages released before they were ordered
+    bool deferred;                          // pages are stamped, not handed to the engine
+    bool ordered;                           // one record at a time: no magazines, partitions shared
     uint32_t total_pages;
+    uint32_t large_page_frames;
+
+    static thread_local FrameCache* local_cache;
 
     MemoryManager(); // constructor
 
+    FrameCache& cache();
+    bool refill(FrameCache& c, uint32_t& page_number);
+    uint32_t replacePage(FrameCache& c);
+    bool takeFreeFrame(FrameCache& c, uint32_t& page_number);
+    bool takePartitionRange(FrameCache& c, uint32_t count, uint32_t& first_frame);
+    void registerPage(FrameCache& c, PageOwner* owner, uint64_t virtual_page, uint32_t page_number);
+    void unregisterPage(FrameCache& c, uint32_t page_number);
+    bool markInUse(uint32_t page_number, bool used);
+    void releaseFrames(FrameCache& c, uint32_t first_frame, uint32_t count);
+
 public:
     static MemoryManager& getInstance(); // singleton
 
     MemoryManager(const MemoryManager&) = delete;
     void operator=(const MemoryManager&) = delete;
 
-    uint32_t allocatePage();
+    // Sets the physical memory size, frame size and replacement policy.
+    // Must be called before any frame is allocated.
+    void configureMemory(uint64_t bytes, uint32_t frame_size_kb = MIN_PAGE_SIZE_KB);
+    void setReplacementPolicy(ReplacementPolicy replacement);
+
+    // Splits the frames into one partition per worker (deterministic mode).
+    // Must be called before any frame is allocated.
+    void configurePartitions(unsigned workers);
+
+    // Binds the calling thread to a worker (and its partition, if any)
+    void attachThread(unsigned worker);
+
+    // Returns the calling thread's cached frames to the pool
+    void detachThread();
+
+    // Parallel replay: from now until orderReplacement(), pages faulted in
+    // are stamped instead of handed to the replacement engine, so nothing
+    // may need an eviction. Must be called before the workers start.
+    void deferReplacement();
+
+    // Sets the trace position of the calling thread's next faults: the
+    // record's sequence number, increasing in trace order
+    void beginRecord(uint64_t sequence);
+
+    // Hands the deferred pages to the engine in trace order and replays one
+    // record at a time from then on. The caller must be the only thread
+    // using the memory manager.
+    void orderReplacement();
+
+    // Frames the records of a deferred replay may take, at most, without
+    // any of them finding memory full: the worker's partition, or (without
+    // partitions) the pool less what the workers' magazines can hold
+    uint32_t getDeferredFrames(unsigned worker, unsigned workers) const;
+    bool isPartitioned() const { return !partitions.empty(); }
+
+    // Allocates a frame for owner's virtual_page, evicting a page if memory
+    // is full. Frames allocated without an owner are never evicted.
+    uint32_t allocatePage(PageOwner* owner = nullptr, uint64_t virtual_page = 0);
+
+    // Bulk form of allocatePage for owner's virtual_pages, in order. Stops
+    // short instead of evicting: returns how many frames it handed out, and
+    // the caller allocates the rest one by one. The frames are the same ones
+    // the equivalent allocatePage calls would have returned.
+    uint32_t allocatePages(PageOwner* owner, const uint64_t* virtual_pages, uint32_t count,
+                           uint32_t* page_numbers);
     void deallocatePage(uint32_t page_number);
+
+    // Allocates the contiguous frames of a large page for owner's
+    // virtual_page (the first base page it covers). Returns false when no
+    // aligned run is free, so the caller can fall back to base pages. The
+    // replacement engine sees a large page as one page and evicts it whole.
+    bool allocateLargePage(PageOwner* owner, uint64_t virtual_page, uint32_t& first_frame);
+    void deallocateLargePage(uint32_t first_frame);
+
+    // Frames per large page
+    uint32_t getLargePageFrames() const { return large_page_frames; }
+
+    // Reverse map entry of an allocated frame: the page it holds. Frames
+    // that several tasks map are handed over to their SharedFrames table.
+    PageOwner* getFrameOwner(uint32_t page_number, uint64_t& virtual_page) const {
+        virtual_page = frame_table[page_number].virtual_page;
+        return frame_table[page_number].owner;
+    }
+    void setFrameOwner(uint32_t page_number, PageOwner* owner, uint64_t virtual_page) {
+        frame_table[page_number].owner = owner;
+        frame_table[page_number].virtual_page = virtual_page;
+    }
+
+    // Sets the frame's accessed bit (called on every access to a mapped page)
+    void touchPage(uint32_t page_number) { frame_table[page_number].accessed = 1; }
+
+    // Replacement counters (complete once the pages are ordered)
+    ReplacementStats getReplacementStats() const;
+    void printReplacementStats() const;
+
     uint32_t getFreePageCount() const;
     uint32_t getAllocatedPageCount() const;
+    uint32_t getTotalPageCount() const { return total_pages; }
+
+    // Checkpoints of a serial run: the pool, the reverse map, the calling
+    // thread's frame cache and the replacement engine. restore() needs the
+    // same memory size, frame size and policy, and every owner registered
+    // with the reader. Returns false if other threads hold frames (save) or
+    // the checkpoint does not match (restore).
+    bool save(CheckpointWriter& out);
+    bool restore(CheckpointReader& in);
 };
 
 #endif
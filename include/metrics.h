@@ -0,0 +1,290 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "config.h"
+#include "tlb.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+// Metrics (compile time)
+// 0: compiled out entirely
+// 1: counters and latency histograms, collected when a run asks for them
+//    (--metrics); otherwise every probe is one load and branch
+#ifndef METRICS_LEVEL
+#define METRICS_LEVEL 1
+#endif
+
+// Distributions: the first six are latencies in clock ticks (exported in
+// nanoseconds), walk depth is a plain count
+enum MetricHistogram {
+    METRIC_TLB_LOOKUP,     // TLB lookup of one page, all levels
+    METRIC_PAGE_WALK,      // page-table lookup of one page after a TLB miss
+    METRIC_FRAME_ALLOC,    // frame allocation (single or bulk), evictions included
+    METRIC_REPLACEMENT,    // choosing a victim and taking the frame back
+    METRIC_PARSE,          // decoding one trace record
+    METRIC_PAGE_IN,        // major fault: reading the page back from swap (every one is timed)
+    METRIC_WALK_DEPTH,     // page-table entries one walk read from memory
+    METRIC_HISTOGRAM_COUNT
+};
+
+enum MetricCounter {
+    METRIC_ACCESSES,            // pages accessed
+    METRIC_PAGE_WALKS,          // TLB misses in every level
+    METRIC_PAGE_FAULTS,         // accesses to a page with no frame
+    METRIC_MAJOR_FAULTS,        // faults that read the page back from swap
+    METRIC_FRAMES_ALLOCATED,    // frames handed out (a large page counts all of its frames)
+    METRIC_FRAMES_FREED,
+    METRIC_EVICTIONS,
+    METRIC_TABLES_ALLOCATED,    // page-table pages (multilevel)
+    METRIC_TABLES_FREED,
+    METRIC_COUNTER_COUNT
+};
+
+// Reads the metrics clock: the time-stamp counter on x86, nanoseconds elsewhere
+inline uint64_t metricsClock() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+// Log-linear histogram in the style of HdrHistogram
+// Values below 16 have a bucket each; above that every power of two is
+// split into 16 buckets, so a bucket is within 1/16 (6.25%) of its values
+// across the whole 64-bit range with a fixed 976 buckets.
+class Histogram {
+public:
+    static const uint32_t SUB_BITS = 4;
+    static const uint32_t SUB_BUCKETS = 1u << SUB_BITS;
+    static const uint32_t BUCKETS = (64 - SUB_BITS + 1) * SUB_BUCKETS;
+
+private:
+    uint64_t buckets[BUCKETS];
+    uint64_t count;
+    uint64_t sum;
+    uint64_t min;
+    uint64_t max;
+
+    static uint32_t bucketOf(uint64_t value) {
+        if (value < SUB_BUCKETS) return static_cast<uint32_t>(value);
+        uint32_t exponent = 63 - static_cast<uint32_t>(__builtin_clzll(value));
+        return (exponent - SUB_BITS + 1) * SUB_BUCKETS +
+               static_cast<uint32_t>((value >> (exponent - SUB_BITS)) & (SUB_BUCKETS - 1));
+    }
+
+    // Largest value that falls in the bucket
+    static uint64_t bucketHigh(uint32_t bucket);
+
+public:
+    Histogram();
+
+    void record(uint64_t value) {
+        buckets[bucketOf(value)]++;
+        count++;
+        sum += value;
+        if (value < min) min = value;
+        if (value > max) max = value;
+    }
+    void add(const Histogram& other);
+
+    uint64_t getCount() const { return count; }
+    uint64_t getMin() const { return count > 0 ? min : 0; }
+    uint64_t getMax() const { return max; }
+    double getMean() const { return count > 0 ? static_cast<double>(sum) / count : 0.0; }
+
+    // Smallest bucket bound that at least `percent` of the values are at or
+    // below (capped at the maximum)
+    uint64_t getPercentile(double percent) const;
+};
+
+// One thread's counters and histograms
+// Only the owning thread writes them. Counters are atomics, stored with
+// relaxed load/store pairs (no locked instructions), so samples can sum them
+// from another thread while workers run; histograms are read once the
+// workers are done.
+class MetricsThread {
+private:
+    std::atomic<uint64_t> counters[METRIC_COUNTER_COUNT];
+    Histogram histograms[METRIC_HISTOGRAM_COUNT];
+    uint32_t countdown[METRIC_HISTOGRAM_COUNT];   // operations until the next timed one
+
+    friend class Metrics;
+
+public:
+    MetricsThread();
+
+    void count(MetricCounter counter, uint64_t n) {
+        counters[counter].store(counters[counter].load(std::memory_order_relaxed) + n,
+                                std::memory_order_relaxed);
+    }
+    void record(MetricHistogram histogram, uint64_t value) { histograms[histogram].record(value); }
+
+    // True for one call in METRICS_TIMER_SAMPLING per histogram
+    bool timeNext(MetricHistogram histogram) {
+        if (--countdown[histogram] != 0) return false;
+        countdown[histogram] = METRICS_TIMER_SAMPLING;
+        return true;
+    }
+};
+
+// Output format of the metrics file
+enum MetricsFormat {
+    METRICS_JSON,
+    METRICS_CSV
+};
+
+// Per-task counts for the export, filled in by task::getMetrics()
+struct TaskMetrics {
+    std::string id;
+    uint64_t page_hits;
+    uint64_t page_misses;
+    uint64_t cow_faults;
+    uint64_t major_faults;    // pages read back from swap
+    uint64_t tlb_lookups;     // private TLB; 0 when tasks share CPU TLBs
+    uint64_t tlb_misses;
+    uint64_t mapped_pages;    // base pages in the page table
+    uint64_t large_pages;
+    uint64_t page_tables;     // page-table pages (multilevel)
+
+    TaskMetrics() : page_hits(0), page_misses(0), cow_faults(0), major_faults(0), tlb_lookups(0), tlb_misses(0),
+                    mapped_pages(0), large_pages(0), page_tables(0) {}
+};
+
+// State at the end of the run that the export adds to the counters
+struct MetricsTotals {
+    uint64_t records;              // trace records replayed, including any before a --restore
+    uint64_t frames_in_use;
+    uint64_t frames_total;
+    TranslationStats translation;  // all TLBs, private and CPU
+    uint64_t translation_cycles;
+
+    MetricsTotals() : records(0), frames_in_use(0), frames_total(0), translation_cycles(0) {}
+};
+
+// Process-wide metrics registry
+// Collection is off until open() (or start(), which collects without an
+// export, for live windows). Each thread gets its MetricsThread on its
+// first probe; snapshots sum them. With --metrics-every N the replay takes
+// a sample of the counters and frames in use every N records, and write()
+// exports everything at the end of the run as JSON or CSV.
+class Metrics {
+private:
+    std::string filename;
+    MetricsFormat format;
+    std::string simulator;
+    uint64_t sample_every;
+    static std::atomic<bool> enabled;
+    uint64_t clock_start;           // metricsClock() and wall time at open()
+    uint64_t wall_start_ns;
+
+    struct Sample {
+        uint64_t records;
+        uint64_t counters[METRIC_COUNTER_COUNT];
+        uint64_t frames_in_use;
+    };
+    std::vector<Sample> samples;
+
+    std::mutex threads_lock;
+    std::vector<std::unique_ptr<MetricsThread>> threads;
+    static thread_local MetricsThread* local_thread;
+
+    Metrics();
+    MetricsThread* attach();
+
+public:
+    static Metrics& getInstance();
+
+    Metrics(const Metrics&) = delete;
+    void operator=(const Metrics&) = delete;
+
+    // Starts collecting for an export to filename ("-" = stdout); prints an
+    // error and returns false if metrics were compiled out
+    bool open(const std::string& file, MetricsFormat output, uint64_t every, const char* simulator_name);
+    // Starts collecting if open() hasn't; same errors
+    bool start(const char* simulator_name);
+
+    static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+    bool isExporting() const { return !filename.empty(); }
+
+    // Every thread's counters summed into totals[METRIC_COUNTER_COUNT]
+    void sumCounters(uint64_t* totals);
+
+    // The calling thread's metrics, or nullptr when collection is off
+    static MetricsThread* local() {
+        if (!isEnabled()) return nullptr;
+        MetricsThread* thread = local_thread;
+        return thread != nullptr ? thread : getInstance().attach();
+    }
+
+    // Called by the replay after each record; true when a sample is due
+    bool sampleDue(uint64_t records) const {
+        return sample_every != 0 && records % sample_every == 0 && isEnabled();
+    }
+    void sample(uint64_t records, uint64_t frames_in_use);
+
+    // Writes the export; returns false if the file can't be written
+    bool write(const MetricsTotals& totals, const std::vector<TaskMetrics>& tasks);
+};
+
+// Times the enclosing scope into a histogram (one scope in
+// METRICS_TIMER_SAMPLING)
+class MetricsTimer {
+private:
+    MetricsThread* thread;   // nullptr: this scope is not timed
+    MetricHistogram histogram;
+    uint64_t start;
+
+public:
+    explicit MetricsTimer(MetricHistogram which) : thread(Metrics::local()), histogram(which), start(0) {
+        if (thread != nullptr && thread->timeNext(which)) {
+            start = metricsClock();
+        } else {
+            thread = nullptr;
+        }
+    }
+    ~MetricsTimer() {
+        if (thread != nullptr) thread->record(histogram, metricsClock() - start);
+    }
+
+    MetricsTimer(const MetricsTimer&) = delete;
+    void operator=(const MetricsTimer&) = delete;
+};
+
+// Probes for the hot paths; they compile to nothing when METRICS_LEVEL is 0.
+// METRICS_TIME declares a timer for the rest of the enclosing scope.
+#if METRICS_LEVEL > 0
+#define METRICS_TIME(histogram) MetricsTimer metrics_timer(histogram)
+#define METRICS_COUNT(counter, n)                                            \
+    do {                                                                     \
+        MetricsThread* metrics_thread = Metrics::local();                    \
+        if (metrics_thread != nullptr) metrics_thread->count((counter), (n)); \
+    } while (0)
+#define METRICS_RECORD(histogram, value)                                     \
+    do {                                                                     \
+        MetricsThread* metrics_thread = Metrics::local();                    \
+        if (metrics_thread != nullptr) metrics_thread->record((histogram), (value)); \
+    } while (0)
+#else
+#define METRICS_TIME(histogram) do { } while (0)
+#define METRICS_COUNT(counter, n) do { } while (0)
+#define METRICS_RECORD(histogram, value) do { } while (0)
+#endif
+
+// TLB::lookup, timed into METRIC_TLB_LOOKUP
+inline bool timedTLBLookup(TLB& tlb, uint64_t virtual_page, uint32_t& physical_page) {
+    METRICS_TIME(METRIC_TLB_LOOKUP);
+    return tlb.lookup(virtual_page, physical_page);
+}
+
+#endif // METRICS_H
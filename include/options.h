@@ -0,0 +1,62 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <string>
+#include <vector>
+#include "tlb.h"
+#include "cpu_tlb.h"
+#include "replacement.h"
+#include "page_size.h"
+#include "metrics.h"
+
+// Page-table layout (--page-table); each executable has its own default
+enum PageTableKind {
+    PAGE_TABLE_DEFAULT,
+    PAGE_TABLE_SINGLE,   // hash map from virtual page to PTE
+    PAGE_TABLE_MULTI,    // two-level radix table, 32-bit addresses
+    PAGE_TABLE_4LEVEL,   // four-level radix table, 49-bit addresses
+    PAGE_TABLE_5LEVEL,   // five-level radix table, 58-bit addresses
+    PAGE_TABLE_INVERTED  // hashed inverted table shared by all tasks
+};
+
+// Command-line options shared by both simulators
+struct SimOptions {
+    std::string trace_file;   // "-" = stdin
+    PageTableKind page_table;
+    TLBConfig tlb;
+    CpuTLBConfig cpu_tlb;     // shared CPU TLBs; cpus = 0 keeps one TLB per task
+    std::string event_file;   // binary event log; empty = tracing off
+    unsigned threads;         // worker threads; 1 = serial replay
+    bool deterministic;       // fixed per-worker frame partitions
+    uint64_t memory_bytes;    // simulated physical memory
+    ReplacementPolicy replacement;
+    uint64_t swap_bytes;      // swap space for evicted pages; 0 = no swap
+    std::string swap_file;    // its backing file; empty = a temporary file
+    unsigned swap_threads;    // I/O threads writing and reading it
+    PageSizeConfig pages;     // base page size and large-page regions
+    std::vector<AddressRange> shared_regions;   // pages every task shares
+    std::string checkpoint_file;   // save the state here, then stop; empty = no checkpoint
+    uint64_t checkpoint_at;        // after this many records; 0 = at the end of the trace
+    std::string restore_file;      // start from this checkpoint; empty = cold start
+    std::string metrics_file;      // counters and histograms export; empty = metrics off
+    MetricsFormat metrics_format;
+    uint64_t metrics_every;        // sample the counters every N records; 0 = end of run only
+    uint64_t window_records;       // live statistics every N records; 0 = off
+    double window_seconds;         // and/or every T seconds; 0 = off
+
+    SimOptions()
+        : trace_file("trace.txt"), page_table(PAGE_TABLE_DEFAULT), threads(1), deterministic(false),
+          memory_bytes(PHYSICAL_MEMORY_SIZE), replacement(REPLACE_CLOCK), swap_bytes(0),
+          swap_threads(SWAP_IO_THREADS), checkpoint_at(0),
+          metrics_format(METRICS_JSON), metrics_every(0), window_records(0), window_seconds(0) {}
+};
+
+// Parses argv into options; prints usage/errors and returns false on failure
+bool parseOptions(int argc, char* argv[], SimOptions& options);
+
+// Applies process-wide settings (page sizes, TLB geometry, shared TLBs,
+// shared regions, memory size, replacement policy, frame partitions) from
+// the options
+void applyOptions(const SimOptions& options);
+
+#endif // OPTIONS_H
@@ -0,0 +1,50 @@
+#ifndef PAGE_SIZE_H
+#define PAGE_SIZE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "config.h"
+
+// An address range [start, end] to be mapped with large pages
+struct AddressRange {
+    uint64_t start;
+    uint64_t end;
+};
+
+// Page sizes used for a run
+// The base page size sets how trace regions are stepped, how addresses are
+// split into page numbers and the size of a physical frame. In the
+// multilevel table one directory entry always spans LARGE_PAGE_SIZE_KB, so
+// the page-table index takes the bits between the page offset and
+// LARGE_PAGE_SHIFT;
+// addresses inside a large-page region are mapped by the directory entry
+// itself with one large page.
+struct PageSizeConfig {
+    uint32_t page_size_kb;                    // power of two, 4..64 KB
+    bool large_everywhere;                    // every address uses large pages
+    std::vector<AddressRange> large_regions;  // otherwise only these do
+
+    PageSizeConfig() : page_size_kb(MIN_PAGE_SIZE_KB), large_everywhere(false) {}
+
+    uint32_t pageBytes() const { return page_size_kb * 1024; }
+    uint32_t pageShift() const { return static_cast<uint32_t>(__builtin_ctz(pageBytes())); }
+
+    // Base pages per large page, as a power of two
+    uint32_t largeOrder() const { return LARGE_PAGE_SHIFT - pageShift(); }
+
+    bool usesLargePages() const { return large_everywhere || !large_regions.empty(); }
+    bool wantsLargePage(uint64_t address) const;
+
+    // Returns nullptr if the configuration is usable, otherwise a reason
+    const char* validate() const;
+
+    // Configuration used by tasks created from now on
+    static void setCurrent(const PageSizeConfig& config);
+    static const PageSizeConfig& current();
+
+private:
+    static PageSizeConfig current_config;
+};
+
+#endif // PAGE_SIZE_H
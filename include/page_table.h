@@ -0,0 +1,270 @@
+#ifndef PAGE_TABLE_H
+#define PAGE_TABLE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "config.h"
+
+class CheckpointWriter;
+class CheckpointReader;
+
+// Page table entry layout (x86-style packed 32-bit word)
+// Bits 31-12: physical frame number, bits 11-0: flags
+#define PTE_PRESENT   (1u << 0)
+#define PTE_ACCESSED  (1u << 5)
+#define PTE_DIRTY     (1u << 6)
+#define PTE_LARGE     (1u << 7)   // directory entry maps a large page
+#define PTE_COW       (1u << 9)   // read-only copy-on-write mapping (after fork)
+#define PTE_SHARED    (1u << 10)  // frame of a shared region (shared_frames.h)
+#define PTE_FRAME_SHIFT 12
+#define PTE_FLAGS_MASK  ((1u << PTE_FRAME_SHIFT) - 1)
+
+inline uint32_t makePTE(uint32_t frame, uint32_t flags) {
+    return (frame << PTE_FRAME_SHIFT) | (flags & PTE_FLAGS_MASK);
+}
+
+inline uint32_t pteFrame(uint32_t pte) {
+    return pte >> PTE_FRAME_SHIFT;
+}
+
+// Two-level radix page table
+// The directory is a flat array of LEVEL1_ENTRIES pointers, allocated when
+// the first page is mapped so that idle tasks cost a few bytes; each non-null
+// slot points to a page-table page of LEVEL2_ENTRIES packed PTEs that is
+// allocated on first use and released again once its last entry is unmapped.
+// A directory slot can instead map one large page directly: its PDE then
+// lives in a second directory array that is only allocated once the first
+// large page is mapped.
+class RadixPageTable {
+private:
+    struct TablePage {
+        uint32_t entries[LEVEL2_ENTRIES];
+        uint32_t present_count;
+    };
+
+    TablePage** directory;       // LEVEL1_ENTRIES page-table pointers, or nullptr
+    uint32_t* large_directory;   // LEVEL1_ENTRIES large-page PDEs, or nullptr
+    uint32_t table_count;
+    uint32_t large_count;
+
+public:
+    RadixPageTable();
+    ~RadixPageTable();
+
+    RadixPageTable(const RadixPageTable&) = delete;
+    void operator=(const RadixPageTable&) = delete;
+
+    // Returns the PTE for (directory, table) index, or nullptr when no
+    // page-table page exists for that directory entry. The entry itself
+    // may still be non-present.
+    uint32_t* walk(uint32_t directory_index, uint32_t table_index) {
+        if (directory == nullptr) return nullptr;
+        TablePage* table = directory[directory_index];
+        return table ? &table->entries[table_index] : nullptr;
+    }
+
+    // Returns the large-page PDE for a directory slot, or nullptr when the
+    // slot does not map a large page
+    uint32_t* walkLarge(uint32_t directory_index) {
+        if (large_directory == nullptr || !(large_directory[directory_index] & PTE_PRESENT)) {
+            return nullptr;
+        }
+        return &large_directory[directory_index];
+    }
+
+    // True if the directory slot points at a page-table page
+    bool hasTable(uint32_t directory_index) const {
+        return directory != nullptr && directory[directory_index] != nullptr;
+    }
+
+    // Installs a present mapping, allocating the page-table page if needed
+    void map(uint32_t directory_index, uint32_t table_index, uint32_t frame, uint32_t flags);
+
+    // Clears a present mapping and reclaims the page-table page once empty.
+    // Returns false if the entry was not present.
+    bool unmap(uint32_t directory_index, uint32_t table_index, uint32_t& frame);
+
+    // Maps a whole directory slot to a large page starting at `frame`.
+    // Returns false if the slot already has a page-table page.
+    bool mapLarge(uint32_t directory_index, uint32_t frame, uint32_t flags);
+
+    // Clears a large-page mapping; returns false if there was none
+    bool unmapLarge(uint32_t directory_index, uint32_t& frame);
+
+    // Calls visit(directory_index, table_index, pte) for every present
+    // base-page PTE; visit may change the PTE's flags
+    template <class Visitor>
+    void forEachPresent(Visitor visit) {
+        if (directory == nullptr) return;
+        for (uint32_t d = 0; d < LEVEL1_ENTRIES; ++d) {
+            TablePage* table = directory[d];
+            if (table == nullptr) continue;
+            for (uint32_t t = 0; t < LEVEL2_ENTRIES; ++t) {
+                if (table->entries[t] & PTE_PRESENT) visit(d, t, table->entries[t]);
+            }
+        }
+    }
+
+    uint32_t getTableCount() const { return table_count; }
+    uint32_t getLargePageCount() const { return large_count; }
+
+    // Present base-page PTEs in all page-table pages
+    uint32_t getMappedPageCount() const;
+
+    // Bytes used by the directories plus all allocated page-table pages
+    size_t getMemoryUsage() const;
+
+    // Directories and page-table pages (checkpoints); restore() fills an
+    // empty table
+    void save(CheckpointWriter& out) const;
+    void restore(CheckpointReader& in);
+};
+
+// Radix page table for 64-bit addresses, with 4 or 5 levels
+// The bottom two levels work like RadixPageTable: a directory entry points
+// at a page-table page of LEVEL2_ENTRIES packed PTEs or maps a large page,
+// so it spans LARGE_PAGE_SHIFT bits of address. Above it are levels of
+// 2^UPPER_LEVEL_BITS pointers each (x86-64's PML4/PDPT, plus PML5), which
+// cover another UPPER_LEVEL_BITS bits per level. Every node is allocated on
+// the first mapping below it and freed with the last one, so the table
+// grows with the mapped footprint, not with the address range.
+//
+// Pages are addressed by directory key (the page number's bits above the
+// table index) and table index. Walks report how many entries they read.
+class WideRadixPageTable {
+private:
+    static const uint32_t NODE_ENTRIES = 1u << UPPER_LEVEL_BITS;
+
+    struct TablePage {
+        uint32_t entries[LEVEL2_ENTRIES];
+        uint32_t present_count;
+    };
+
+    // A node of any level above the page-table pages. Directory nodes (the
+    // bottom one) point at TablePages and keep their large-page PDEs in a
+    // second array, allocated with the first large page.
+    struct Node {
+        void* entries[NODE_ENTRIES];   // Node, or TablePage in a directory node
+        uint32_t* large;               // NODE_ENTRIES PDEs, or nullptr
+        uint32_t used;                 // non-null entries plus large pages
+
+        Node() : entries(), large(nullptr), used(0) {}
+        ~Node() { delete[] large; }
+    };
+
+    uint32_t levels;          // 4 or 5, including the page-table pages
+    Node* root;
+    uint32_t node_counts[5];  // nodes per level, top level first
+    uint32_t table_count;
+    uint32_t large_count;
+    uint32_t large_arrays;    // directory nodes with a large-page array
+
+    uint32_t index(uint64_t directory_key, uint32_t depth) const {
+        return static_cast<uint32_t>(directory_key >> ((levels - 2 - depth) * UPPER_LEVEL_BITS)) &
+               (NODE_ENTRIES - 1);
+    }
+
+    // Directory node for the key, or nullptr; `read` counts the entries read
+    Node* findDirectory(uint64_t directory_key, uint32_t& read) const;
+
+    // Directory node for the key, allocating the path; fills in the path
+    Node* makeDirectory(uint64_t directory_key, Node** path);
+
+    // Frees empty nodes on the path, from the directory node up
+    void prune(uint64_t directory_key, Node** path);
+
+    void destroy(Node* node, uint32_t depth);
+    void collectLarge(const Node* node, uint32_t depth, uint64_t key, std::vector<uint64_t>& keys,
+                      std::vector<uint32_t>& pdes) const;
+
+    template <class Visitor>
+    void visitTables(Node* node, uint32_t depth, uint64_t key, Visitor& visit) {
+        for (uint32_t i = 0; i < NODE_ENTRIES; ++i) {
+            if (node->entries[i] == nullptr) continue;
+            uint64_t child_key = (key << UPPER_LEVEL_BITS) | i;
+            if (depth + 2 == levels) {
+                visit(child_key, *static_cast<TablePage*>(node->entries[i]));
+            } else {
+                visitTables(static_cast<Node*>(node->entries[i]), depth + 1, child_key, visit);
+            }
+        }
+    }
+
+public:
+    explicit WideRadixPageTable(uint32_t level_count);
+    ~WideRadixPageTable();
+
+    WideRadixPageTable(const WideRadixPageTable&) = delete;
+    void operator=(const WideRadixPageTable&) = delete;
+
+    uint32_t getLevels() const { return levels; }
+
+    // Returns the PTE for (directory key, table index), or nullptr when no
+    // page-table page exists for it. `read` is set to the number of entries
+    // the walk read: one per level down to the PTE, or down to the first
+    // empty entry.
+    uint32_t* walk(uint64_t directory_key, uint32_t table_index, uint32_t& read) {
+        Node* directory = findDirectory(directory_key, read);
+        if (directory == nullptr) return nullptr;
+        TablePage* table = static_cast<TablePage*>(directory->entries[index(directory_key, levels - 2)]);
+        if (table == nullptr) {
+            read++;
+            return nullptr;
+        }
+        read += 2;
+        return &table->entries[table_index];
+    }
+
+    // Returns the large-page PDE for a directory key, or nullptr when it
+    // does not map a large page; `read` as for walk()
+    uint32_t* walkLarge(uint64_t directory_key, uint32_t& read) {
+        Node* directory = findDirectory(directory_key, read);
+        if (directory == nullptr) return nullptr;
+        read++;
+        if (directory->large == nullptr) return nullptr;
+        uint32_t& pde = directory->large[index(directory_key, levels - 2)];
+        return (pde & PTE_PRESENT) ? &pde : nullptr;
+    }
+
+    bool hasTable(uint64_t directory_key) const {
+        uint32_t read;
+        Node* directory = findDirectory(directory_key, read);
+        return directory != nullptr && directory->entries[index(directory_key, levels - 2)] != nullptr;
+    }
+
+    // Same contracts as RadixPageTable's
+    void map(uint64_t directory_key, uint32_t table_index, uint32_t frame, uint32_t flags);
+    bool unmap(uint64_t directory_key, uint32_t table_index, uint32_t& frame);
+    bool mapLarge(uint64_t directory_key, uint32_t frame, uint32_t flags);
+    bool unmapLarge(uint64_t directory_key, uint32_t& frame);
+
+    // Calls visit(directory_key, table_index, pte) for every present
+    // base-page PTE, in address order; visit may change the PTE's flags
+    template <class Visitor>
+    void forEachPresent(Visitor visit) {
+        if (root == nullptr) return;
+        auto tables = [&](uint64_t directory_key, TablePage& table) {
+            for (uint32_t t = 0; t < LEVEL2_ENTRIES; ++t) {
+                if (table.entries[t] & PTE_PRESENT) visit(directory_key, t, table.entries[t]);
+            }
+        };
+        visitTables(root, 0, 0, tables);
+    }
+
+    // Page-table pages (level 1) and the nodes of level 2..levels
+    uint32_t getTableCount() const { return table_count; }
+    uint32_t getNodeCount(uint32_t level) const { return node_counts[levels - level]; }
+    uint32_t getLargePageCount() const { return large_count; }
+    uint32_t getMappedPageCount() const;
+
+    // Bytes used by all nodes, large-page arrays and page-table pages
+    size_t getMemoryUsage() const;
+
+    // Page-table pages and large pages by directory key (checkpoints); the
+    // nodes above them are rebuilt on restore(), which fills an empty table
+    void save(CheckpointWriter& out) const;
+    void restore(CheckpointReader& in);
+};
+
+#endif // PAGE_TABLE_H
@@ -0,0 +1,479 @@
+#ifndef PAGE_TABLE_LAYOUTS_H
+#define PAGE_TABLE_LAYOUTS_H
+
+#include <cstdint>
+#include <cstddef>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+#include "checkpoint.h"
+#include "config.h"
+#include "event_trace.h"
+#include "inverted_page_table.h"
+#include "page_table.h"
+#include "tlb.h"
+
+// Page-table layouts for TranslationEngine (translation_engine.h)
+// A layout is a class template over the base page shift. It keeps packed
+// PTEs (page_table.h) by virtual page number, and provides:
+//   NAME, SUMMARY_TITLE, EVENT_LOG     names for output, metrics, checkpoints
+//   ADDRESS_BITS                       width of the addresses it translates
+//   LARGE_PAGES                        directory entries can map large pages
+//   WALK_CACHE                         walks read directory entries the
+//                                      TLB's page-walk cache can hold
+//   SHARED_TABLE                       all tasks share one table, so a
+//                                      parallel replay runs in trace order
+//   runLength(first_page)              pages looked up as one run before
+//                                      their frames are allocated in bulk
+//   find(page)                         the PTE (maybe not present) or nullptr
+//   walk(page, tlb)                    find() after a TLB miss, recorded on
+//                                      the TLB with the entries it reads
+//   walkLarge(page, tlb)               the same for a large-page PDE; records
+//                                      nothing if there is none
+//   map, unmap, hasTable, directoryKey, the other large-page calls (stubs in
+//   layouts without them), reserve, forEachPresent, counts, printStats,
+//   getMemoryUsage, save and restore
+// Everything a layout computes from the page shift is a compile-time
+// constant.
+
+// Single-level layout: a hash map from virtual page to PTE, so only mapped
+// pages cost memory. A walk reads one entry; there are no directory entries
+// to cache and no large pages.
+template <uint32_t PAGE_SHIFT>
+class SingleLevelTable {
+private:
+    std::unordered_map<uint64_t, uint32_t> entries;
+
+    // A page table entry as stored in a checkpoint
+    struct SavedMapping {
+        uint64_t virtual_page;
+        uint32_t pte;
+        uint32_t unused;
+    };
+
+public:
+    static const char* const NAME;
+    static const char* const SUMMARY_TITLE;
+    static const EventLogMode EVENT_LOG = EVENT_LOG_SINGLE;
+    static const uint32_t ADDRESS_BITS = VIRTUAL_ADDRESS_BITS;
+    static const bool LARGE_PAGES = false;
+    static const bool WALK_CACHE = false;
+    static const bool SHARED_TABLE = false;
+
+    static uint32_t runLength(uint64_t) { return LEVEL2_ENTRIES; }
+    static uint64_t directoryKey(uint64_t) { return 0; }
+
+    uint32_t* find(uint64_t virtual_page) {
+        auto it = entries.find(virtual_page);
+        return it != entries.end() ? &it->second : nullptr;
+    }
+    uint32_t* walk(uint64_t virtual_page, TLB& tlb) {
+        tlb.walk(1, 0);
+        return find(virtual_page);
+    }
+
+    void map(uint64_t virtual_page, uint32_t frame, uint32_t flags) {
+        entries[virtual_page] = makePTE(frame, flags | PTE_PRESENT);
+    }
+    bool unmap(uint64_t virtual_page, uint32_t& frame) {
+        auto it = entries.find(virtual_page);
+        if (it == entries.end()) return false;
+        frame = pteFrame(it->second);
+        entries.erase(it);
+        return true;
+    }
+    bool hasTable(uint64_t) const { return true; }
+
+    // No large pages
+    uint32_t* findLarge(uint64_t) { return nullptr; }
+    uint32_t* walkLarge(uint64_t, TLB&) { return nullptr; }
+    bool mapLarge(uint64_t, uint32_t, uint32_t) { return false; }
+    bool unmapLarge(uint64_t, uint32_t&) { return false; }
+
+    // Calls visit(virtual_page, pte) for every mapping, in hash order; a
+    // fork reserves the parent's size first, so the child's order matches
+    void reserve(size_t pages) { entries.reserve(pages); }
+    template <class Visitor>
+    void forEachPresent(Visitor visit) {
+        for (auto it = entries.begin(); it != entries.end(); ++it) {
+            visit(it->first, it->second);
+        }
+    }
+
+    uint32_t getMappedPageCount() const { return static_cast<uint32_t>(entries.size()); }
+    uint32_t getLargePageCount() const { return 0; }
+    uint32_t getTableCount() const { return 0; }
+    void printStats() const {}
+
+    size_t getMemoryUsage() const {
+        // Bucket array plus one node (next pointer, key, value) per page
+        return entries.bucket_count() * sizeof(void*) +
+               entries.size() * (sizeof(void*) + sizeof(std::pair<const uint64_t, uint32_t>));
+    }
+
+    void save(CheckpointWriter& out) const {
+        out.put<uint64_t>(entries.bucket_count());
+        std::vector<SavedMapping> saved;
+        saved.reserve(entries.size());
+        for (auto it = entries.begin(); it != entries.end(); ++it) {
+            SavedMapping entry = {it->first, it->second, 0};
+            saved.push_back(entry);
+        }
+        out.putVector(saved);
+    }
+    void restore(CheckpointReader& in) {
+        uint64_t buckets = in.get<uint64_t>();
+        size_t count;
+        const SavedMapping* saved = in.getArray<SavedMapping>(count);
+        entries.clear();
+        if (buckets > entries.bucket_count()) entries.rehash(static_cast<size_t>(buckets));
+        // Inserted backwards, so the table iterates (fork) in the saved order
+        for (size_t i = count; i-- > 0;) {
+            entries[saved[i].virtual_page] = saved[i].pte;
+        }
+    }
+};
+
+template <uint32_t PAGE_SHIFT>
+const char* const SingleLevelTable<PAGE_SHIFT>::NAME = "single-level";
+template <uint32_t PAGE_SHIFT>
+const char* const SingleLevelTable<PAGE_SHIFT>::SUMMARY_TITLE = "Memory Access Summary";
+
+// Two-level layout over RadixPageTable: one directory entry spans
+// LARGE_PAGE_SIZE_KB, so the table index takes the bits between the page
+// offset and LARGE_PAGE_SHIFT. A walk reads the directory entry (unless the
+// page-walk cache has it) and then the PTE; a directory entry can instead
+// map one large page. Covers 32-bit addresses.
+template <uint32_t PAGE_SHIFT>
+class MultiLevelTable {
+private:
+    RadixPageTable table;
+
+public:
+    static const uint32_t ORDER = LARGE_PAGE_SHIFT - PAGE_SHIFT;   // base pages per large page, log2
+    static const uint32_t INDEX_MASK = (1u << ORDER) - 1;
+
+    static const char* const NAME;
+    static const char* const SUMMARY_TITLE;
+    static const EventLogMode EVENT_LOG = EVENT_LOG_MULTI;
+    static const uint32_t ADDRESS_BITS = 32;
+    static const bool LARGE_PAGES = true;
+    static const bool WALK_CACHE = true;
+    static const bool SHARED_TABLE = false;
+
+    // The pages up to the end of the directory entry
+    static uint32_t runLength(uint64_t first_page) {
+        return (INDEX_MASK + 1) - (static_cast<uint32_t>(first_page) & INDEX_MASK);
+    }
+    static uint64_t directoryKey(uint64_t virtual_page) { return directoryIndex(virtual_page); }
+    static uint32_t directoryIndex(uint64_t virtual_page) {
+        return static_cast<uint32_t>(virtual_page >> ORDER) & (LEVEL1_ENTRIES - 1);
+    }
+    static uint32_t tableIndex(uint64_t virtual_page) { return static_cast<uint32_t>(virtual_page) & INDEX_MASK; }
+
+    uint32_t* find(uint64_t virtual_page) {
+        return table.walk(directoryIndex(virtual_page), tableIndex(virtual_page));
+    }
+    uint32_t* walk(uint64_t virtual_page, TLB& tlb) {
+        uint32_t* pte = find(virtual_page);
+        tlb.walk(pte != nullptr ? 2 : 1, directoryIndex(virtual_page));
+        return pte;
+    }
+
+    void map(uint64_t virtual_page, uint32_t frame, uint32_t flags) {
+        table.map(directoryIndex(virtual_page), tableIndex(virtual_page), frame, flags);
+    }
+    // Also reclaims the page-table page once its last entry is gone
+    bool unmap(uint64_t virtual_page, uint32_t& frame) {
+        return table.unmap(directoryIndex(virtual_page), tableIndex(virtual_page), frame);
+    }
+    bool hasTable(uint64_t virtual_page) const { return table.hasTable(directoryIndex(virtual_page)); }
+
+    uint32_t* findLarge(uint64_t virtual_page) { return table.walkLarge(directoryIndex(virtual_page)); }
+    uint32_t* walkLarge(uint64_t virtual_page, TLB& tlb) {
+        uint32_t* pde = findLarge(virtual_page);
+        if (pde != nullptr) tlb.walk(1, directoryIndex(virtual_page));
+        return pde;
+    }
+    bool mapLarge(uint64_t virtual_page, uint32_t frame, uint32_t flags) {
+        return table.mapLarge(directoryIndex(virtual_page), frame, flags);
+    }
+    bool unmapLarge(uint64_t virtual_page, uint32_t& frame) {
+        return table.unmapLarge(directoryIndex(virtual_page), frame);
+    }
+
+    void reserve(size_t) {}
+    template <class Visitor>
+    void forEachPresent(Visitor visit) {
+        table.forEachPresent([&](uint32_t directory_index, uint32_t table_index, uint32_t& pte) {
+            visit((static_cast<uint64_t>(directory_index) << ORDER) | table_index, pte);
+        });
+    }
+
+    uint32_t getMappedPageCount() const { return table.getMappedPageCount(); }
+    uint32_t getLargePageCount() const { return table.getLargePageCount(); }
+    uint32_t getTableCount() const { return table.getTableCount(); }
+    void printStats() const {
+        std::cout << "Page Table Memory: " << table.getMemoryUsage() << " bytes (" << table.getTableCount()
+                  << " page tables)\n";
+        if (table.getLargePageCount() > 0) {
+            std::cout << "Large Pages: " << table.getLargePageCount() << " (" << LARGE_PAGE_SIZE_KB / 1024
+                      << " MB each)\n";
+        }
+    }
+
+    size_t getMemoryUsage() const { return table.getMemoryUsage(); }
+    void save(CheckpointWriter& out) const { table.save(out); }
+    void restore(CheckpointReader& in) { table.restore(in); }
+};
+
+template <uint32_t PAGE_SHIFT>
+const char* const MultiLevelTable<PAGE_SHIFT>::NAME = "multilevel";
+template <uint32_t PAGE_SHIFT>
+const char* const MultiLevelTable<PAGE_SHIFT>::SUMMARY_TITLE = "Multi-Level Page Table Memory Access Summary";
+
+// 4- and 5-level layouts over WideRadixPageTable, for 64-bit traces. The
+// bottom two levels match MultiLevelTable (a directory entry spans
+// LARGE_PAGE_SIZE_KB and can map a large page); each level above adds
+// UPPER_LEVEL_BITS, for 49- and 58-bit addresses. The page-walk cache holds
+// directory entries, so a hit leaves only the PTE to read. Walks and the
+// entries they read are counted for the summary.
+template <uint32_t LEVELS, uint32_t PAGE_SHIFT>
+class WideRadixTable {
+private:
+    WideRadixPageTable table;
+    uint64_t walks;
+    uint64_t walk_entries;
+
+    void countWalk(uint32_t read) {
+        walks++;
+        walk_entries += read;
+    }
+
+public:
+    static const uint32_t ORDER = LARGE_PAGE_SHIFT - PAGE_SHIFT;   // base pages per large page, log2
+    static const uint32_t INDEX_MASK = (1u << ORDER) - 1;
+
+    static const char* const NAME;
+    static const char* const SUMMARY_TITLE;
+    static const EventLogMode EVENT_LOG = EVENT_LOG_MULTI;
+    static const uint32_t ADDRESS_BITS = LARGE_PAGE_SHIFT + (LEVELS - 1) * UPPER_LEVEL_BITS;
+    static const bool LARGE_PAGES = true;
+    static const bool WALK_CACHE = true;
+    static const bool SHARED_TABLE = false;
+
+    WideRadixTable() : table(LEVELS), walks(0), walk_entries(0) {}
+
+    static uint32_t runLength(uint64_t first_page) {
+        return (INDEX_MASK + 1) - (static_cast<uint32_t>(first_page) & INDEX_MASK);
+    }
+    static uint64_t directoryKey(uint64_t virtual_page) { return virtual_page >> ORDER; }
+    static uint32_t tableIndex(uint64_t virtual_page) { return static_cast<uint32_t>(virtual_page) & INDEX_MASK; }
+
+    uint32_t* find(uint64_t virtual_page) {
+        uint32_t read;
+        return table.walk(directoryKey(virtual_page), tableIndex(virtual_page), read);
+    }
+    uint32_t* walk(uint64_t virtual_page, TLB& tlb) {
+        uint32_t read;
+        uint32_t* pte = table.walk(directoryKey(virtual_page), tableIndex(virtual_page), read);
+        tlb.walk(read, directoryKey(virtual_page), pte != nullptr);
+        countWalk(read);
+        return pte;
+    }
+
+    void map(uint64_t virtual_page, uint32_t frame, uint32_t flags) {
+        table.map(directoryKey(virtual_page), tableIndex(virtual_page), frame, flags);
+    }
+    // Also reclaims the page-table page, and the nodes above it, once empty
+    bool unmap(uint64_t virtual_page, uint32_t& frame) {
+        return table.unmap(directoryKey(virtual_page), tableIndex(virtual_page), frame);
+    }
+    bool hasTable(uint64_t virtual_page) const { return table.hasTable(directoryKey(virtual_page)); }
+
+    uint32_t* findLarge(uint64_t virtual_page) {
+        uint32_t read;
+        return table.walkLarge(directoryKey(virtual_page), read);
+    }
+    uint32_t* walkLarge(uint64_t virtual_page, TLB& tlb) {
+        uint32_t read;
+        uint32_t* pde = table.walkLarge(directoryKey(virtual_page), read);
+        if (pde != nullptr) {
+            tlb.walk(read, directoryKey(virtual_page), false);
+            countWalk(read);
+        }
+        return pde;
+    }
+    bool mapLarge(uint64_t virtual_page, uint32_t frame, uint32_t flags) {
+        return table.mapLarge(directoryKey(virtual_page), frame, flags);
+    }
+    bool unmapLarge(uint64_t virtual_page, uint32_t& frame) {
+        return table.unmapLarge(directoryKey(virtual_page), frame);
+    }
+
+    void reserve(size_t) {}
+    template <class Visitor>
+    void forEachPresent(Visitor visit) {
+        table.forEachPresent([&](uint64_t directory_key, uint32_t table_index, uint32_t& pte) {
+            visit((directory_key << ORDER) | table_index, pte);
+        });
+    }
+
+    uint32_t getMappedPageCount() const { return table.getMappedPageCount(); }
+    uint32_t getLargePageCount() const { return table.getLargePageCount(); }
+
+    // Page-table pages of every level
+    uint32_t getTableCount() const {
+        uint32_t count = table.getTableCount();
+        for (uint32_t level = 2; level <= LEVELS; ++level) {
+            count += table.getNodeCount(level);
+        }
+        return count;
+    }
+
+    void printStats() const {
+        std::cout << "Page Table Memory: " << table.getMemoryUsage() << " bytes (" << getTableCount()
+                  << " page tables:";
+        for (uint32_t level = LEVELS; level >= 2; --level) {
+            std::cout << " L" << level << " " << table.getNodeCount(level) << ",";
+        }
+        std::cout << " L1 " << table.getTableCount() << ")\n";
+        double depth = walks > 0 ? static_cast<double>(walk_entries) / walks : 0;
+        std::cout << "Page Walks: " << walks << " (average depth: " << depth << " entries)\n";
+        if (table.getLargePageCount() > 0) {
+            std::cout << "Large Pages: " << table.getLargePageCount() << " (" << LARGE_PAGE_SIZE_KB / 1024
+                      << " MB each)\n";
+        }
+    }
+
+    size_t getMemoryUsage() const { return table.getMemoryUsage(); }
+    void save(CheckpointWriter& out) const {
+        out.put<uint64_t>(walks);
+        out.put<uint64_t>(walk_entries);
+        table.save(out);
+    }
+    void restore(CheckpointReader& in) {
+        walks = in.get<uint64_t>();
+        walk_entries = in.get<uint64_t>();
+        table.restore(in);
+    }
+};
+
+template <uint32_t LEVELS, uint32_t PAGE_SHIFT>
+const char* const WideRadixTable<LEVELS, PAGE_SHIFT>::NAME = LEVELS == 4 ? "4-level" : "5-level";
+template <uint32_t LEVELS, uint32_t PAGE_SHIFT>
+const char* const WideRadixTable<LEVELS, PAGE_SHIFT>::SUMMARY_TITLE =
+    LEVELS == 4 ? "4-Level Page Table Memory Access Summary" : "5-Level Page Table Memory Access Summary";
+
+template <uint32_t PAGE_SHIFT>
+using FourLevelTable = WideRadixTable<4, PAGE_SHIFT>;
+template <uint32_t PAGE_SHIFT>
+using FiveLevelTable = WideRadixTable<5, PAGE_SHIFT>;
+
+// Inverted layout: the task's address space in the hashed inverted page
+// table (inverted_page_table.h), which is sized by physical memory rather
+// than by the task's footprint. A walk reads the anchor and the chain
+// entries up to the mapping; there are no directory entries to cache and no
+// large pages. The task's memory is its share of the table's entries; the
+// whole table is in its own summary section.
+template <uint32_t PAGE_SHIFT>
+class InvertedTable {
+private:
+    InvertedSpace space;
+    InvertedPageTable* table;   // the table, from the first use on
+    uint64_t walks;
+    uint64_t walk_entries;
+
+    InvertedPageTable& inverted() {
+        if (table == nullptr) table = &InvertedPageTable::getInstance();
+        return *table;
+    }
+
+public:
+    static const char* const NAME;
+    static const char* const SUMMARY_TITLE;
+    static const EventLogMode EVENT_LOG = EVENT_LOG_SINGLE;
+    static const uint32_t ADDRESS_BITS = VIRTUAL_ADDRESS_BITS;
+    static const bool LARGE_PAGES = false;
+    static const bool WALK_CACHE = false;
+    static const bool SHARED_TABLE = true;
+
+    InvertedTable() : table(nullptr), walks(0), walk_entries(0) {}
+    ~InvertedTable() {
+        if (table != nullptr) table->clear(space);
+    }
+
+    InvertedTable(const InvertedTable&) = delete;
+    void operator=(const InvertedTable&) = delete;
+
+    static uint32_t runLength(uint64_t) { return LEVEL2_ENTRIES; }
+    static uint64_t directoryKey(uint64_t) { return 0; }
+
+    uint32_t* find(uint64_t virtual_page) {
+        uint32_t probes;
+        return inverted().find(space, virtual_page, probes);
+    }
+    uint32_t* walk(uint64_t virtual_page, TLB& tlb) {
+        uint32_t probes;
+        uint32_t* pte = inverted().find(space, virtual_page, probes);
+        tlb.walk(probes, 0);
+        walks++;
+        walk_entries += probes;
+        return pte;
+    }
+
+    void map(uint64_t virtual_page, uint32_t frame, uint32_t flags) {
+        inverted().map(space, virtual_page, frame, flags);
+    }
+    bool unmap(uint64_t virtual_page, uint32_t& frame) { return inverted().unmap(space, virtual_page, frame); }
+    bool hasTable(uint64_t) const { return true; }
+
+    // No large pages
+    uint32_t* findLarge(uint64_t) { return nullptr; }
+    uint32_t* walkLarge(uint64_t, TLB&) { return nullptr; }
+    bool mapLarge(uint64_t, uint32_t, uint32_t) { return false; }
+    bool unmapLarge(uint64_t, uint32_t&) { return false; }
+
+    // Calls visit(virtual_page, pte) for every mapping, most recent first
+    void reserve(size_t) {}
+    template <class Visitor>
+    void forEachPresent(Visitor visit) {
+        if (table != nullptr) table->forEach(space, visit);
+    }
+
+    uint32_t getMappedPageCount() const { return space.pages; }
+    uint32_t getLargePageCount() const { return 0; }
+    uint32_t getTableCount() const { return 0; }
+    void printStats() const {
+        std::cout << "Page Table Memory: " << getMemoryUsage() << " bytes (" << space.pages
+                  << " inverted page table entries)\n";
+        if (walks > 0) {
+            std::cout << "Page Walks: " << walks
+                      << " (average probes: " << static_cast<double>(walk_entries) / walks << " entries)\n";
+        }
+    }
+
+    size_t getMemoryUsage() const { return static_cast<size_t>(space.pages) * InvertedPageTable::getEntrySize(); }
+    void save(CheckpointWriter& out) const {
+        out.put<uint32_t>(space.id);
+        out.put<uint32_t>(space.head);
+        out.put<uint32_t>(space.pages);
+        out.put<uint64_t>(walks);
+        out.put<uint64_t>(walk_entries);
+    }
+    void restore(CheckpointReader& in) {
+        space.id = in.get<uint32_t>();
+        space.head = in.get<uint32_t>();
+        space.pages = in.get<uint32_t>();
+        walks = in.get<uint64_t>();
+        walk_entries = in.get<uint64_t>();
+        if (space.pages > 0) inverted();
+    }
+};
+
+template <uint32_t PAGE_SHIFT>
+const char* const InvertedTable<PAGE_SHIFT>::NAME = "inverted";
+template <uint32_t PAGE_SHIFT>
+const char* const InvertedTable<PAGE_SHIFT>::SUMMARY_TITLE = "Inverted Page Table Memory Access Summary";
+
+#endif // PAGE_TABLE_LAYOUTS_H
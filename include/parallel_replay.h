@@ -0,0 +1,229 @@
+#ifndef PARALLEL_REPLAY_H
+#define PARALLEL_REPLAY_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "config.h"
+#include "memory_manager.h"
+#include "metrics.h"
+#include "shared_frames.h"
+#include "spsc_ring.h"
+#include "task_arena.h"
+#include "trace_reader.h"
+#include "window_stats.h"
+
+// Replays a trace with tasks sharded across worker threads
+// Tasks only share the physical frame pool, so each task is owned by one
+// worker (round-robin in order of first appearance) and its accesses are
+// replayed in trace order on that worker. A forked task goes to its
+// parent's worker, which runs the fork in order with the parent's accesses.
+//
+// The replay is pipelined: the calling thread reads the trace, creates the
+// tasks and routes each access to its worker in batches of
+// REPLAY_BATCH_SIZE, through one SPSC ring per worker. The workers start
+// right away and simulate while the trace is still being read. A worker's
+// ring holds REPLAY_QUEUE_BATCHES batches; when it is full the reader waits
+// for that worker, so memory stays bounded whatever the trace length.
+// Returns the number of records replayed. Metrics samples and live windows
+// are taken as the reader goes, so they show what the workers have done so
+// far.
+//
+// Replacement results are those of a serial run. The reader adds up the
+// most frames each record can take (Task::maxFrames); while that stays
+// within memory (MemoryManager::getDeferredFrames), no record can find
+// memory full and the workers run freely, stamping the pages they fault in
+// with the record's sequence number. From the first record that could
+// evict on, records take turns in trace order: the first one to run hands
+// the stamped pages to the replacement engine in order, and each one
+// passes the turn to the next when it is done, so past that point the
+// replay is no faster than a serial one. Tables that all tasks share are
+// only touched in turn, so the replay takes turns from the first record
+// with the inverted page table or shared regions, and from the first fork
+// otherwise.
+template <class Task>
+uint64_t replayParallel(TraceReader& reader, unsigned workers, TaskArena<Task>& tasks) {
+    struct Access {
+        Task* task;
+        Task* parent;   // fork of this task, instead of an access
+        uint64_t logical_address;
+        uint32_t size_in_bytes;
+        uint64_t sequence;   // position among the routed accesses
+    };
+    struct Batch {
+        Access accesses[REPLAY_BATCH_SIZE];
+        uint32_t count;
+    };
+    typedef SpscRing<Batch> Queue;
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    for (unsigned w = 0; w < workers; ++w) {
+        queues.push_back(std::unique_ptr<Queue>(new Queue(REPLAY_QUEUE_BATCHES)));
+    }
+
+    MemoryManager& mm = MemoryManager::getInstance();
+    mm.deferReplacement();
+    std::atomic<uint64_t> ordered_from(UINT64_MAX);   // first access replayed in trace order
+    std::atomic<uint64_t> deferred_done(0);           // accesses before it that are done
+    std::atomic<uint64_t> turn(0);                    // the access whose turn it is
+
+    std::vector<std::thread> threads;
+    for (unsigned w = 0; w < workers; ++w) {
+        threads.push_back(std::thread([w, &queues, &mm, &ordered_from, &deferred_done, &turn]() {
+            mm.attachThread(w);
+            Queue& queue = *queues[w];
+            for (;;) {
+                Batch* batch = queue.front();
+                if (batch == nullptr) {
+                    // Closed with nothing left: done. Otherwise wait for the reader.
+                    if (queue.isClosed() && queue.front() == nullptr) break;
+                    std::this_thread::yield();
+                    continue;
+                }
+                uint64_t done = 0;   // deferred accesses not counted in deferred_done yet
+                for (uint32_t i = 0; i < batch->count; ++i) {
+                    const Access& access = batch->accesses[i];
+                    bool in_order = access.sequence >= ordered_from.load(std::memory_order_acquire);
+                    if (in_order) {
+                        if (done > 0) {
+                            deferred_done.fetch_add(done, std::memory_order_release);
+                            done = 0;
+                        }
+                        uint64_t first = ordered_from.load(std::memory_order_relaxed);
+                        while (turn.load(std::memory_order_acquire) != access.sequence ||
+                               deferred_done.load(std::memory_order_acquire) != first) {
+                            std::this_thread::yield();
+                        }
+                        if (access.sequence == first) mm.orderReplacement();
+                    } else {
+                        mm.beginRecord(access.sequence);
+                    }
+
+                    if (access.parent) {
+                        access.task->forkFrom(*access.parent);
+                    } else {
+                        access.task->accessRange(access.logical_address, access.size_in_bytes);
+                    }
+
+                    if (in_order) {
+                        turn.store(access.sequence + 1, std::memory_order_release);
+                    } else {
+                        done++;
+                    }
+                }
+                if (done > 0) deferred_done.fetch_add(done, std::memory_order_release);
+                queue.pop();
+            }
+            mm.detachThread();
+        }));
+    }
+
+    // Frames the deferred accesses may still take: per worker with
+    // partitions, otherwise all of them in room[0]
+    bool partitioned = mm.isPartitioned();
+    std::vector<uint64_t> room(workers);
+    for (unsigned w = 0; w < workers; ++w) {
+        room[w] = mm.getDeferredFrames(w, workers);
+    }
+    uint64_t sequence = 0;
+
+    // Replays the accesses in trace order from the next one routed on
+    auto orderFromHere = [&]() {
+        if (sequence < ordered_from.load(std::memory_order_relaxed)) {
+            turn.store(sequence, std::memory_order_relaxed);
+            ordered_from.store(sequence, std::memory_order_release);
+        }
+    };
+
+    // The batch being filled for each worker (a reserved ring slot), or nullptr
+    std::vector<Batch*> open(workers, nullptr);
+    auto route = [&](unsigned w, Access access, uint64_t frames) {
+        if (sequence < ordered_from.load(std::memory_order_relaxed)) {
+            uint64_t& left = room[partitioned ? w : 0];
+            if (frames > left) {
+                orderFromHere();
+            } else {
+                left -= frames;
+            }
+        }
+        access.sequence = sequence++;
+
+        Batch* batch = open[w];
+        if (batch == nullptr) {
+            while ((batch = queues[w]->reserve()) == nullptr) {
+                // The worker may be waiting for its turn behind an access
+                // still in another worker's open batch
+                for (unsigned other = 0; other < workers; ++other) {
+                    if (open[other] != nullptr) {
+                        queues[other]->push();
+                        open[other] = nullptr;
+                    }
+                }
+                std::this_thread::yield();
+            }
+            batch->count = 0;
+            open[w] = batch;
+        }
+        batch->accesses[batch->count++] = access;
+        if (batch->count == REPLAY_BATCH_SIZE) {
+            queues[w]->push();
+            open[w] = nullptr;
+        }
+    };
+
+    // Tables all tasks share are only used in turn: the inverted page table
+    // from the start, the shared frames from the first fork on (or from the
+    // start, with shared regions)
+    if (Task::Table::SHARED_TABLE || SharedFrames::hasRegions()) orderFromHere();
+
+    std::vector<unsigned> owner;   // by task number
+    TraceRecord record;
+    uint64_t records = 0;
+    Metrics& metrics = Metrics::getInstance();
+    WindowStats& windows = WindowStats::getInstance();
+    while (reader.next(record)) {
+        if (metrics.sampleDue(++records)) {
+            metrics.sample(records, MemoryManager::getInstance().getAllocatedPageCount());
+        }
+        windows.add(record.task_index, records);
+        if (record.kind == TRACE_FORK) {
+            Task* parent;
+            Task* child = createForkedTask(tasks, record, parent);
+            if (child == nullptr) continue;
+            if (record.task_index >= owner.size()) owner.resize(record.task_index + 1);
+            owner[record.task_index] = parent ? owner[record.parent_index]
+                                              : static_cast<unsigned>((tasks.size() - 1) % workers);
+            if (parent) {
+                Access fork = {child, parent, 0, 0, 0};
+                orderFromHere();
+                route(owner[record.task_index], fork, 0);
+            }
+            continue;
+        }
+
+        Task* current = tasks.get(record.task_index);
+        if (current == nullptr) {
+            current = tasks.create(record.task_index, std::string(record.task_id, record.task_id_length));
+            if (record.task_index >= owner.size()) owner.resize(record.task_index + 1);
+            owner[record.task_index] = static_cast<unsigned>((tasks.size() - 1) % workers);
+        }
+        Access access = {current, nullptr, record.logical_address, record.size_in_bytes, 0};
+        route(owner[record.task_index], access, Task::maxFrames(record.size_in_bytes));
+    }
+
+    for (unsigned w = 0; w < workers; ++w) {
+        if (open[w] != nullptr) queues[w]->push();
+        queues[w]->close();
+    }
+    for (size_t i = 0; i < threads.size(); ++i) {
+        threads[i].join();
+    }
+    // Memory never filled: the engine still needs the pages, for its counters
+    mm.orderReplacement();
+    return records;
+}
+
+#endif // PARALLEL_REPLAY_H
@@ -0,0 +1,136 @@
+#ifndef REPLACEMENT_H
+#define REPLACEMENT_H
+
+#include <cstdint>
+#include <string>
+
+class CheckpointWriter;
+class CheckpointReader;
+
+#define PAGE_OWNER_SHARED 0xFFFFFFFEu   // owner index of the SharedFrames table
+
+// Anything that maps physical frames (the tasks). The replacement engine
+// calls back into the owner to take a page away from it.
+class PageOwner {
+private:
+    uint32_t owner_index;
+
+public:
+    explicit PageOwner(uint32_t index) : owner_index(index) {}
+    virtual ~PageOwner() {}
+
+    // The task number (TraceRecord's task_index), or PAGE_OWNER_SHARED;
+    // unlike the owner's address, the same in every run
+    uint32_t getOwnerIndex() const { return owner_index; }
+
+    // Drop the mapping for virtual_page (page table entry and TLB entry).
+    // The frame itself is reclaimed by the memory manager.
+    virtual void evictPage(uint64_t virtual_page) = 0;
+};
+
+// Page replacement policies, selectable at runtime
+enum ReplacementPolicy {
+    REPLACE_FIFO,    // evict the oldest resident page
+    REPLACE_CLOCK,   // second chance: referenced pages go round again
+    REPLACE_LRU,     // LRU approximation: active/inactive lists aged by accessed bits
+    REPLACE_ARC      // adaptive replacement (CAR: ARC driven by accessed bits)
+};
+
+#define FRAME_NONE 0xFFFFFFFFu
+
+// Reverse map entry, one per physical frame
+// Links thread the frame onto the replacement engine's lists. Only the
+// thread running the engine changes them; other threads only set the
+// accessed bit.
+struct FrameEntry {
+    PageOwner* owner;        // nullptr = not resident (free or unevictable)
+    uint64_t virtual_page;
+    uint32_t prev;
+    uint32_t next;
+    uint8_t accessed;        // set on every access, cleared by the policy
+    uint8_t list;            // policy-specific list the frame is on
+    uint8_t large;           // first frame of a large page (evicted as a whole)
+
+    FrameEntry() : owner(nullptr), virtual_page(0), prev(FRAME_NONE), next(FRAME_NONE),
+                   accessed(0), list(0), large(0) {}
+};
+
+// Per-policy counters
+struct ReplacementStats {
+    uint64_t faults;           // pages brought in
+    uint64_t evictions;        // pages taken back
+    uint64_t second_chances;   // referenced pages spared by clearing their accessed bit
+    uint64_t ghost_hits;       // ARC: faults on recently evicted pages
+
+    ReplacementStats() : faults(0), evictions(0), second_chances(0), ghost_hits(0) {}
+
+    void add(const ReplacementStats& other);
+};
+
+// Intrusive doubly linked list of frames (head = oldest)
+class FrameList {
+private:
+    FrameEntry* table;
+    uint32_t head;
+    uint32_t tail;
+    uint32_t count;
+
+public:
+    explicit FrameList(FrameEntry* frame_table)
+        : table(frame_table), head(FRAME_NONE), tail(FRAME_NONE), count(0) {}
+
+    void pushBack(uint32_t frame);
+    void remove(uint32_t frame);
+
+    uint32_t front() const { return head; }
+    uint32_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    // The links live in the frame table; these save the ends and the count
+    void save(CheckpointWriter& out) const;
+    void restore(CheckpointReader& in);
+};
+
+// Replacement engine: tracks resident frames and picks victims
+// Every operation is O(1) (amortized for the policies that skip referenced
+// pages: each skip clears an accessed bit that only a later access can set
+// again). Engines are not thread-safe; the memory manager runs one for all
+// threads, one record at a time once memory can fill (memory_manager.h).
+class ReplacementEngine {
+protected:
+    FrameEntry* table;
+    ReplacementStats stats;
+
+public:
+    explicit ReplacementEngine(FrameEntry* frame_table) : table(frame_table) {}
+    virtual ~ReplacementEngine() {}
+
+    // A page was faulted into `frame` (its entry is already filled in)
+    virtual void insert(uint32_t frame) = 0;
+
+    // The page in `frame` was released by its owner
+    virtual void remove(uint32_t frame) = 0;
+
+    // Picks a victim and unlinks it; returns false if nothing is resident
+    virtual bool selectVictim(uint32_t& frame) = 0;
+
+    // The pages were inserted after the fact, in fault order, and up to
+    // `pages` of them were resident at once before then
+    virtual void notePeakResident(uint32_t) {}
+
+    const ReplacementStats& getStats() const { return stats; }
+
+    // Counters and list state (checkpoints); the frame table is saved by
+    // the memory manager. Owners in the engine are written as ids.
+    virtual void save(CheckpointWriter& out) const;
+    virtual void restore(CheckpointReader& in);
+
+    static ReplacementEngine* create(ReplacementPolicy policy, FrameEntry* frame_table);
+};
+
+const char* replacementPolicyName(ReplacementPolicy policy);
+
+// Parses "fifo", "clock" (or "second-chance"), "lru" or "arc"
+bool parseReplacementPolicy(const std::string& name, ReplacementPolicy& policy);
+
+#endif // REPLACEMENT_H
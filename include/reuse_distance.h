@@ -0,0 +1,82 @@
+#ifndef REUSE_DISTANCE_H
+#define REUSE_DISTANCE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Stack distance of an access that has no earlier access to its key
+#define STACK_DISTANCE_COLD UINT32_MAX
+
+// LRU stack distances of a stream of keys (Bennett-Kruskal)
+// The distance of an access is the number of distinct other keys accessed
+// since the previous access to the same key: a fully associative LRU cache
+// of C entries hits exactly the accesses at distance below C. Every key
+// marks the time slot of its latest access in a Fenwick tree, so the
+// distance is the number of marks after that slot, found in O(log n).
+// Slots are renumbered once the tree is full, which keeps it at a few
+// times the number of keys however long the stream is.
+//
+// Keys are dense numbers 0, 1, 2, ... handed out by the caller; a key equal
+// to getKeyCount() is a new one.
+class StackDistance {
+private:
+    std::vector<uint32_t> tree;       // Fenwick tree of marks, 1-based
+    std::vector<uint32_t> slot_key;   // key whose access took each slot
+    std::vector<uint32_t> last_slot;  // key -> slot of its latest access
+    uint32_t next_slot;
+
+    uint32_t countUpTo(uint32_t slot) const;   // marks in slots [0, slot]
+    void mark(uint32_t slot, int32_t delta);
+    void compact();
+
+public:
+    StackDistance();
+
+    // Records an access to key; returns its stack distance, or
+    // STACK_DISTANCE_COLD for the first access
+    uint32_t access(uint32_t key);
+
+    uint32_t getKeyCount() const { return static_cast<uint32_t>(last_slot.size()); }
+};
+
+// Miss-ratio curve of a fully associative LRU cache, from stack distances
+// A histogram of distances: misses(C) counts the cold accesses and those at
+// distance C or more. Curves of separate streams add up to the misses of
+// separate caches of the same size.
+class MissRatioCurve {
+private:
+    std::vector<uint64_t> distances;   // accesses at each distance
+    uint64_t accesses;
+    uint64_t cold;
+
+public:
+    MissRatioCurve() : accesses(0), cold(0) {}
+
+    void record(uint32_t distance) {
+        accesses++;
+        if (distance == STACK_DISTANCE_COLD) {
+            cold++;
+            return;
+        }
+        if (distance >= distances.size()) distances.resize(distance + 1, 0);
+        distances[distance]++;
+    }
+    void add(const MissRatioCurve& other);
+
+    uint64_t getAccesses() const { return accesses; }
+    uint64_t getColdMisses() const { return cold; }
+
+    // Smallest cache size that only takes cold misses
+    uint32_t getMaxUsefulSize() const { return static_cast<uint32_t>(distances.size()); }
+
+    // Misses of a cache with `entries` entries, for each of the given sizes
+    // (ascending), in one pass over the histogram
+    std::vector<uint64_t> misses(const std::vector<uint32_t>& entries) const;
+};
+
+// Cache sizes to report a curve at, up to and including max_entries: every
+// size below 16, then 16 sizes per power of two (within 6.25% of any size)
+std::vector<uint32_t> missRatioSizes(uint32_t max_entries);
+
+#endif // REUSE_DISTANCE_H
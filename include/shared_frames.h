@@ -0,0 +1,111 @@
+#ifndef SHARED_FRAMES_H
+#define SHARED_FRAMES_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "page_size.h"
+#include "replacement.h"
+
+class CheckpointWriter;
+class CheckpointReader;
+
+// Counters for shared mappings and copy-on-write
+struct SharingStats {
+    uint64_t region_faults;    // shared-region faults that brought a frame in
+    uint64_t region_attaches;  // shared-region faults served by a resident frame
+    uint64_t forks;
+    uint64_t fork_mappings;    // pages a fork mapped instead of copying
+    uint64_t cow_copies;       // COW faults that copied the frame
+    uint64_t cow_reuses;       // COW faults on a frame nobody else maps any more
+    uint64_t peak_saved;       // most frames saved at any one time
+
+    SharingStats() : region_faults(0), region_attaches(0), forks(0), fork_mappings(0),
+                     cow_copies(0), cow_reuses(0), peak_saved(0) {}
+};
+
+// Physical frames mapped by more than one task
+// A frame is shared when it backs a page of a shared region (a shared
+// library: every task that touches the page maps the same frame) or when a
+// fork copied the page table that maps it. The table then owns the frame in
+// the memory manager's reverse map, with the frame number as its virtual
+// page, and keeps every (task, virtual page) that maps it: evicting the
+// frame unmaps it from all of them. A region frame is freed with its last
+// mapping; a forked frame goes back to its last task as a private page once
+// the others have copied it.
+//
+// The trace does not tell loads from stores. Accesses to a shared region
+// are taken as reads (library text) and all other accesses as writes, so a
+// forked page is copied on the first access by either side after the fork.
+//
+// There is one table for the run. A parallel replay takes turns in trace
+// order from the first fork on, or from the start with shared regions, so
+// the table is only used by one thread at a time (parallel_replay.h).
+class SharedFrames : public PageOwner {
+private:
+    struct Mapping {
+        PageOwner* owner;
+        uint64_t virtual_page;
+    };
+
+    struct Frame {
+        std::vector<Mapping> mappings;
+        bool region;            // backs a page of a shared region
+        uint64_t region_page;   // that page
+    };
+
+    std::unordered_map<uint32_t, Frame> frames;            // by frame number
+    std::unordered_map<uint64_t, uint32_t> region_frames;  // region page -> frame
+    uint64_t saved;        // mappings beyond the first, summed over all frames
+    SharingStats stats;
+
+    static std::vector<AddressRange> regions;
+
+    SharedFrames() : PageOwner(PAGE_OWNER_SHARED), saved(0) {}
+
+    void addMapping(Frame& frame, PageOwner* owner, uint64_t virtual_page);
+
+public:
+    // Address ranges whose pages all tasks share; set before replay starts
+    static void setRegions(const std::vector<AddressRange>& shared_regions);
+    static bool hasRegions() { return !regions.empty(); }
+    static bool inRegion(uint64_t address);
+    static bool overlapsRegion(uint64_t start, uint64_t end);
+
+    static SharedFrames& getInstance();
+
+    SharedFrames(const SharedFrames&) = delete;
+    void operator=(const SharedFrames&) = delete;
+
+    // Frame for owner's virtual_page in a shared region: the resident one,
+    // or a newly allocated one (which may evict a page)
+    uint32_t mapRegionPage(PageOwner* owner, uint64_t virtual_page);
+
+    // Fork: owner maps a resident frame too. A private frame becomes shared,
+    // with its current owner as the first mapping.
+    void share(uint32_t frame, PageOwner* owner, uint64_t virtual_page);
+    void countFork(uint32_t mappings);
+
+    // Drops owner's mapping of the frame. Returns false if the frame is not
+    // shared: the caller owns it and frees it itself.
+    bool unmap(uint32_t frame, PageOwner* owner, uint64_t virtual_page);
+
+    // Write to a copy-on-write mapping of the frame: returns the frame owner
+    // maps from now on, either a copy or the frame itself if nobody else
+    // maps it any more. Copying may evict a page.
+    uint32_t breakCOW(uint32_t frame, PageOwner* owner, uint64_t virtual_page);
+
+    // Called by the memory manager when it takes the frame back (shared
+    // frames are registered with their own frame number as the page)
+    void evictPage(uint64_t frame) override;
+
+    // Prints nothing if no region is configured and the trace has no forks
+    void printStats() const;
+
+    // Checkpoints of a serial run; owners are written as ids, this table
+    // itself as CHECKPOINT_OWNER_SHARED
+    void save(CheckpointWriter& out) const;
+    void restore(CheckpointReader& in);
+};
+
+#endif // SHARED_FRAMES_H
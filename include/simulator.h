@@ -0,0 +1,192 @@
+#ifndef SIMULATOR_H
+#define SIMULATOR_H
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "cpu_tlb.h"
+#include "event_trace.h"
+#include "memory_manager.h"
+#include "metrics.h"
+#include "options.h"
+#include "page_table_layouts.h"
+#include "parallel_replay.h"
+#include "shared_frames.h"
+#include "simulator_state.h"
+#include "swap.h"
+#include "task_arena.h"
+#include "trace_reader.h"
+#include "translation_engine.h"
+#include "window_stats.h"
+
+// The simulator: replays a trace with one TranslationEngine instantiation.
+// All executables parse the same options and call runSimulator(), which
+// picks the page-table layout (--page-table, or the executable's default)
+// and runLayout() then picks the instantiation for the page size. Each
+// layout is instantiated in its own translation unit (simulator_*.cpp);
+// adding one means a layout class, a run function and a PageTableKind.
+
+// Replays one trace record
+template <class Task>
+void processRecord(const TraceRecord& record, TaskArena<Task>& tasks) {
+    if (record.kind == TRACE_FORK) {
+        Task* parent;
+        Task* child = createForkedTask(tasks, record, parent);
+        if (child != nullptr && parent != nullptr) {
+            child->forkFrom(*parent);
+        }
+        return;
+    }
+
+    Task* current = tasks.get(record.task_index);
+    if (current == nullptr) {
+        current = tasks.create(record.task_index, std::string(record.task_id, record.task_id_length));
+    }
+
+    // Simulate access for all pages covered by this memory region
+    current->accessRange(record.logical_address, record.size_in_bytes);
+}
+
+// Reads the entire trace file and processes each record; with a checkpoint,
+// only up to the checkpoint. Prints the statistics. Returns false if the
+// trace or a checkpoint can't be used.
+template <class Task>
+bool replayTrace(const SimOptions& options) {
+    const char* kind = Task::Table::NAME;
+    TraceReader reader;
+    if (!reader.open(options.trace_file)) {
+        return false;
+    }
+    // Checkpoints locate the trace position and task IDs by file offset
+    if (reader.isStreaming() && (!options.checkpoint_file.empty() || !options.restore_file.empty())) {
+        std::cerr << "--checkpoint and --restore need a trace file, not a stream" << std::endl;
+        return false;
+    }
+
+    TraceRecord record;
+    TaskArena<Task> tasks;
+    uint64_t records = 0;
+
+    if (!options.restore_file.empty() &&
+        !restoreSimulatorState(options.restore_file, options, kind, reader, tasks, records)) {
+        return false;
+    }
+
+    Metrics& metrics = Metrics::getInstance();
+    WindowStats& windows = WindowStats::getInstance();
+    windows.start(records, options.window_records, options.window_seconds);
+    if (options.threads > 1) {
+        records = replayParallel(reader, options.threads, tasks);
+    } else {
+        while ((options.checkpoint_at == 0 || records < options.checkpoint_at) && reader.next(record)) {
+            processRecord(record, tasks);
+            if (metrics.sampleDue(++records)) {
+                metrics.sample(records, MemoryManager::getInstance().getAllocatedPageCount());
+            }
+            windows.add(record.task_index, records);
+        }
+    }
+    windows.finish(records);
+
+    if (!options.checkpoint_file.empty()) {
+        if (!saveSimulatorState(options.checkpoint_file, options, kind, reader, tasks, records)) {
+            return false;
+        }
+        std::cout << "Checkpoint after " << records << " records: " << options.checkpoint_file << "\n";
+    }
+
+    // Print stats for all tasks, ordered by task ID
+    std::cout << "\n=== " << Task::Table::SUMMARY_TITLE << " ===\n";
+    std::vector<Task*> sorted;
+    for (size_t i = 0; i < tasks.size(); ++i) {
+        sorted.push_back(tasks.at(i));
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const Task* a, const Task* b) { return a->getId() < b->getId(); });
+    for (size_t i = 0; i < sorted.size(); ++i) {
+        sorted[i]->printStats();
+    }
+
+    CpuTLBs::getInstance().printStats();
+    CpuTLBs::getInstance().printTranslationCost(tasks.getTranslationStats());
+    SharedFrames::getInstance().printStats();
+    InvertedPageTable::printStats();
+    MemoryManager::getInstance().printReplacementStats();
+    SwapDevice::getInstance().printStats();
+    tasks.printMemoryUsage(reader.getTaskTableMemoryUsage());
+
+    if (metrics.isExporting()) {
+        MetricsTotals totals;
+        totals.records = records;
+        totals.frames_in_use = MemoryManager::getInstance().getAllocatedPageCount();
+        totals.frames_total = MemoryManager::getInstance().getTotalPageCount();
+        totals.translation = tasks.getTranslationStats();
+        CpuTLBs::getInstance().addTranslationStats(totals.translation);
+        totals.translation_cycles = totals.translation.cycles(TLB::getDefaultConfig());
+        return metrics.write(totals, tasks.getTaskMetrics());
+    }
+    return true;
+}
+
+// Runs the simulator with one page-table layout, instantiated for the page
+// size of the run; returns the exit status
+template <template <uint32_t> class PageTable>
+int runLayout(SimOptions& options) {
+    typedef PageTable<LARGE_PAGE_SHIFT - 10> Layout;   // the traits don't depend on the page size
+    if (!Layout::WALK_CACHE) {
+        // No directory entries to cache
+        options.tlb.walk_cache_entries = 0;
+    }
+    applyOptions(options);
+
+    if (!Layout::LARGE_PAGES && options.pages.usesLargePages()) {
+        std::cerr << "Large pages need a radix page table; ignoring --large-pages" << std::endl;
+    }
+
+    if (!options.event_file.empty() &&
+        !EventTracer::getInstance().open(options.event_file, Layout::EVENT_LOG, options.pages.page_size_kb)) {
+        return 1;
+    }
+    if (options.swap_bytes > 0 &&
+        !SwapDevice::getInstance().configure(options.swap_bytes, options.pages.page_size_kb, options.swap_file,
+                                             options.swap_threads)) {
+        return 1;
+    }
+    if (!options.metrics_file.empty() &&
+        !Metrics::getInstance().open(options.metrics_file, options.metrics_format, options.metrics_every,
+                                     Layout::NAME)) {
+        return 1;
+    }
+    // Windows are computed from the metrics counters
+    if ((options.window_records > 0 || options.window_seconds > 0) && !Metrics::getInstance().start(Layout::NAME)) {
+        return 1;
+    }
+
+    // Page sizes 4KB-64KB (PageSizeConfig::validate)
+    bool replayed = false;
+    switch (options.pages.pageShift()) {
+        case 12: replayed = replayTrace<TranslationEngine<PageTable, 12> >(options); break;
+        case 13: replayed = replayTrace<TranslationEngine<PageTable, 13> >(options); break;
+        case 14: replayed = replayTrace<TranslationEngine<PageTable, 14> >(options); break;
+        case 15: replayed = replayTrace<TranslationEngine<PageTable, 15> >(options); break;
+        case 16: replayed = replayTrace<TranslationEngine<PageTable, 16> >(options); break;
+        default: std::cerr << "Unsupported page size: " << options.pages.page_size_kb << "KB" << std::endl;
+    }
+    EventTracer::getInstance().close();
+    return replayed ? 0 : 1;
+}
+
+// One per layout (simulator_single.cpp, simulator_multi.cpp,
+// simulator_4level.cpp, simulator_5level.cpp, simulator_inverted.cpp)
+int runSingleLevel(SimOptions& options);
+int runMultiLevel(SimOptions& options);
+int runFourLevel(SimOptions& options);
+int runFiveLevel(SimOptions& options);
+int runInverted(SimOptions& options);
+
+// main() of every executable: parses the options and runs the layout
+// chosen with --page-table, or default_layout
+int runSimulator(int argc, char* argv[], PageTableKind default_layout);
+
+#endif // SIMULATOR_H
@@ -0,0 +1,155 @@
+#ifndef SIMULATOR_STATE_H
+#define SIMULATOR_STATE_H
+
+#include <cstdint>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "checkpoint.h"
+#include "cpu_tlb.h"
+#include "inverted_page_table.h"
+#include "memory_manager.h"
+#include "options.h"
+#include "shared_frames.h"
+#include "swap.h"
+#include "task_arena.h"
+#include "trace_reader.h"
+
+// Whole-simulator checkpoints of a serial replay (checkpoint.h)
+// Sections, in order: OPTS (the options that shape the state), TRCE (trace
+// position), TIDS (tasks in order of creation), MMGR, SHRD, IPTB (the
+// inverted page table, if used), SWAP, CPUT, then one TASK per task. A restore re-creates the tasks in the same order, so they
+// register with the CPU TLBs and the event log exactly as they did the
+// first time, and then fills everything in.
+
+// The options a checkpoint depends on, as text: a restore must use the same
+// ones. TLB costs, the event log and the checkpoint options may differ.
+inline std::string checkpointFingerprint(const SimOptions& options, const char* kind) {
+    std::ostringstream text;
+    text << kind << " memory=" << options.memory_bytes << " page=" << options.pages.page_size_kb << "KB"
+         << " replacement=" << options.replacement << " swap=" << options.swap_bytes << " tlb=" << options.tlb.sets << "x" << options.tlb.ways
+         << "/" << options.tlb.policy << " large-entries=" << options.tlb.large_entries << " l2="
+         << options.tlb.l2_sets << "x" << options.tlb.l2_ways << " walk-cache=" << options.tlb.walk_cache_entries
+         << " shared-tlb=" << options.cpu_tlb.cpus << "/" << options.cpu_tlb.mode << "/" << options.cpu_tlb.asids
+         << " large-pages=" << (options.pages.large_everywhere ? "all" : "");
+    for (size_t i = 0; i < options.pages.large_regions.size(); ++i) {
+        text << std::hex << options.pages.large_regions[i].start << "-" << options.pages.large_regions[i].end
+             << std::dec << ",";
+    }
+    text << " shared-regions=";
+    for (size_t i = 0; i < options.shared_regions.size(); ++i) {
+        text << std::hex << options.shared_regions[i].start << "-" << options.shared_regions[i].end << std::dec
+             << ",";
+    }
+    return text.str();
+}
+
+// Writes the state after `records` trace records to the checkpoint file.
+// Prints an error and returns false on failure.
+template <class Task>
+bool saveSimulatorState(const std::string& filename, const SimOptions& options, const char* kind,
+                        const TraceReader& reader, const TaskArena<Task>& tasks, uint64_t records) {
+    CheckpointWriter out;
+    if (!out.open(filename, records)) return false;
+
+    out.beginSection("OPTS");
+    out.putString(checkpointFingerprint(options, kind));
+    out.endSection();
+
+    reader.save(out);
+
+    // Tasks are owners n = 0, 1, 2, ... in order of creation
+    for (size_t n = 0; n < tasks.size(); ++n) {
+        out.setOwnerId(tasks.at(n), static_cast<uint32_t>(n));
+    }
+    // Their task numbers (all below the reader's task count)
+    std::vector<uint32_t> task_indexes(tasks.size());
+    for (uint32_t index = 0; index < reader.getTaskCount(); ++index) {
+        Task* task = tasks.get(index);
+        if (task != nullptr) task_indexes[out.ownerId(task)] = index;
+    }
+    out.beginSection("TIDS");
+    out.putVector(task_indexes);
+    for (size_t n = 0; n < tasks.size(); ++n) {
+        out.putString(tasks.at(n)->getId());
+    }
+    out.endSection();
+    out.setOwnerId(&SharedFrames::getInstance(), CHECKPOINT_OWNER_SHARED);
+
+    bool saved = MemoryManager::getInstance().save(out);
+    SharedFrames::getInstance().save(out);
+    InvertedPageTable::save(out);
+    SwapDevice::getInstance().save(out);
+    CpuTLBs::getInstance().save(out);
+    for (size_t n = 0; n < tasks.size(); ++n) {
+        tasks.at(n)->save(out);
+    }
+    if (!out.close() || !saved) {
+        std::cerr << "Error writing checkpoint: " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Restores the state saved by saveSimulatorState into a fresh simulator:
+// the reader has just opened the same trace and tasks is empty. Sets
+// records to the records replayed before the checkpoint. Prints an error
+// and returns false if the checkpoint does not match the options or trace.
+template <class Task>
+bool restoreSimulatorState(const std::string& filename, const SimOptions& options, const char* kind,
+                           TraceReader& reader, TaskArena<Task>& tasks, uint64_t& records) {
+    CheckpointReader in;
+    if (!in.open(filename)) return false;
+    records = in.getRecords();
+
+    if (!in.beginSection("OPTS")) {
+        std::cerr << "Corrupt checkpoint: " << filename << std::endl;
+        return false;
+    }
+    std::string saved_options = in.getString();
+    std::string current_options = checkpointFingerprint(options, kind);
+    in.endSection();
+    if (saved_options != current_options) {
+        std::cerr << "Checkpoint was made with different options:\n  checkpoint: " << saved_options
+                  << "\n  this run:   " << current_options << std::endl;
+        return false;
+    }
+
+    reader.restore(in);
+    if (!in.ok()) {
+        std::cerr << "Checkpoint was made from a different trace: " << filename << std::endl;
+        return false;
+    }
+
+    if (in.beginSection("TIDS")) {
+        std::vector<uint32_t> task_indexes;
+        in.getVector(task_indexes);
+        for (size_t n = 0; n < task_indexes.size() && in.ok(); ++n) {
+            std::string id = in.getString();
+            if (task_indexes[n] >= reader.getTaskCount() || tasks.get(task_indexes[n]) != nullptr) {
+                in.fail();
+                break;
+            }
+            in.setOwner(static_cast<uint32_t>(n), tasks.create(task_indexes[n], id));
+        }
+        in.endSection();
+    }
+    in.setSharedOwner(&SharedFrames::getInstance());
+
+    if (in.ok() && !MemoryManager::getInstance().restore(in)) in.fail();
+    SharedFrames::getInstance().restore(in);
+    InvertedPageTable::restore(in);
+    SwapDevice::getInstance().restore(in);
+    CpuTLBs::getInstance().restore(in);
+    for (size_t n = 0; n < tasks.size(); ++n) {
+        tasks.at(n)->restore(in);
+    }
+    if (!in.ok()) {
+        std::cerr << "Corrupt checkpoint: " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+#endif // SIMULATOR_STATE_H
@@ -0,0 +1,70 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Bounded single-producer, single-consumer queue of reusable slots
+// The producer fills the slot at the tail in place and publishes it with
+// push(); the consumer reads the slot at the head and hands it back with
+// pop(), so slots are never copied or allocated after construction. head
+// and tail only grow (a slot is counter & mask) and each is written by one
+// side only; they sit on separate cache lines so the two threads do not
+// bounce a line on every operation. A full ring makes the producer wait,
+// which bounds how far it can run ahead of the consumer.
+template <class T>
+class SpscRing {
+private:
+    static const size_t CACHE_LINE = 64;
+
+    std::vector<T> slots;
+    size_t mask;
+    char pad_head[CACHE_LINE];
+    std::atomic<size_t> head;    // next slot to consume (consumer writes)
+    char pad_tail[CACHE_LINE];
+    std::atomic<size_t> tail;    // next slot to publish (producer writes)
+    std::atomic<bool> closed;    // producer is done; set after its last push()
+    char pad_end[CACHE_LINE];
+
+public:
+    // capacity must be a power of two
+    explicit SpscRing(size_t capacity)
+        : slots(capacity), mask(capacity - 1), head(0), tail(0), closed(false) {}
+
+    SpscRing(const SpscRing&) = delete;
+    void operator=(const SpscRing&) = delete;
+
+    // Producer: the slot to fill next, or nullptr while the ring is full
+    T* reserve() {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == slots.size()) return nullptr;
+        return &slots[t & mask];
+    }
+
+    // Producer: publishes the slot returned by reserve()
+    void push() {
+        tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Producer: no more slots will be pushed
+    void close() { closed.store(true, std::memory_order_release); }
+
+    // Consumer: the oldest published slot, or nullptr if there is none
+    T* front() {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) return nullptr;
+        return &slots[h & mask];
+    }
+
+    // Consumer: returns the slot from front() to the producer
+    void pop() {
+        head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Consumer: true once the producer has closed the ring; anything it
+    // pushed before is visible to front() by then
+    bool isClosed() const { return closed.load(std::memory_order_acquire); }
+};
+
+#endif // SPSC_RING_H
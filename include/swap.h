@@ -0,0 +1,164 @@
+#ifndef SWAP_H
+#define SWAP_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "frame_allocator.h"
+
+class CheckpointWriter;
+class CheckpointReader;
+
+// Counters of the swap device
+struct SwapStats {
+    uint64_t swap_outs;        // evicted pages given a slot
+    uint64_t swap_ins;         // pages read back from the file (major faults)
+    uint64_t cache_hits;       // faults on pages whose write was still batched (minor)
+    uint64_t discards;         // swapped pages freed by the task without being read
+    uint64_t full;             // evictions that found no free slot (page dropped)
+    uint64_t batches;          // write batches handed to the I/O threads
+    uint64_t writes;           // write requests: runs of contiguous slots in a batch
+    uint64_t io_errors;        // failed transfers and pages read back with the wrong contents
+    uint64_t peak_slots;
+    uint64_t depth_sum;        // queue depth seen by each request, summed
+    uint64_t requests;
+    uint64_t peak_depth;
+    uint64_t wait_ns;          // time the faulting tasks waited for page-ins
+    uint64_t peak_wait_ns;
+
+    SwapStats() : swap_outs(0), swap_ins(0), cache_hits(0), discards(0), full(0), batches(0), writes(0),
+                  io_errors(0), peak_slots(0), depth_sum(0), requests(0), peak_depth(0), wait_ns(0),
+                  peak_wait_ns(0) {}
+};
+
+// Swap space for evicted pages, backed by a local file
+// With --swap SIZE, the memory manager's victims get a slot in a backing
+// file (--swap-file, or an unlinked temporary file) instead of being
+// dropped, and a later fault on the page reads it back: a major fault,
+// which the faulting task waits for. Only private base pages are swapped;
+// shared, forked and large pages are dropped as before.
+//
+// Pages are written through a small pool of I/O threads. Evicted pages are
+// gathered into one write batch of SWAP_BATCH_PAGES; a full batch is sorted
+// by slot and handed to the pool as one write per run of contiguous slots.
+// To keep those runs long, slots are taken from a cluster of
+// SWAP_CLUSTER_SLOTS free slots reserved at once, falling back to single
+// slots (the lowest free one) only when swap is too fragmented to have a
+// free cluster left. Pages are only evicted while the replay runs in trace
+// order (see MemoryManager), so a parallel replay swaps the same pages to
+// the same slots as a serial one, and one batch serves every thread.
+//
+// A fault on a page that is still in the batch takes it back without I/O
+// (a minor fault, like a swap-cache hit). A page-in goes ahead of the
+// queued writes, but if its own slot's write is in flight it waits for that
+// first. Whether a fault is major depends only on the batch, not on the I/O
+// timing, so the fault counts are reproducible.
+//
+// The simulator doesn't model page contents: a page is written as its
+// virtual page and slot followed by zeros, and checked when it is read back.
+class SwapDevice {
+private:
+    enum SlotState : uint8_t {
+        SLOT_FREE,
+        SLOT_BATCHED,   // in the write batch
+        SLOT_WRITING,   // handed to the I/O threads
+        SLOT_STORED
+    };
+
+    // One I/O: `count` contiguous slots from first_slot
+    struct Request {
+        bool write;
+        uint32_t first_slot;
+        uint32_t count;
+        std::vector<char> data;   // reads: the page read back
+        bool ok;
+        bool done;
+    };
+
+    // The write batch and the slot cluster it takes slots from
+    struct Batch {
+        std::vector<uint32_t> slots;
+        uint32_t cluster_next;   // reserved slots not handed out yet: [next, end)
+        uint32_t cluster_end;
+
+        Batch() : cluster_next(0), cluster_end(0) {}
+    };
+
+    bool enabled;
+    uint32_t page_size;
+    uint32_t slot_count;
+    std::string path;
+    int fd;
+
+    std::mutex lock;                      // everything below
+    std::condition_variable queue_ready;  // I/O threads: a request is queued or stop
+    std::condition_variable io_done;      // waiters: a request completed
+    std::unique_ptr<FrameAllocator> slots;
+    uint32_t frees_since_scan;            // slots freed since no free cluster was found
+    std::vector<uint8_t> slot_state;      // SlotState by slot
+    std::vector<uint64_t> slot_pages;     // virtual page written to each slot
+    std::deque<Request*> queue;
+    uint32_t depth;                       // requests queued or in progress
+    uint32_t writing;                     // write requests queued or in progress
+    uint32_t reserved;                    // slots in clusters, not handed out yet
+    bool stopping;
+    Batch batch;
+    SwapStats stats;
+    std::vector<std::thread> io_threads;
+
+    SwapDevice();
+    ~SwapDevice();
+
+    bool allocateSlot(uint32_t& slot);
+    void freeSlot(uint32_t slot);
+    void takeFromBatch(uint32_t slot);
+    uint32_t slotsInUse() const;
+    void submit(Request* request);
+    void flush();
+    void ioThread();
+    bool transfer(bool write, uint32_t first_slot, uint32_t count, char* data);
+    void fillPage(uint32_t slot, char* page) const;
+    void waitForWrites(std::unique_lock<std::mutex>& held);
+    void shutdown();
+
+public:
+    static SwapDevice& getInstance();
+
+    SwapDevice(const SwapDevice&) = delete;
+    void operator=(const SwapDevice&) = delete;
+
+    // Opens the backing file with room for swap_bytes of pages and starts
+    // the I/O threads; an empty file_name creates an unlinked temporary file.
+    // Prints an error and returns false if the file can't be created.
+    bool configure(uint64_t swap_bytes, uint32_t page_size_kb, const std::string& file_name, unsigned threads);
+
+    bool isEnabled() const { return enabled; }
+
+    // Evicted page: gives it a slot and queues its write. Returns false if
+    // the swap space is full.
+    bool pageOut(uint64_t virtual_page, uint32_t& slot);
+
+    // Fault on the page in slot: reads it back and frees the slot. Returns
+    // true for a major fault (read from the file), false if the page was
+    // still in the write batch.
+    bool pageIn(uint64_t virtual_page, uint32_t slot);
+
+    // The task freed a swapped-out page
+    void discard(uint32_t slot);
+
+    // Prints the "Swap" section; writes the open batch first and
+    // waits for the I/O threads. Prints nothing without --swap.
+    void printStats();
+
+    // Slots, their pages and the open batch (checkpoints of a serial run).
+    // Restore rewrites the stored pages to this run's file.
+    void save(CheckpointWriter& out);
+    void restore(CheckpointReader& in);
+};
+
+#endif // SWAP_H
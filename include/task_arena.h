@@ -0,0 +1,128 @@
+#ifndef TASK_ARENA_H
+#define TASK_ARENA_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+#include "metrics.h"
+#include "tlb.h"
+#include "trace_reader.h"
+
+// The tasks of a run, indexed by their dense task number (TraceRecord's
+// task_index)
+// Tasks are constructed in place in fixed-size blocks: creating one bumps a
+// cursor, its address never changes (frames and CPU contexts point at their
+// owners) and finding it is a single array index. Tasks are destroyed with
+// the arena.
+template <class Task>
+class TaskArena {
+private:
+    static const size_t BLOCK_TASKS = 64;
+
+    std::vector<Task*> index;     // task number -> task, nullptr until created
+    std::vector<char*> blocks;    // raw storage for BLOCK_TASKS tasks each
+    size_t count;
+
+    Task* slot(size_t n) const {
+        return reinterpret_cast<Task*>(blocks[n / BLOCK_TASKS]) + n % BLOCK_TASKS;
+    }
+
+public:
+    TaskArena() : count(0) {}
+    ~TaskArena() {
+        for (size_t n = 0; n < count; ++n) {
+            slot(n)->~Task();
+        }
+        for (size_t b = 0; b < blocks.size(); ++b) {
+            ::operator delete(blocks[b]);
+        }
+    }
+
+    TaskArena(const TaskArena&) = delete;
+    void operator=(const TaskArena&) = delete;
+
+    Task* get(uint32_t task_index) const {
+        return task_index < index.size() ? index[task_index] : nullptr;
+    }
+
+    // Constructs the task for a number that has none yet
+    Task* create(uint32_t task_index, const std::string& id) {
+        if (count % BLOCK_TASKS == 0) {
+            blocks.push_back(static_cast<char*>(::operator new(BLOCK_TASKS * sizeof(Task))));
+        }
+        Task* task = new (slot(count)) Task(id, task_index);
+        count++;
+        if (task_index >= index.size()) {
+            index.resize(std::max<size_t>(task_index + 1, index.size() * 2), nullptr);
+        }
+        index[task_index] = task;
+        return task;
+    }
+
+    // Tasks in order of creation
+    size_t size() const { return count; }
+    Task* at(size_t n) const { return slot(n); }
+
+    // Task objects and the index, excluding what the tasks allocate themselves
+    size_t getMemoryUsage() const {
+        return blocks.size() * BLOCK_TASKS * sizeof(Task) + index.capacity() * sizeof(Task*);
+    }
+
+    // Counts of every task's private TLB
+    TranslationStats getTranslationStats() const {
+        TranslationStats stats;
+        for (size_t n = 0; n < count; ++n) {
+            slot(n)->addTranslationStats(stats);
+        }
+        return stats;
+    }
+
+    // Every task's counts for the metrics export, in order of creation
+    std::vector<TaskMetrics> getTaskMetrics() const {
+        std::vector<TaskMetrics> metrics;
+        metrics.reserve(count);
+        for (size_t n = 0; n < count; ++n) {
+            metrics.push_back(slot(n)->getMetrics());
+        }
+        return metrics;
+    }
+
+    // Prints the simulator's own memory for its tasks: arena, ID table and
+    // what each task allocates (page tables, TLBs)
+    void printMemoryUsage(size_t id_table_bytes) const {
+        size_t owned = 0;
+        for (size_t n = 0; n < count; ++n) {
+            owned += slot(n)->getMemoryUsage();
+        }
+        size_t arena = getMemoryUsage();
+        size_t total = arena + id_table_bytes + owned;
+
+        std::cout << "\n=== Simulator Memory ===\n";
+        std::cout << "Tasks: " << count << ", Total: " << total << " bytes";
+        if (count > 0) {
+            std::cout << " (" << total / count << " bytes per task)";
+        }
+        std::cout << "\n  Task Objects: " << arena << " bytes, Task IDs: " << id_table_bytes
+                  << " bytes, Page Tables and TLBs: " << owned << " bytes\n";
+    }
+};
+
+// Creates the new task of a fork record. Returns nullptr, after reporting
+// it, if a task of that name exists already. parent is set to nullptr if
+// the parent never appeared; the child then starts out empty.
+template <class Task>
+Task* createForkedTask(TaskArena<Task>& tasks, const TraceRecord& record, Task*& parent) {
+    std::string id(record.task_id, record.task_id_length);
+    if (tasks.get(record.task_index) != nullptr) {
+        std::cerr << "Fork of existing task ignored: " << id << std::endl;
+        return nullptr;
+    }
+    parent = tasks.get(record.parent_index);
+    return tasks.create(record.task_index, id);
+}
+
+#endif // TASK_ARENA_H
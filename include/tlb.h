@@ -1,50 +1,217 @@
 #ifndef TLB_H
 #define TLB_H
 
-#include <unordered_map>
-#include <list>
+#include <vector>
 #include <cstdint>
 #include <cstddef>
+#include <memory>
+#include "config.h"
 
+class CheckpointWriter;
+class CheckpointReader;
+
+// Replacement policy used inside a TLB set
+enum TLBReplacement {
+    TLB_REPLACE_LRU,    // true LRU (per-set recency list)
+    TLB_REPLACE_PLRU,   // tree pseudo-LRU (ways - 1 bits per set)
+    TLB_REPLACE_RANDOM  // xorshift random victim
+};
+
+// TLB geometry: total entries = sets * ways
+struct TLBConfig {
+    uint32_t sets;   // power of two
+    uint32_t ways;   // 1..64, power of two for tree-PLRU
+    TLBReplacement policy;
+    uint32_t large_entries;   // fully associative large-page entries, 0..64
+    uint32_t large_order;     // base pages per large page, as a power of two
+    uint32_t l2_sets;         // second-level TLB sets, power of two; 0 = no L2
+    uint32_t l2_ways;         // 1..64, same replacement policy as the L1
+    uint32_t walk_cache_entries;   // page-walk cache for directory entries, 0..64
+
+    // Cost model, in cycles
+    uint32_t l1_cycles;          // every lookup
+    uint32_t l2_cycles;          // L1 misses, when there is an L2
+    uint32_t walk_cache_cycles;  // directory entry found in the page-walk cache
+    uint32_t memory_cycles;      // page-table entry read by the walker
+
+    TLBConfig()
+        : sets(TLB_SETS), ways(TLB_WAYS), policy(TLB_REPLACE_LRU),
+          large_entries(TLB_LARGE_ENTRIES),
+          large_order(LARGE_PAGE_SHIFT - __builtin_ctz(MIN_PAGE_SIZE_KB * 1024)),
+          l2_sets(TLB_L2_SETS), l2_ways(TLB_L2_WAYS), walk_cache_entries(TLB_WALK_CACHE_ENTRIES),
+          l1_cycles(TLB_L1_CYCLES), l2_cycles(TLB_L2_CYCLES), walk_cache_cycles(WALK_CACHE_CYCLES),
+          memory_cycles(WALK_MEMORY_CYCLES) {}
+
+    // Returns nullptr if the geometry is usable, otherwise a reason
+    const char* validate() const;
+};
+
+// Where a TLB's translations were resolved
+// Cycles are derived from the counts with a TLBConfig's costs: every lookup
+// pays for the L1, misses in the L1 pay for the L2 (if any), and misses in
+// every level pay for the page walk.
+struct TranslationStats {
+    uint64_t lookups;
+    uint64_t l2_hits;          // L1 misses that hit the L2
+    uint64_t misses;           // misses in every level, each followed by a walk
+    uint64_t walk_cache_hits;  // walks that found the directory entry cached
+    uint64_t walk_reads;       // page-table entries the walks read from memory
+
+    TranslationStats() : lookups(0), l2_hits(0), misses(0), walk_cache_hits(0), walk_reads(0) {}
+
+    void add(const TranslationStats& other);
+    uint64_t walkCycles(const TLBConfig& config) const;
+    uint64_t cycles(const TLBConfig& config) const;
+
+    // Prints "Average Translation Latency: N cycles (page walks: P% of cycles)"
+    void printLatency(const TLBConfig& config) const;
+};
+
+// Set-associative TLB kept in flat arrays
+// Each set is a row of `stride` ways (ways rounded up to a multiple of 4 so
+// a row can be compared with 128-bit SIMD loads). A 64-bit tag is kept as
+// two 32-bit words: the low word (low bits of the page number) is what the
+// row scan compares, and the high word (page number bits above 32 and the
+// ASID) is only checked for ways whose low word matched, so the scan costs
+// the same as with 32-bit tags. Empty ways hold INVALID_TAG. With the
+// default geometry (1 set x 64 ways, LRU) this is the same fully associative
+// LRU TLB the simulator always had.
+//
+// Large pages get their own small fully associative LRU array, tagged with
+// the large page number (virtual_page >> large_order). A lookup probes the
+// base-page sets first and then the large array, so one large entry covers
+// 1 << large_order base pages.
+//
+// An optional second level (a larger set-associative TLB for base pages) is
+// probed after both L1 arrays; a hit there is copied into the L1, and misses
+// are filled into both levels. After a miss in every level the caller walks
+// the page table and reports it with walk(): the page-walk cache keeps the
+// directory entries of recent two-level walks, so a hit there saves the
+// walker every read but the PTE's. The nested TLBs (large array, L2, walk
+// cache) are plain single-level TLB objects.
+//
+// Tags also carry the address-space ID that was current when the entry was
+// added (in the bits above the page number, which is below 2^48 for
+// VIRTUAL_ADDRESS_BITS-bit addresses), so an entry only matches lookups from
+// the same address space. A TLB private to one task stays at ASID 0; a TLB
+// shared by several tasks (cpu_tlb.h) switches the current ID on every
+// context switch.
 class TLB {
 private:
-    struct TLBEntry {
-        uint32_t virtual_page;
-        uint32_t physical_page;
-        bool dirty;
-    };
-
-    // TLB size (number of entries)
-    static const size_t TLB_SIZE = 64;  // Typical TLB sizes range from 32 to 256 entries
-    
-    // Cache structure using LRU (Least Recently Used) replacement policy
-    std::list<TLBEntry> lru_list;
-    std::unordered_map<uint32_t, std::list<TLBEntry>::iterator> tlb_map;
-    
+    static const uint64_t INVALID_TAG = ~0ULL;
+    static const uint32_t ASID_SHIFT = 48;   // page numbers are at most 46 bits
+
+    TLBConfig config;
+    uint32_t set_mask;
+    uint32_t stride;
+
+    std::vector<uint32_t> tags;       // low tag word per way (sets * stride)
+    std::vector<uint32_t> tags_high;  // high tag word per way
+    std::vector<uint32_t> frames;     // physical page per way
+    std::vector<uint8_t> lru_prev;    // LRU: per-set doubly linked recency
+    std::vector<uint8_t> lru_next;    //      list of ways, most recent first
+    std::vector<uint8_t> lru_head;    // LRU: most recently used way per set
+    std::vector<uint8_t> lru_tail;    // LRU: least recently used way per set
+    std::vector<uint64_t> plru_bits;  // PLRU: one tree per set
+    std::vector<uint8_t> occupied;    // valid ways per set (skips the empty-way scan once full)
+    uint32_t rng_state;
+    uint64_t asid_bits;               // current ASID << ASID_SHIFT
+
+    std::unique_ptr<TLB> large;       // created on the first large mapping
+    std::unique_ptr<TLB> l2;          // second level, if configured
+    std::unique_ptr<TLB> walk_cache;  // directory key -> cached; created on the first walk
+
     // Statistics
-    uint32_t hits;
+    uint32_t hits;                    // in any level
     uint32_t misses;
+    uint32_t large_hits;
+    uint32_t l2_hits;
+    uint32_t foreign_evictions;       // valid entries of another ASID replaced
+    uint64_t walk_cache_hits;
+    uint64_t walk_reads;
+
+    static TLBConfig default_config;
+
+    void init();
+    int findWay(uint32_t set, uint64_t tag) const;
+    void touch(uint32_t set, uint32_t way);
+    uint32_t chooseVictim(uint32_t set);
+    void fillWay(uint32_t set, uint32_t way, uint64_t tag, uint32_t physical_page);
+
+    // Geometry of a nested TLB: one level, no large array or walk cache
+    static TLBConfig nestedConfig(uint32_t sets, uint32_t ways, TLBReplacement policy);
 
 public:
     TLB();
-    
-    // Look up a virtual page number in the TLB
-    bool lookup(uint32_t virtual_page, uint32_t& physical_page);
-    
+    explicit TLB(const TLBConfig& cfg);
+
+    // Geometry used by default-constructed TLBs (e.g. from the command line)
+    static void setDefaultConfig(const TLBConfig& cfg);
+    static const TLBConfig& getDefaultConfig();
+
+    // Look up a virtual page number in the TLB (base pages, then large
+    // pages, then the L2)
+    bool lookup(uint64_t virtual_page, uint32_t& physical_page);
+
+    // Records the page walk that follows a lookup() miss, which read `levels`
+    // page-table entries: down to the PTE (to_table), or to a large-page PDE
+    // or an empty entry on the way (a single-level table reads one). The
+    // page-walk cache keeps the directory entries that point at page-table
+    // pages, keyed by directory_key (the address bits above the page table):
+    // when it has the one for directory_key, a walk to the PTE only reads
+    // the PTE.
+    void walk(uint32_t levels, uint64_t directory_key, bool to_table = true);
+
     // Add a new mapping to the TLB
-    void add(uint32_t virtual_page, uint32_t physical_page);
-    
+    void add(uint64_t virtual_page, uint32_t physical_page);
+
+    // Same as add() for a page the last lookup() missed, so it is known not
+    // to be cached and the set is not probed again
+    void fill(uint64_t virtual_page, uint32_t physical_page);
+
+    // Add a large-page mapping covering virtual_page; physical_base is the
+    // frame of the large page's first base page
+    void addLarge(uint64_t virtual_page, uint32_t physical_base);
+
     // Invalidate a specific entry
-    void invalidate(uint32_t virtual_page);
-    
-    // Invalidate all entries
-    void invalidateAll();
-    
+    void invalidate(uint64_t virtual_page);
+
+    // Invalidate the large-page entry covering virtual_page
+    void invalidateLarge(uint64_t virtual_page);
+
+    // Drops the page-walk cache entry of a directory slot whose page table
+    // was freed
+    void invalidateWalk(uint64_t directory_key);
+
+    // Invalidate all entries (of every ASID, in every level); returns how
+    // many TLB entries were valid
+    uint32_t invalidateAll();
+
+    // Address space for lookups and new entries, 0..MAX_ASID (0 when not shared)
+    static const uint32_t MAX_ASID = 4094;
+    void setASID(uint32_t id);
+    uint32_t getASID() const { return static_cast<uint32_t>(asid_bits >> ASID_SHIFT); }
+
+    // Valid entries that were replaced by an entry of another address space
+    uint32_t getForeignEvictions() const;
+
     // Get hit rate statistics
     void getStats(uint32_t& hit_count, uint32_t& miss_count) const;
-    
+
+    // Counts for the cost model
+    TranslationStats getTranslationStats() const;
+    const TLBConfig& getConfig() const { return config; }
+
     // Print TLB statistics
     void printStats() const;
+
+    // Bytes held by the TLB, its entry arrays and its nested TLBs
+    size_t getMemoryUsage() const;
+
+    // Entries, replacement state and counters of every level (checkpoints);
+    // restore() needs a TLB of the same geometry
+    void save(CheckpointWriter& out) const;
+    void restore(CheckpointReader& in);
 };
 
-#endif // TLB_H 
\ No newline at end of file
+#endif // TLB_H
@@ -0,0 +1,133 @@
+#ifndef TRACE_FORMAT_H
+#define TRACE_FORMAT_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Binary trace format (version 3)
+//
+//   BinaryTraceHeader
+//   string table: task_count x [uint16 length][name bytes]
+//   blocks:       BinaryTraceBlock header + encoded records, repeated,
+//                 ended by an empty block (record_count == 0)
+//   index:        BinaryTraceIndex + block_count x BinaryTraceIndexEntry
+//                 (optional; header.index_offset is 0 when absent)
+//
+// Each access record is three LEB128 varints:
+//   task index << 1
+//   address delta against the previous address of the same task, zigzag
+//     encoded; bit 0 set = byte delta, clear = delta in 4 KB pages
+//   size in 1 KB units (PAGE_SIZE_KB_1)
+// A fork record is two: (new task index << 1) | 1, then the parent's index.
+// Version 1 files have no fork records and store the task index unshifted;
+// version 3 only differs in that addresses may be wider than 32 bits.
+// Readers accept all three.
+// Per-task delta state resets at every block boundary, so each block can be
+// decoded on its own (seek via the index, or split blocks across readers).
+
+#define BINARY_TRACE_MAGIC 0x52544D4Du   // "MMTR"
+#define BINARY_TRACE_VERSION 3
+#define BINARY_TRACE_BLOCK_RECORDS 65536
+
+struct BinaryTraceHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t task_count;
+    uint32_t string_table_bytes;
+    uint64_t record_count;
+    uint64_t index_offset;
+};
+
+struct BinaryTraceBlock {
+    uint32_t record_count;
+    uint32_t payload_bytes;
+};
+
+struct BinaryTraceIndex {
+    uint32_t block_count;
+    uint32_t reserved;
+};
+
+struct BinaryTraceIndexEntry {
+    uint64_t offset;        // file offset of the BinaryTraceBlock
+    uint64_t first_record;  // number of records before this block
+};
+
+inline uint8_t* putVarint(uint8_t* out, uint64_t value) {
+    while (value >= 0x80) {
+        *out++ = static_cast<uint8_t>(value | 0x80);
+        value >>= 7;
+    }
+    *out++ = static_cast<uint8_t>(value);
+    return out;
+}
+
+// Returns nullptr if the varint runs past end
+inline const uint8_t* getVarint(const uint8_t* in, const uint8_t* end, uint64_t& value) {
+    uint64_t result = 0;
+    for (int shift = 0; in < end && shift < 64; shift += 7) {
+        uint8_t byte = *in++;
+        result |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            value = result;
+            return in;
+        }
+    }
+    return nullptr;
+}
+
+inline uint64_t encodeAddressDelta(uint64_t previous, uint64_t address) {
+    int64_t delta = static_cast<int64_t>(address) - static_cast<int64_t>(previous);
+    bool page_aligned = (delta & 0xFFF) == 0;
+    if (page_aligned) delta >>= 12;
+    uint64_t zigzag = (static_cast<uint64_t>(delta) << 1) ^ static_cast<uint64_t>(delta >> 63);
+    return (zigzag << 1) | (page_aligned ? 0 : 1);
+}
+
+inline uint64_t decodeAddressDelta(uint64_t previous, uint64_t encoded) {
+    uint64_t zigzag = encoded >> 1;
+    int64_t delta = static_cast<int64_t>(zigzag >> 1) ^ -static_cast<int64_t>(zigzag & 1);
+    if ((encoded & 1) == 0) delta *= 4096;
+    return static_cast<uint64_t>(static_cast<int64_t>(previous) + delta);
+}
+
+// True if the buffer starts with a binary trace header
+bool isBinaryTrace(const void* data, size_t size);
+
+// Streams records into a binary trace file
+// Task names are fixed up front (they live in the header); records reference
+// them by index. The index is written on close when the output is seekable.
+class BinaryTraceWriter {
+private:
+    FILE* file;
+    bool owns_file;
+    std::vector<uint8_t> block;
+    std::vector<uint64_t> last_address;     // per-task delta state
+    std::vector<BinaryTraceIndexEntry> index;
+    uint32_t block_records;
+    uint64_t record_count;
+    uint64_t position;
+
+    void flushBlock();
+
+public:
+    BinaryTraceWriter();
+    ~BinaryTraceWriter();
+
+    BinaryTraceWriter(const BinaryTraceWriter&) = delete;
+    void operator=(const BinaryTraceWriter&) = delete;
+
+    // Opens the output ("-" = stdout) and writes the header/string table
+    bool open(const std::string& filename, const std::vector<std::string>& task_ids);
+
+    void append(uint32_t task_index, uint64_t logical_address, uint32_t size_in_bytes);
+    void appendFork(uint32_t task_index, uint32_t parent_index);
+
+    // Flushes the last block, writes the index and patches the header
+    bool close();
+};
+
+#endif // TRACE_FORMAT_H
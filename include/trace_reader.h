@@ -0,0 +1,153 @@
+#ifndef TRACE_READER_H
+#define TRACE_READER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <vector>
+
+class CheckpointWriter;
+class CheckpointReader;
+
+enum TraceRecordKind {
+    TRACE_ACCESS,   // "T<id>: 0x<hex>: <n>KB|MB"
+    TRACE_FORK      // "T<child>: fork T<parent>": the child starts as a copy of the parent
+};
+
+// One decoded trace line
+// task_id points into the reader's buffer (a streamed trace: its copy of
+// the task ID) and is not NUL-terminated; it stays valid until the reader
+// is closed. task_index is the task's dense
+// number, 0, 1, 2, ... in order of first appearance (binary traces: in task
+// table order); only TraceReader fills it in. Fork records name the new
+// task in task_id and the parent in parent_id, with address and size 0.
+struct TraceRecord {
+    const char* task_id;
+    uint32_t task_id_length;
+    uint32_t task_index;
+    uint64_t logical_address;
+    uint32_t size_in_bytes;
+    TraceRecordKind kind;
+    const char* parent_id;
+    uint32_t parent_id_length;
+    uint32_t parent_index;
+};
+
+// Outcome of parsing one line
+enum TraceParseResult {
+    TRACE_LINE_OK,            // record filled in
+    TRACE_LINE_EMPTY,         // blank line, skipped silently
+    TRACE_LINE_MALFORMED,     // missing/invalid field, reported and skipped
+    TRACE_LINE_UNKNOWN_SIZE   // neither KB nor MB: reported, record has size 0
+};
+
+// Parses [begin, end) (no trailing newline) in place without allocating.
+// Problems are reported on stderr unless `report` is false.
+TraceParseResult parseTraceLine(const char* begin, const char* end, TraceRecord& record,
+                                bool report = true);
+
+// Memory-mapped trace file reader shared by both simulators
+// Text traces: lines are located with memchr and parsed in place; malformed
+// lines are reported on stderr exactly like the old getline/stringstream
+// parser. Binary traces (trace_format.h) are detected by their magic number
+// and decoded block by block. Task IDs are interned as they are first seen,
+// so callers can keep per-task state in a plain array.
+//
+// Inputs that can't be mapped ("-" for stdin, pipes) are streamed through
+// a window of TRACE_STREAM_BUFFER bytes instead: text is parsed up to the
+// last complete line in the window and binary traces a whole block at a
+// time, so memory stays bounded however long the trace is. Streamed task
+// IDs are copied as they are interned. A stream can't be rewound or
+// checkpointed.
+class TraceReader {
+private:
+    struct TaskName {
+        const char* name;
+        uint32_t length;
+        uint32_t hash;
+    };
+
+    const char* data;
+    size_t size;
+    const char* cursor;
+    bool mapped;   // true: data is an mmap, false: heap buffer (fallback)
+    bool report_errors;
+
+    // Streamed input: data is the window, size the bytes ready to parse
+    bool streaming;
+    bool stream_end;          // the input has no more bytes
+    int stream_fd;
+    bool owns_fd;             // false for stdin
+    char* window;             // == data
+    size_t window_capacity;
+    size_t buffered;          // bytes read into the window
+    std::deque<std::string> name_copies;   // task IDs outlive the window
+
+    // Interned task IDs: open addressing over task_names (slot = index + 1,
+    // 0 = empty), load factor at most 1/2
+    std::vector<TaskName> task_names;
+    std::vector<uint32_t> task_slots;
+    uint32_t last_task;   // consecutive lines mostly name the same task
+
+    // Binary trace state
+    bool binary;
+    const char* records_begin;
+    uint32_t binary_version;
+    std::vector<uint32_t> binary_tasks;   // task table index -> dense index
+    std::vector<uint64_t> last_address;   // per-task delta state
+    uint32_t block_remaining;
+
+    uint32_t internTask(const char* name, uint32_t length);
+    bool openBinary(const std::string& filename);
+    bool nextBinary(TraceRecord& record);
+    void openStream(int fd, bool owns);
+    size_t readInput();
+    void compactWindow(size_t capacity);
+    bool fillWindow(size_t bytes);
+    bool refillLines();
+
+public:
+    TraceReader();
+    ~TraceReader();
+
+    TraceReader(const TraceReader&) = delete;
+    void operator=(const TraceReader&) = delete;
+
+    // Maps the whole file ("-" = stdin), or streams it if it can't be
+    // mapped; prints an error and returns false on failure
+    bool open(const std::string& filename);
+    void close();
+
+    // Next well-formed record; returns false at end of file
+    bool next(TraceRecord& record);
+
+    // Start again from the first record (not for streamed input)
+    void rewind();
+
+    // Position and interned task IDs, for checkpoints. restore() expects the
+    // same trace, just opened: text task IDs are stored as offsets into it.
+    // Defined in checkpoint.cpp.
+    void save(CheckpointWriter& out) const;
+    void restore(CheckpointReader& in);
+
+    // Turn malformed-line diagnostics on or off (on by default)
+    void setReportErrors(bool report) { report_errors = report; }
+
+    bool isBinary() const { return binary; }
+    bool isStreaming() const { return streaming; }
+
+    // Distinct tasks seen so far (binary traces: all of them)
+    uint32_t getTaskCount() const { return static_cast<uint32_t>(task_names.size()); }
+    std::string getTaskName(uint32_t task_index) const {
+        return std::string(task_names[task_index].name, task_names[task_index].length);
+    }
+
+    // Bytes held by the task ID table
+    size_t getTaskTableMemoryUsage() const {
+        return task_names.capacity() * sizeof(TaskName) + task_slots.capacity() * sizeof(uint32_t) +
+               binary_tasks.capacity() * sizeof(uint32_t) + name_copies.size() * sizeof(std::string);
+    }
+};
+
+#endif // TRACE_READER_H
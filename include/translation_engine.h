@@ -0,0 +1,569 @@
+#ifndef TRANSLATION_ENGINE_H
+#define TRANSLATION_ENGINE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "checkpoint.h"
+#include "config.h"
+#include "cpu_tlb.h"
+#include "event_trace.h"
+#include "memory_manager.h"
+#include "metrics.h"
+#include "page_size.h"
+#include "page_table.h"
+#include "replacement.h"
+#include "shared_frames.h"
+#include "swap.h"
+#include "tlb.h"
+
+// One task's address translation: TLB, page table, faults, copy-on-write,
+// swapped-out pages
+// The page-table layout (page_table_layouts.h) and the base page shift are
+// template parameters, so every index split and mask is a compile-time
+// constant and the translation loops inline the layout's lookups; there is
+// no virtual dispatch on the hot path. The simulator instantiates each
+// layout for every supported page size and picks one at startup
+// (simulator.h).
+template <template <uint32_t> class PageTable, uint32_t PAGE_SHIFT>
+class TranslationEngine : public PageOwner {
+public:
+    typedef PageTable<PAGE_SHIFT> Table;
+
+    static const uint32_t PAGE_SIZE = 1u << PAGE_SHIFT;
+    static const uint64_t ADDRESS_MASK = (1ULL << Table::ADDRESS_BITS) - 1;
+    static const uint64_t PAGE_MASK = ADDRESS_MASK >> PAGE_SHIFT;   // virtual page numbers
+    static const uint32_t LARGE_ORDER = LARGE_PAGE_SHIFT - PAGE_SHIFT;
+    static const uint32_t RUN_PAGES = LEVEL2_ENTRIES;          // longest run a layout returns
+
+private:
+    std::string task_id;
+    uint32_t page_hits;
+    uint32_t page_misses;
+    uint32_t cow_faults;
+    uint32_t major_faults;   // faults that read the page back from swap
+    uint32_t out_of_range;   // records beyond the layout's ADDRESS_BITS, skipped
+    Table page_table;
+    bool large_pages;      // some addresses are mapped with large pages
+    bool shared_regions;   // some addresses are in shared regions (shared_frames.h)
+
+    // Swapped-out pages and their swap slots, created on the first swap-out.
+    // Kept beside the page table rather than in non-present PTEs, so every
+    // layout (the inverted table has no entry without a frame) swaps the
+    // same way.
+    typedef std::unordered_map<uint64_t, uint32_t> SwapMap;
+    std::unique_ptr<SwapMap> swapped;
+
+    // TLB: private to this task, unless tasks share CPU TLBs (cpu_tlb.h);
+    // the private one is created on the first access
+    std::unique_ptr<TLB> own_tlb;
+    CpuTLBs::Context* cpu_context;   // shared CPU TLB, or nullptr
+    EventRing* events;               // nullptr unless event tracing is on
+
+    TLB& activeTLB() {
+        if (cpu_context) return CpuTLBs::getInstance().activate(*cpu_context);
+        if (!own_tlb) own_tlb.reset(new TLB());
+        return *own_tlb;
+    }
+
+    // Page-table lookup after a TLB miss, timed for the metrics
+    uint32_t* walkTable(uint64_t virtual_page, TLB& tlb) {
+        METRICS_TIME(METRIC_PAGE_WALK);
+        return page_table.walk(virtual_page, tlb);
+    }
+
+    void invalidateTLB(uint64_t virtual_page, bool large) {
+        if (cpu_context) {
+            CpuTLBs::getInstance().invalidate(*cpu_context, virtual_page, large);
+        } else if (own_tlb) {
+            if (large) {
+                own_tlb->invalidateLarge(virtual_page);
+            } else {
+                own_tlb->invalidate(virtual_page);
+            }
+        }
+    }
+
+    // Drops the walk cache entry of a page whose page-table page is gone
+    void invalidateWalk(uint64_t virtual_page) {
+        if (!Table::WALK_CACHE || page_table.hasTable(virtual_page)) return;
+        uint64_t directory_key = Table::directoryKey(virtual_page);
+        if (cpu_context) {
+            CpuTLBs::getInstance().invalidateWalk(*cpu_context, directory_key);
+        } else if (own_tlb) {
+            own_tlb->invalidateWalk(directory_key);
+        }
+    }
+
+    // Frame for a non-present page: a shared-region frame or a new private
+    // one (which may evict a page)
+    uint32_t mapPage(uint64_t virtual_page) {
+        if (shared_regions && SharedFrames::inRegion(virtual_page << PAGE_SHIFT)) {
+            uint32_t frame = SharedFrames::getInstance().mapRegionPage(this, virtual_page);
+            page_table.map(virtual_page, frame, PTE_ACCESSED | PTE_SHARED);
+            return frame;
+        }
+        uint32_t frame = MemoryManager::getInstance().allocatePage(this, virtual_page);
+        page_table.map(virtual_page, frame, PTE_ACCESSED);
+        return frame;
+    }
+
+    // Write to a PTE_COW page: maps and returns the frame to write to. The
+    // PTE stays present while the copy is allocated (our mapping is no
+    // longer on the shared frame, so evictions cannot take it), which also
+    // keeps its page-table page alive.
+    uint32_t copyOnWrite(uint64_t virtual_page, uint32_t frame) {
+        uint32_t copy = SharedFrames::getInstance().breakCOW(frame, this, virtual_page);
+        page_table.map(virtual_page, copy, PTE_ACCESSED);
+        cow_faults++;
+        TRACE_EVENT(1, events, EVENT_COW_FAULT, virtual_page, copy);
+        return copy;
+    }
+
+    // Maps the whole directory entry with one large page if the address is
+    // in a large-page region, the entry has no page table yet, none of its
+    // base pages is swapped out and enough contiguous frames are free.
+    // Otherwise the caller falls back to base pages.
+    bool mapLargePage(uint64_t logical_address, uint64_t virtual_page, uint32_t& physical_page) {
+        if (!PageSizeConfig::current().wantsLargePage(logical_address) || page_table.hasTable(virtual_page)) {
+            return false;
+        }
+        // Shared regions are mapped page by page
+        uint64_t slot_start = (logical_address >> LARGE_PAGE_SHIFT) << LARGE_PAGE_SHIFT;
+        if (shared_regions && SharedFrames::overlapsRegion(slot_start, slot_start + (LARGE_PAGE_SIZE_KB * 1024 - 1))) {
+            return false;
+        }
+
+        uint32_t first_frame;
+        uint32_t large_mask = (1u << LARGE_ORDER) - 1;
+        uint64_t first_page = virtual_page & ~static_cast<uint64_t>(large_mask);
+        if (swapped && !swapped->empty()) {
+            for (uint32_t i = 0; i <= large_mask; ++i) {
+                if (swapped->count(first_page + i) != 0) return false;
+            }
+        }
+        if (!MemoryManager::getInstance().allocateLargePage(this, first_page, first_frame)) {
+            return false;
+        }
+        page_table.mapLarge(virtual_page, first_frame, PTE_ACCESSED);
+        activeTLB().addLarge(virtual_page, first_frame);
+        physical_page = first_frame + (static_cast<uint32_t>(virtual_page) & large_mask);
+        return true;
+    }
+
+    // An evicted private page gets a swap slot, unless swap is full (then
+    // it is dropped and faults back in as a new page)
+    void swapOut(uint64_t virtual_page) {
+        uint32_t slot;
+        if (SwapDevice::getInstance().pageOut(virtual_page, slot)) {
+            if (!swapped) swapped.reset(new SwapMap());
+            (*swapped)[virtual_page] = slot;
+            TRACE_EVENT(1, events, EVENT_SWAP_OUT, virtual_page, slot);
+        }
+    }
+
+    // Fault on a page that may be swapped out: reads it back into the frame
+    // just mapped. A read from the backing file is a major fault.
+    void swapIn(uint64_t virtual_page) {
+        SwapMap::iterator it = swapped->find(virtual_page);
+        if (it == swapped->end()) return;
+        if (SwapDevice::getInstance().pageIn(virtual_page, it->second)) {
+            major_faults++;
+            METRICS_COUNT(METRIC_MAJOR_FAULTS, 1);
+        }
+        TRACE_EVENT(1, events, EVENT_SWAP_IN, virtual_page, it->second);
+        swapped->erase(it);
+    }
+
+public:
+    TranslationEngine(const std::string& id, uint32_t task_index)
+        : PageOwner(task_index), task_id(id), page_hits(0), page_misses(0), cow_faults(0), major_faults(0), out_of_range(0),
+          large_pages(Table::LARGE_PAGES && PageSizeConfig::current().usesLargePages()),
+          shared_regions(SharedFrames::hasRegions()), cpu_context(CpuTLBs::getInstance().registerTask()),
+          events(EventTracer::getInstance().registerTask(id)) {}
+
+    TranslationEngine(const TranslationEngine&) = delete;
+    void operator=(const TranslationEngine&) = delete;
+
+    // Accesses the page of the address (wrapped to the layout's ADDRESS_BITS)
+    void accessMemory(uint64_t logical_address) {
+        uint64_t virtual_page = (logical_address >> PAGE_SHIFT) & PAGE_MASK;
+        uint32_t physical_page;
+        TLB& tlb = activeTLB();
+        METRICS_COUNT(METRIC_ACCESSES, 1);
+
+        // First, try to find the mapping in the TLB
+        if (timedTLBLookup(tlb, virtual_page, physical_page)) {
+            page_hits++;
+            // A large page's accessed bit lives on its first frame
+            uint32_t* pde = large_pages ? page_table.findLarge(virtual_page) : nullptr;
+            MemoryManager::getInstance().touchPage(pde ? pteFrame(*pde) : physical_page);
+            TRACE_EVENT(2, events, EVENT_TLB_HIT, virtual_page, physical_page);
+            return;
+        }
+
+        // TLB miss - a large page is mapped by the directory entry itself
+        uint32_t* pde = large_pages ? page_table.walkLarge(virtual_page, tlb) : nullptr;
+        if (pde != nullptr) {
+            page_hits++;
+            *pde |= PTE_ACCESSED;
+            physical_page = pteFrame(*pde) + (static_cast<uint32_t>(virtual_page) & ((1u << LARGE_ORDER) - 1));
+            MemoryManager::getInstance().touchPage(pteFrame(*pde));
+            TRACE_EVENT(2, events, EVENT_PAGE_HIT, virtual_page, physical_page);
+            tlb.addLarge(virtual_page, pteFrame(*pde));
+            return;
+        }
+
+        // Otherwise walk the page table
+        uint32_t* pte = walkTable(virtual_page, tlb);
+        if (pte != nullptr && (*pte & PTE_PRESENT)) {
+            page_hits++;
+            *pte |= PTE_ACCESSED;
+            physical_page = pteFrame(*pte);
+            if (*pte & PTE_COW) {
+                physical_page = copyOnWrite(virtual_page, physical_page);
+            }
+            MemoryManager::getInstance().touchPage(physical_page);
+            TRACE_EVENT(2, events, EVENT_PAGE_HIT, virtual_page, physical_page);
+        } else {
+            page_misses++;
+            METRICS_COUNT(METRIC_PAGE_FAULTS, 1);
+            TRACE_EVENT(1, events, EVENT_PAGE_MISS, virtual_page, 0);
+
+            if (large_pages && mapLargePage(logical_address, virtual_page, physical_page)) {
+                TRACE_EVENT(1, events, EVENT_ALLOCATE, virtual_page, physical_page);
+                return;
+            }
+
+            // Allocate new physical page (may evict another page)
+            physical_page = mapPage(virtual_page);
+            TRACE_EVENT(1, events, EVENT_ALLOCATE, virtual_page, physical_page);
+            if (swapped) swapIn(virtual_page);
+        }
+
+        // Add the mapping to the TLB
+        tlb.fill(virtual_page, physical_page);
+    }
+
+    // Accesses every page of [start, start + length), stepping by the base
+    // page size. Same results as calling accessMemory once per page, but
+    // the pages are looked up in runs (layout's runLength) and the missing
+    // frames of a run are allocated in bulk. A range starting beyond the
+    // layout's ADDRESS_BITS is skipped and counted.
+    void accessRange(uint64_t start, uint32_t length) {
+        if (start & ~ADDRESS_MASK) {
+            out_of_range++;
+            return;
+        }
+        uint32_t num_pages = static_cast<uint32_t>((static_cast<uint64_t>(length) + PAGE_SIZE - 1) >> PAGE_SHIFT);
+
+        // Large pages are mapped one fault at a time
+        if (large_pages) {
+            for (uint32_t i = 0; i < num_pages; ++i) {
+                accessMemory(start + i * PAGE_SIZE);
+            }
+            return;
+        }
+
+        MemoryManager& memory = MemoryManager::getInstance();
+        TLB& tlb = activeTLB();
+        METRICS_COUNT(METRIC_ACCESSES, num_pages);
+        uint64_t missing_pages[RUN_PAGES];
+        uint32_t frames[RUN_PAGES];
+
+        uint32_t done = 0;
+        while (done < num_pages) {
+            uint64_t first_page = ((start >> PAGE_SHIFT) + done) & PAGE_MASK;
+            uint32_t count = std::min(num_pages - done, Table::runLength(first_page));
+            done += count;
+
+            // A TLB hit implies a present PTE, so the pages needing a frame
+            // are exactly the non-present ones; allocate them in one go.
+            // Shared-region and COW pages allocate as they go (and may
+            // evict), so a run that has any does without the bulk frames.
+            uint32_t missing = 0;
+            bool shared = false;
+            for (uint32_t k = 0; k < count; ++k) {
+                uint64_t virtual_page = (first_page + k) & PAGE_MASK;
+                uint32_t* pte = page_table.find(virtual_page);
+                if (pte == nullptr || !(*pte & PTE_PRESENT)) {
+                    missing_pages[missing++] = virtual_page;
+                    shared = shared || (shared_regions && SharedFrames::inRegion(virtual_page << PAGE_SHIFT));
+                } else if (*pte & PTE_COW) {
+                    shared = true;
+                }
+            }
+            uint32_t prepared = missing > 0 && !shared ? memory.allocatePages(this, missing_pages, missing, frames) : 0;
+            uint32_t next_frame = 0;
+
+            for (uint32_t k = 0; k < count; ++k) {
+                uint64_t virtual_page = (first_page + k) & PAGE_MASK;
+                uint32_t physical_page;
+
+                if (timedTLBLookup(tlb, virtual_page, physical_page)) {
+                    page_hits++;
+                    memory.touchPage(physical_page);
+                    TRACE_EVENT(2, events, EVENT_TLB_HIT, virtual_page, physical_page);
+                    continue;
+                }
+
+                // Walked again per page: once the bulk frames run out,
+                // evictions can unmap pages of this run or free the page
+                // table itself
+                uint32_t* pte = walkTable(virtual_page, tlb);
+                if (pte != nullptr && (*pte & PTE_PRESENT)) {
+                    page_hits++;
+                    *pte |= PTE_ACCESSED;
+                    physical_page = pteFrame(*pte);
+                    if (*pte & PTE_COW) {
+                        physical_page = copyOnWrite(virtual_page, physical_page);
+                    }
+                    memory.touchPage(physical_page);
+                    TRACE_EVENT(2, events, EVENT_PAGE_HIT, virtual_page, physical_page);
+                } else {
+                    page_misses++;
+                    METRICS_COUNT(METRIC_PAGE_FAULTS, 1);
+                    TRACE_EVENT(1, events, EVENT_PAGE_MISS, virtual_page, 0);
+                    if (next_frame < prepared) {
+                        physical_page = frames[next_frame++];
+                        page_table.map(virtual_page, physical_page, PTE_ACCESSED);
+                    } else {
+                        physical_page = mapPage(virtual_page);
+                    }
+                    TRACE_EVENT(1, events, EVENT_ALLOCATE, virtual_page, physical_page);
+                    if (swapped) swapIn(virtual_page);
+                }
+                tlb.fill(virtual_page, physical_page);
+            }
+        }
+    }
+
+    // Starts this (new) task as a fork of parent: it maps all of the
+    // parent's base pages, copy-on-write except for shared regions. Large
+    // pages are not inherited; the child faults its own in.
+    void forkFrom(TranslationEngine& parent) {
+        if (cpu_context != nullptr) {
+            CpuTLBs::getInstance().inherit(*cpu_context, *parent.cpu_context);
+        }
+
+        SharedFrames& shared = SharedFrames::getInstance();
+        uint32_t mappings = 0;
+        page_table.reserve(parent.page_table.getMappedPageCount());
+        parent.page_table.forEachPresent([&](uint64_t virtual_page, uint32_t& pte) {
+            if (!(pte & (PTE_SHARED | PTE_COW))) {
+                // Write-protect the parent's copy too
+                pte |= PTE_COW;
+                parent.invalidateTLB(virtual_page, false);
+            }
+            shared.share(pteFrame(pte), this, virtual_page);
+            page_table.map(virtual_page, pteFrame(pte), pte & (PTE_SHARED | PTE_COW));
+            mappings++;
+        });
+        shared.countFork(mappings);
+    }
+
+    void printStats() const {
+        std::cout << "Task " << task_id << " - Page Table Hits: " << page_hits
+                  << ", Page Table Misses: " << page_misses;
+        if (cow_faults > 0) {
+            std::cout << ", COW Faults: " << cow_faults;
+        }
+        if (major_faults > 0) {
+            std::cout << ", Major Faults: " << major_faults;
+        }
+        if (out_of_range > 0) {
+            std::cout << ", Out-of-Range Records: " << out_of_range;
+        }
+        std::cout << "\n";
+        page_table.printStats();
+        if (cpu_context) {
+            std::cout << "TLB: shared, CPU " << cpu_context->cpu << "\n";
+        } else if (own_tlb) {
+            own_tlb->printStats();
+        }
+    }
+
+    const std::string& getId() const { return task_id; }
+
+    // Most frames a record of `length` bytes can take: one per page (a COW
+    // copy or shared-region page included), or a large page's per page
+    static uint64_t maxFrames(uint32_t length) {
+        uint64_t pages = (static_cast<uint64_t>(length) + PAGE_SIZE - 1) >> PAGE_SHIFT;
+        if (Table::LARGE_PAGES && PageSizeConfig::current().usesLargePages()) {
+            return pages * MemoryManager::getInstance().getLargePageFrames();
+        }
+        return pages;
+    }
+
+    void access_Memory_neg(uint64_t logical_address) {
+        uint64_t virtual_page = (logical_address >> PAGE_SHIFT) & PAGE_MASK;
+        uint32_t physical_page_number;
+        uint32_t* pte = page_table.find(virtual_page);
+        bool shared = pte != nullptr && (*pte & (PTE_SHARED | PTE_COW));
+
+        // A swapped-out page only holds a swap slot
+        if (swapped) {
+            SwapMap::iterator it = swapped->find(virtual_page);
+            if (it != swapped->end()) {
+                SwapDevice::getInstance().discard(it->second);
+                swapped->erase(it);
+                TRACE_EVENT(1, events, EVENT_DEALLOCATE, virtual_page, 0);
+                return;
+            }
+        }
+
+        // A large page is released as a whole
+        if (large_pages && page_table.unmapLarge(virtual_page, physical_page_number)) {
+            MemoryManager::getInstance().deallocateLargePage(physical_page_number);
+            invalidateTLB(virtual_page, true);
+            TRACE_EVENT(1, events, EVENT_DEALLOCATE, virtual_page, physical_page_number);
+            return;
+        }
+
+        if (page_table.unmap(virtual_page, physical_page_number)) {
+            // A shared frame is freed once its last mapping is gone
+            if (!shared || !SharedFrames::getInstance().unmap(physical_page_number, this, virtual_page)) {
+                MemoryManager::getInstance().deallocatePage(physical_page_number);
+            }
+
+            // Invalidate the TLB entry
+            invalidateTLB(virtual_page, false);
+            invalidateWalk(virtual_page);
+
+            TRACE_EVENT(1, events, EVENT_DEALLOCATE, virtual_page, physical_page_number);
+        } else {
+            std::cout << "Page is not allocated" << std::endl;
+        }
+    }
+
+    // Called by the memory manager when it takes the page's frame back (or
+    // by SharedFrames, once per mapping of a shared frame); a private base
+    // page goes to swap, if configured
+    void evictPage(uint64_t virtual_page) override {
+        uint32_t physical_page;
+        if (large_pages && page_table.unmapLarge(virtual_page, physical_page)) {
+            invalidateTLB(virtual_page, true);
+            TRACE_EVENT(1, events, EVENT_EVICT, virtual_page, physical_page);
+            return;
+        }
+        uint32_t* pte = page_table.find(virtual_page);
+        bool shared = pte != nullptr && (*pte & (PTE_SHARED | PTE_COW));
+        if (page_table.unmap(virtual_page, physical_page)) {
+            invalidateTLB(virtual_page, false);
+            invalidateWalk(virtual_page);
+            TRACE_EVENT(1, events, EVENT_EVICT, virtual_page, physical_page);
+            if (!shared && SwapDevice::getInstance().isEnabled()) swapOut(virtual_page);
+        }
+    }
+
+    // Heap bytes held by the task (page table, private TLB, swapped-out
+    // pages). Swapped pages count as a node and a bucket each, whatever the
+    // map's capacity, so a restored task reports the same.
+    size_t getMemoryUsage() const {
+        size_t bytes = page_table.getMemoryUsage() + (own_tlb ? own_tlb->getMemoryUsage() : 0);
+        if (swapped) {
+            bytes += swapped->size() * (sizeof(SwapMap::value_type) + 2 * sizeof(void*));
+        }
+        return bytes;
+    }
+
+    // Adds the counts of the private TLB, if any, to stats
+    void addTranslationStats(TranslationStats& stats) const {
+        if (own_tlb) {
+            stats.add(own_tlb->getTranslationStats());
+        }
+    }
+
+    // Counts for the metrics export
+    TaskMetrics getMetrics() const {
+        TaskMetrics metrics;
+        metrics.id = task_id;
+        metrics.page_hits = page_hits;
+        metrics.page_misses = page_misses;
+        metrics.cow_faults = cow_faults;
+        metrics.major_faults = major_faults;
+        if (own_tlb) {
+            TranslationStats translation = own_tlb->getTranslationStats();
+            metrics.tlb_lookups = translation.lookups;
+            metrics.tlb_misses = translation.misses;
+        }
+        metrics.mapped_pages = page_table.getMappedPageCount();
+        metrics.large_pages = page_table.getLargePageCount();
+        metrics.page_tables = page_table.getTableCount();
+        return metrics;
+    }
+
+    // Counters, page table, swapped-out pages and private TLB
+    // (checkpoints); restore() fills a task just created with the same id
+    void save(CheckpointWriter& out) const {
+        out.beginSection("TASK");
+        out.putString(task_id);
+        out.put<uint32_t>(page_hits);
+        out.put<uint32_t>(page_misses);
+        out.put<uint32_t>(cow_faults);
+        out.put<uint32_t>(major_faults);
+        out.put<uint32_t>(out_of_range);
+        page_table.save(out);
+        std::vector<uint64_t> swapped_pages;
+        std::vector<uint32_t> swap_slots;
+        if (swapped) {
+            for (SwapMap::const_iterator it = swapped->begin(); it != swapped->end(); ++it) {
+                swapped_pages.push_back(it->first);
+                swap_slots.push_back(it->second);
+            }
+        }
+        out.putVector(swapped_pages);
+        out.putVector(swap_slots);
+        out.put<uint8_t>(own_tlb ? 1 : 0);
+        if (own_tlb) own_tlb->save(out);
+        out.endSection();
+    }
+
+    void restore(CheckpointReader& in) {
+        if (!in.beginSection("TASK")) return;
+        if (in.getString() != task_id) {
+            in.fail();
+            return;
+        }
+        page_hits = in.get<uint32_t>();
+        page_misses = in.get<uint32_t>();
+        cow_faults = in.get<uint32_t>();
+        major_faults = in.get<uint32_t>();
+        out_of_range = in.get<uint32_t>();
+        page_table.restore(in);
+        std::vector<uint64_t> swapped_pages;
+        std::vector<uint32_t> swap_slots;
+        in.getVector(swapped_pages);
+        in.getVector(swap_slots);
+        if (swapped_pages.size() != swap_slots.size()) {
+            in.fail();
+            return;
+        }
+        if (!swapped_pages.empty()) swapped.reset(new SwapMap());
+        for (size_t i = 0; i < swapped_pages.size(); ++i) {
+            (*swapped)[swapped_pages[i]] = swap_slots[i];
+        }
+        if (in.get<uint8_t>() != 0) {
+            own_tlb.reset(new TLB());
+            own_tlb->restore(in);
+        }
+        in.endSection();
+    }
+};
+
+template <template <uint32_t> class PageTable, uint32_t PAGE_SHIFT>
+const uint32_t TranslationEngine<PageTable, PAGE_SHIFT>::PAGE_SIZE;
+template <template <uint32_t> class PageTable, uint32_t PAGE_SHIFT>
+const uint64_t TranslationEngine<PageTable, PAGE_SHIFT>::ADDRESS_MASK;
+template <template <uint32_t> class PageTable, uint32_t PAGE_SHIFT>
+const uint64_t TranslationEngine<PageTable, PAGE_SHIFT>::PAGE_MASK;
+template <template <uint32_t> class PageTable, uint32_t PAGE_SHIFT>
+const uint32_t TranslationEngine<PageTable, PAGE_SHIFT>::LARGE_ORDER;
+template <template <uint32_t> class PageTable, uint32_t PAGE_SHIFT>
+const uint32_t TranslationEngine<PageTable, PAGE_SHIFT>::RUN_PAGES;
+
+#endif // TRANSLATION_ENGINE_H
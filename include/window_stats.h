@@ -0,0 +1,67 @@
+#ifndef WINDOW_STATS_H
+#define WINDOW_STATS_H
+
+#include <cstdint>
+#include <vector>
+#include "metrics.h"
+
+// Live statistics over windows of the replay
+// With --window N and/or --window-seconds T the replay closes a window
+// every N trace records or T seconds and prints one line on stderr: TLB
+// hit rate and fault rate of the window's page accesses, frames in use,
+// the tasks with a record in the window and, with --swap, major faults.
+// Rates come from the metrics counters (collection is turned on for the
+// run) and frames from the memory manager, both summed per thread, and a
+// task is counted as active by stamping it with the window number, so
+// closing a window costs the same however many tasks there are. A parallel
+// replay's windows show what the workers have simulated so far.
+class WindowStats {
+private:
+    static const uint64_t CLOCK_CHECK_RECORDS = 256;   // records between clock reads
+
+    bool enabled;
+    uint64_t every_records;    // 0 = no record limit
+    uint64_t every_ns;         // 0 = no time limit
+    uint32_t window;           // number of the open window, from 1
+    uint64_t first_record;     // records replayed before the open window
+    uint64_t start_ns;
+    uint32_t active_tasks;
+    std::vector<uint32_t> task_window;           // by task number: last window it was active in
+    uint64_t counters[METRIC_COUNTER_COUNT];     // at the start of the open window
+
+    WindowStats();
+    void checkClock(uint64_t records);
+    void close(uint64_t records);
+
+public:
+    static WindowStats& getInstance();
+
+    WindowStats(const WindowStats&) = delete;
+    void operator=(const WindowStats&) = delete;
+
+    // Starts windowing after `records` records (non-zero after --restore);
+    // metrics collection must be on
+    void start(uint64_t records, uint64_t window_records, double window_seconds);
+
+    bool isEnabled() const { return enabled; }
+
+    // Called by the replay after each record, with the records so far
+    void add(uint32_t task_index, uint64_t records) {
+        if (!enabled) return;
+        if (task_index >= task_window.size()) task_window.resize(task_index + 1, 0);
+        if (task_window[task_index] != window) {
+            task_window[task_index] = window;
+            active_tasks++;
+        }
+        if (every_records != 0 && records - first_record >= every_records) {
+            close(records);
+        } else if (every_ns != 0 && records % CLOCK_CHECK_RECORDS == 0) {
+            checkClock(records);
+        }
+    }
+
+    // Prints the last, partial window (end of the replay)
+    void finish(uint64_t records);
+};
+
+#endif // WINDOW_STATS_H
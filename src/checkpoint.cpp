@@ -0,0 +1,254 @@
+#include "checkpoint.h"
+#include "trace_reader.h"
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+uint32_t checkpointChecksum(const char* data, size_t bytes) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < bytes; ++i) {
+        hash = (hash ^ static_cast<uint8_t>(data[i])) * 16777619u;
+    }
+    return hash;
+}
+
+CheckpointWriter::~CheckpointWriter() {
+    if (file) fclose(file);
+}
+
+bool CheckpointWriter::open(const std::string& filename, uint64_t records) {
+    file = fopen(filename.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Error creating checkpoint: " << filename << std::endl;
+        return false;
+    }
+    failed = false;
+    CheckpointHeader header = {CHECKPOINT_MAGIC, CHECKPOINT_VERSION, records};
+    write(&header, sizeof(header));
+    return true;
+}
+
+bool CheckpointWriter::close() {
+    if (!file) return false;
+    if (fclose(file) != 0) failed = true;
+    file = nullptr;
+    return !failed;
+}
+
+void CheckpointWriter::write(const void* data, size_t bytes) {
+    if (bytes > 0 && fwrite(data, 1, bytes, file) != bytes) failed = true;
+}
+
+void CheckpointWriter::align() {
+    section.resize((section.size() + 7) & ~static_cast<size_t>(7), 0);
+}
+
+uint32_t CheckpointWriter::ownerId(const PageOwner* owner) const {
+    if (owner == nullptr) return CHECKPOINT_OWNER_NONE;
+    auto it = owner_ids.find(owner);
+    return it != owner_ids.end() ? it->second : CHECKPOINT_OWNER_NONE;
+}
+
+void CheckpointWriter::beginSection(const char (&tag)[5]) {
+    section.clear();
+    section_tag = checkpointTag(tag);
+}
+
+void CheckpointWriter::endSection() {
+    CheckpointSection header = {section_tag, checkpointChecksum(section.data(), section.size()),
+                                section.size()};
+    align();
+    write(&header, sizeof(header));
+    write(section.data(), section.size());
+}
+
+CheckpointReader::CheckpointReader()
+    : data(nullptr), size(0), mapped(false), cursor(nullptr), section_end(nullptr), failed(false),
+      records(0), shared_owner(nullptr) {}
+
+CheckpointReader::~CheckpointReader() {
+    close();
+}
+
+bool CheckpointReader::open(const std::string& filename) {
+    close();
+
+#ifndef _WIN32
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* map = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map != MAP_FAILED) {
+                data = static_cast<const char*>(map);
+                size = static_cast<size_t>(st.st_size);
+                mapped = true;
+            }
+        }
+        ::close(fd);
+    }
+#endif
+    if (!mapped) {
+        // Fallback: read the whole file (8-byte aligned, like a mapping)
+        std::ifstream infile(filename, std::ios::binary);
+        if (!infile) {
+            std::cerr << "Error opening checkpoint: " << filename << std::endl;
+            return false;
+        }
+        std::string contents((std::istreambuf_iterator<char>(infile)), std::istreambuf_iterator<char>());
+        size = contents.size();
+        uint64_t* buffer = new uint64_t[size / 8 + 1];
+        memcpy(buffer, contents.data(), size);
+        data = reinterpret_cast<const char*>(buffer);
+    }
+
+    CheckpointHeader header;
+    if (size < sizeof(header)) {
+        std::cerr << "Not a checkpoint file: " << filename << std::endl;
+        close();
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+    if (header.magic != CHECKPOINT_MAGIC || header.version != CHECKPOINT_VERSION) {
+        std::cerr << "Not a checkpoint file, or an unsupported version: " << filename << std::endl;
+        close();
+        return false;
+    }
+    records = header.records;
+    cursor = data + sizeof(header);
+    section_end = cursor;
+    failed = false;
+    return true;
+}
+
+void CheckpointReader::close() {
+    if (data) {
+#ifndef _WIN32
+        if (mapped) {
+            munmap(const_cast<char*>(data), size);
+        } else
+#endif
+        {
+            delete[] reinterpret_cast<const uint64_t*>(data);
+        }
+    }
+    data = nullptr;
+    size = 0;
+    mapped = false;
+    cursor = nullptr;
+    section_end = nullptr;
+}
+
+void CheckpointReader::setOwner(uint32_t id, PageOwner* owner) {
+    if (id >= owners.size()) owners.resize(id + 1, nullptr);
+    owners[id] = owner;
+}
+
+PageOwner* CheckpointReader::owner(uint32_t id) {
+    if (id == CHECKPOINT_OWNER_NONE) return nullptr;
+    if (id == CHECKPOINT_OWNER_SHARED) return shared_owner;
+    if (id >= owners.size() || owners[id] == nullptr) {
+        failed = true;
+        return nullptr;
+    }
+    return owners[id];
+}
+
+const char* CheckpointReader::take(size_t bytes) {
+    if (failed || static_cast<size_t>(section_end - cursor) < bytes) {
+        failed = true;
+        return nullptr;
+    }
+    const char* p = cursor;
+    cursor += bytes;
+    return p;
+}
+
+void CheckpointReader::align() {
+    size_t offset = static_cast<size_t>(cursor - data);
+    size_t padding = ((offset + 7) & ~static_cast<size_t>(7)) - offset;
+    cursor = padding <= static_cast<size_t>(section_end - cursor) ? cursor + padding : section_end;
+}
+
+bool CheckpointReader::beginSection(const char (&tag)[5]) {
+    if (failed) return false;
+
+    const char* end = data + size;
+    CheckpointSection header;
+    if (static_cast<size_t>(end - section_end) < sizeof(header)) {
+        failed = true;
+        return false;
+    }
+    memcpy(&header, section_end, sizeof(header));
+    const char* payload = section_end + sizeof(header);
+    if (header.tag != checkpointTag(tag) || header.bytes > static_cast<uint64_t>(end - payload) ||
+        header.checksum != checkpointChecksum(payload, static_cast<size_t>(header.bytes))) {
+        failed = true;
+        return false;
+    }
+    cursor = payload;
+    section_end = payload + header.bytes;
+    return true;
+}
+
+void CheckpointReader::endSection() {
+    // Skip what the restoring code did not read, and the padding
+    cursor = section_end;
+    size_t offset = static_cast<size_t>(section_end - data);
+    size_t padded = (offset + 7) & ~static_cast<size_t>(7);
+    section_end = padded <= size ? data + padded : data + size;
+    cursor = section_end;
+}
+
+// The trace reader's position, kept here so that tools which only read
+// traces don't link the checkpoint code
+void TraceReader::save(CheckpointWriter& out) const {
+    out.beginSection("TRCE");
+    out.put<uint8_t>(binary);
+    out.put<uint64_t>(size);
+    out.put<uint64_t>(static_cast<uint64_t>(cursor - data));
+    out.put<uint32_t>(block_remaining);
+    out.put<uint32_t>(last_task);
+    out.putVector(last_address);
+    out.put<uint64_t>(task_names.size());
+    if (!binary) {
+        for (size_t i = 0; i < task_names.size(); ++i) {
+            out.put<uint64_t>(static_cast<uint64_t>(task_names[i].name - data));
+            out.put<uint32_t>(task_names[i].length);
+        }
+    }
+    out.endSection();
+}
+
+void TraceReader::restore(CheckpointReader& in) {
+    if (!in.beginSection("TRCE")) return;
+    bool saved_binary = in.get<uint8_t>() != 0;
+    uint64_t saved_size = in.get<uint64_t>();
+    uint64_t offset = in.get<uint64_t>();
+    if (data == nullptr || saved_binary != binary || saved_size != size || offset > size) {
+        in.fail();
+        return;
+    }
+    cursor = data + offset;
+    block_remaining = in.get<uint32_t>();
+    uint32_t saved_last_task = in.get<uint32_t>();
+    in.getVector(last_address);
+    uint64_t count = in.get<uint64_t>();
+    if (binary) {
+        if (count != task_names.size() || last_address.size() != binary_tasks.size()) in.fail();
+    } else {
+        for (uint64_t i = 0; i < count && in.ok(); ++i) {
+            uint64_t name = in.get<uint64_t>();
+            uint32_t length = in.get<uint32_t>();
+            if (name > size || length > size - name || internTask(data + name, length) != i) in.fail();
+        }
+    }
+    last_task = saved_last_task;
+    in.endSection();
+}
@@ -0,0 +1,202 @@
+#include "cpu_tlb.h"
+#include "checkpoint.h"
+#include <iostream>
+
+CpuTLBs& CpuTLBs::getInstance() {
+    static CpuTLBs instance;
+    return instance;
+}
+
+void CpuTLBs::configure(const CpuTLBConfig& cfg) {
+    config = cfg;
+    cpus.clear();
+    for (unsigned i = 0; i < config.cpus; ++i) {
+        cpus.push_back(std::unique_ptr<Cpu>(new Cpu()));
+    }
+}
+
+CpuTLBs::Context* CpuTLBs::registerTask() {
+    if (cpus.empty()) return nullptr;
+
+    std::lock_guard<std::mutex> lock(contexts_lock);
+    Context* context = new Context();
+    context->cpu = static_cast<unsigned>(contexts.size() % cpus.size());
+    context->asid = 0;
+    context->generation = 0;
+    contexts.push_back(std::unique_ptr<Context>(context));
+    return context;
+}
+
+void CpuTLBs::contextSwitch(Cpu& cpu, Context& context) {
+    if (cpu.current != nullptr) {
+        cpu.context_switches++;
+    }
+
+    if (config.mode == SWITCH_FLUSH) {
+        if (cpu.current != nullptr) {
+            cpu.flushed_entries += cpu.tlb.invalidateAll();
+            cpu.flushes++;
+        }
+    } else {
+        if (context.generation != cpu.generation) {
+            if (cpu.next_asid == config.asids) {
+                // Out of ASIDs: new generation, nothing cached may be reused
+                cpu.generation++;
+                cpu.rollovers++;
+                cpu.flushed_entries += cpu.tlb.invalidateAll();
+                cpu.flushes++;
+                cpu.next_asid = 0;
+            }
+            context.asid = cpu.next_asid++;
+            context.generation = cpu.generation;
+        }
+        cpu.tlb.setASID(context.asid);
+    }
+    cpu.current = &context;
+}
+
+bool CpuTLBs::holdsEntries(const Cpu& cpu, const Context& context) const {
+    // Entries of a task that is switched out are already gone in flush mode,
+    // and so are those of an ASID from an older generation
+    return config.mode == SWITCH_FLUSH ? cpu.current == &context
+                                       : context.generation == cpu.generation;
+}
+
+void CpuTLBs::invalidate(const Context& context, uint64_t virtual_page, bool large) {
+    Cpu& cpu = *cpus[context.cpu];
+    if (!holdsEntries(cpu, context)) return;
+
+    uint32_t current_asid = cpu.tlb.getASID();
+    cpu.tlb.setASID(context.asid);
+    if (large) {
+        cpu.tlb.invalidateLarge(virtual_page);
+    } else {
+        cpu.tlb.invalidate(virtual_page);
+    }
+    cpu.tlb.setASID(current_asid);
+}
+
+void CpuTLBs::invalidateWalk(const Context& context, uint64_t directory_key) {
+    Cpu& cpu = *cpus[context.cpu];
+    if (!holdsEntries(cpu, context)) return;
+
+    uint32_t current_asid = cpu.tlb.getASID();
+    cpu.tlb.setASID(context.asid);
+    cpu.tlb.invalidateWalk(directory_key);
+    cpu.tlb.setASID(current_asid);
+}
+
+void CpuTLBs::addTranslationStats(TranslationStats& stats) const {
+    for (size_t i = 0; i < cpus.size(); ++i) {
+        stats.add(cpus[i]->tlb.getTranslationStats());
+    }
+}
+
+void CpuTLBs::printStats() const {
+    if (cpus.empty()) return;
+
+    std::cout << "\n=== Shared TLBs (" << cpus.size() << (cpus.size() == 1 ? " CPU, " : " CPUs, ")
+              << (config.mode == SWITCH_FLUSH ? "flush on switch" : "ASID-tagged") << ") ===\n";
+    if (config.mode == SWITCH_ASID) {
+        std::cout << "ASIDs per CPU: " << config.asids << "\n";
+    }
+    for (size_t i = 0; i < cpus.size(); ++i) {
+        const Cpu& cpu = *cpus[i];
+        uint32_t hits, misses;
+        cpu.tlb.getStats(hits, misses);
+        uint32_t total = hits + misses;
+        double hit_rate = total > 0 ? (static_cast<double>(hits) / total) * 100 : 0;
+
+        std::cout << "CPU " << i << " - TLB Hits: " << hits << ", TLB Misses: " << misses
+                  << ", Hit Rate: " << hit_rate << "%\n";
+        std::cout << "  Context Switches: " << cpu.context_switches
+                  << ", Full Flushes: " << cpu.flushes
+                  << ", Entries Flushed: " << cpu.flushed_entries;
+        if (config.mode == SWITCH_ASID) {
+            std::cout << ", ASID Rollovers: " << cpu.rollovers;
+        }
+        std::cout << ", Cross-task Evictions: " << cpu.tlb.getForeignEvictions() << "\n";
+        std::cout << "  ";
+        cpu.tlb.getTranslationStats().printLatency(cpu.tlb.getConfig());
+    }
+}
+
+void CpuTLBs::printTranslationCost(const TranslationStats& private_tlbs) const {
+    TranslationStats total = private_tlbs;
+    addTranslationStats(total);
+    const TLBConfig& costs = TLB::getDefaultConfig();
+    bool has_l2 = costs.l2_sets != 0;
+
+    std::cout << "\n=== Translation Cost ===\n";
+    std::cout << "Cycles: L1 TLB " << costs.l1_cycles;
+    if (has_l2) {
+        std::cout << ", L2 TLB " << costs.l2_cycles;
+    }
+    if (costs.walk_cache_entries > 0) {
+        std::cout << ", Walk Cache " << costs.walk_cache_cycles;
+    }
+    std::cout << ", Page-Table Read " << costs.memory_cycles << "\n";
+
+    std::cout << "Lookups: " << total.lookups << ", L1 Hits: " << total.lookups - total.l2_hits - total.misses;
+    if (has_l2) {
+        std::cout << ", L2 Hits: " << total.l2_hits;
+    }
+    std::cout << ", Page Walks: " << total.misses << " (";
+    if (costs.walk_cache_entries > 0) {
+        std::cout << "walk cache hits: " << total.walk_cache_hits << ", ";
+    }
+    std::cout << "page-table reads: " << total.walk_reads << ")\n";
+    std::cout << "Total Cycles: " << total.cycles(costs) << ", Page Walk Cycles: " << total.walkCycles(costs) << "\n";
+    total.printLatency(costs);
+}
+
+void CpuTLBs::save(CheckpointWriter& out) const {
+    out.beginSection("CPUT");
+    out.put<uint64_t>(cpus.size());
+    out.put<uint64_t>(contexts.size());
+    for (size_t i = 0; i < contexts.size(); ++i) {
+        out.put<Context>(*contexts[i]);
+    }
+    for (size_t i = 0; i < cpus.size(); ++i) {
+        const Cpu& cpu = *cpus[i];
+        // The running context, as its registration number
+        uint64_t current = UINT64_MAX;
+        for (size_t n = 0; n < contexts.size() && cpu.current != nullptr; ++n) {
+            if (contexts[n].get() == cpu.current) current = n;
+        }
+        out.put<uint64_t>(current);
+        out.put<uint64_t>(cpu.generation);
+        out.put<uint32_t>(cpu.next_asid);
+        out.put<uint64_t>(cpu.context_switches);
+        out.put<uint64_t>(cpu.flushes);
+        out.put<uint64_t>(cpu.flushed_entries);
+        out.put<uint64_t>(cpu.rollovers);
+        cpu.tlb.save(out);
+    }
+    out.endSection();
+}
+
+void CpuTLBs::restore(CheckpointReader& in) {
+    if (!in.beginSection("CPUT")) return;
+    if (in.get<uint64_t>() != cpus.size() || in.get<uint64_t>() != contexts.size()) {
+        in.fail();
+        return;
+    }
+    for (size_t i = 0; i < contexts.size(); ++i) {
+        *contexts[i] = in.get<Context>();
+        if (!cpus.empty() && contexts[i]->cpu >= cpus.size()) in.fail();
+    }
+    for (size_t i = 0; i < cpus.size() && in.ok(); ++i) {
+        Cpu& cpu = *cpus[i];
+        uint64_t current = in.get<uint64_t>();
+        cpu.current = current < contexts.size() ? contexts[current].get() : nullptr;
+        cpu.generation = in.get<uint64_t>();
+        cpu.next_asid = in.get<uint32_t>();
+        cpu.context_switches = in.get<uint64_t>();
+        cpu.flushes = in.get<uint64_t>();
+        cpu.flushed_entries = in.get<uint64_t>();
+        cpu.rollovers = in.get<uint64_t>();
+        cpu.tlb.restore(in);
+    }
+    in.endSection();
+}
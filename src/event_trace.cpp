@@ -0,0 +1,151 @@
+#include "event_trace.h"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+const size_t EventRing::CAPACITY;
+
+EventRing::EventRing(uint32_t index, EventTracer* owner)
+    : head(0), tail(0), task_index(index), tracer(owner) {}
+
+void EventRing::record(EventType type, uint64_t virtual_page, uint32_t physical_page) {
+    size_t h = head.load(std::memory_order_relaxed);
+
+    // Ring full: wake the writer and wait for it to make room (lossless)
+    while (h - tail.load(std::memory_order_acquire) >= CAPACITY) {
+        tracer->notifyWriter();
+        std::this_thread::yield();
+    }
+
+    EventRecord& r = records[h & (CAPACITY - 1)];
+    r.sequence = tracer->sequence.fetch_add(1, std::memory_order_relaxed);
+    r.task = task_index;
+    r.virtual_page = virtual_page;
+    r.physical_page = physical_page;
+    r.type = type;
+    r.reserved = 0;
+    head.store(h + 1, std::memory_order_release);
+}
+
+size_t EventRing::drain(std::vector<EventRecord>& out) {
+    size_t t = tail.load(std::memory_order_relaxed);
+    size_t h = head.load(std::memory_order_acquire);
+    for (size_t i = t; i != h; ++i) {
+        out.push_back(records[i & (CAPACITY - 1)]);
+    }
+    tail.store(h, std::memory_order_release);
+    return h - t;
+}
+
+EventTracer::EventTracer()
+    : file(nullptr), sequence(0), system_ring(nullptr), stopping(false) {}
+
+EventTracer::~EventTracer() {
+    close();
+}
+
+EventTracer& EventTracer::getInstance() {
+    static EventTracer instance;
+    return instance;
+}
+
+bool EventTracer::open(const std::string& filename, EventLogMode mode, uint32_t page_size_kb) {
+    if (EVENT_TRACE_LEVEL == 0) {
+        std::cerr << "Event tracing was compiled out (EVENT_TRACE_LEVEL=0)" << std::endl;
+        return false;
+    }
+    close();
+
+    file = fopen(filename.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Error opening event log: " << filename << std::endl;
+        return false;
+    }
+
+    EventLogHeader header = {EVENT_LOG_MAGIC, EVENT_LOG_VERSION,
+                             static_cast<uint32_t>(mode), sizeof(EventRecord), page_size_kb, 0};
+    fwrite(&header, sizeof(header), 1, file);
+
+    sequence = 0;
+    stopping = false;
+    system_ring = new EventRing(EVENT_NO_TASK, this);
+    rings.push_back(system_ring);
+    writer = std::thread(&EventTracer::writerLoop, this);
+    return true;
+}
+
+void EventTracer::close() {
+    if (!file) return;
+
+    stopping = true;
+    notifyWriter();
+    writer.join();
+
+    // Anything recorded after the writer's last pass
+    std::vector<EventRecord> buffer;
+    drainAll(buffer);
+
+    for (size_t i = 0; i < rings.size(); ++i) {
+        delete rings[i];
+    }
+    rings.clear();
+    system_ring = nullptr;
+
+    fclose(file);
+    file = nullptr;
+}
+
+EventRing* EventTracer::registerTask(const std::string& task_id) {
+    if (!file) return nullptr;
+
+    std::lock_guard<std::mutex> lock(rings_mutex);
+    uint32_t index = static_cast<uint32_t>(rings.size() - 1);   // slot 0 is the system ring
+
+    // Name the task before any of its records can reach the file
+    std::vector<char> payload(sizeof(uint32_t) + task_id.size());
+    memcpy(&payload[0], &index, sizeof(uint32_t));
+    memcpy(&payload[sizeof(uint32_t)], task_id.data(), task_id.size());
+    writeBlock(EVENT_BLOCK_TASK, &payload[0], static_cast<uint32_t>(payload.size()));
+
+    EventRing* ring = new EventRing(index, this);
+    rings.push_back(ring);
+    return ring;
+}
+
+void EventTracer::notifyWriter() {
+    wake.notify_one();
+}
+
+// Must be called with rings_mutex held (or with the writer stopped)
+void EventTracer::writeBlock(uint32_t type, const void* data, uint32_t length) {
+    EventBlockHeader block = {type, length};
+    fwrite(&block, sizeof(block), 1, file);
+    fwrite(data, 1, length, file);
+}
+
+size_t EventTracer::drainAll(std::vector<EventRecord>& buffer) {
+    std::lock_guard<std::mutex> lock(rings_mutex);
+    size_t total = 0;
+    for (size_t i = 0; i < rings.size(); ++i) {
+        buffer.clear();
+        size_t n = rings[i]->drain(buffer);
+        if (n > 0) {
+            writeBlock(EVENT_BLOCK_RECORDS, &buffer[0],
+                       static_cast<uint32_t>(n * sizeof(EventRecord)));
+            total += n;
+        }
+    }
+    return total;
+}
+
+void EventTracer::writerLoop() {
+    std::vector<EventRecord> buffer;
+    buffer.reserve(EventRing::CAPACITY);
+    while (!stopping) {
+        if (drainAll(buffer) == 0) {
+            // Nothing pending: sleep until a producer fills up or a short timeout
+            std::unique_lock<std::mutex> lock(wake_mutex);
+            wake.wait_for(lock, std::chrono::milliseconds(2));
+        }
+    }
+}
@@ -0,0 +1,130 @@
+#include "frame_allocator.h"
+#include "checkpoint.h"
+
+namespace {
+
+// Full word with only the low `bits` bits set (bits in 1..64)
+inline uint64_t lowMask(uint32_t bits) {
+    return bits >= 64 ? ~0ULL : ((1ULL << bits) - 1);
+}
+
+inline uint32_t lowestSetBit(uint64_t word) {
+    return static_cast<uint32_t>(__builtin_ctzll(word));
+}
+
+} // namespace
+
+FrameAllocator::FrameAllocator(uint32_t frame_count, uint32_t first)
+    : first_frame(first), total_frames(frame_count), free_frames(frame_count) {
+    // Every level starts fully free, so each one is just a run of set bits
+    uint32_t bits = frame_count;
+    do {
+        uint32_t words = bits > 0 ? (bits + 63) / 64 : 1;
+        std::vector<uint64_t> level(words, ~0ULL);
+        if (bits == 0) {
+            level.back() = 0;
+        } else if (bits % 64) {
+            level.back() = lowMask(bits % 64);
+        }
+        levels.push_back(level);
+        bits = words;
+    } while (bits > 1);
+}
+
+bool FrameAllocator::allocate(uint32_t& frame) {
+    if (free_frames == 0) return false;
+
+    // Walk down from the top summary word, always taking the first free slot
+    uint32_t index = 0;
+    for (size_t l = levels.size(); l-- > 0;) {
+        index = index * 64 + lowestSetBit(levels[l][index]);
+    }
+    markUsed(index);
+    frame = first_frame + index;
+    return true;
+}
+
+bool FrameAllocator::free(uint32_t frame) {
+    if (!isAllocated(frame)) return false;
+    markFree(frame - first_frame);
+    return true;
+}
+
+bool FrameAllocator::allocateRange(uint32_t count, uint32_t& first) {
+    uint32_t words = count / 64;
+    if (words == 0 || count % 64 != 0 || free_frames < count) return false;
+
+    // A run is free when all of its bitmap words are full (the partial last
+    // word never is, so runs never reach past the end)
+    const std::vector<uint64_t>& bitmap = levels[0];
+    for (size_t start = 0; start + words <= bitmap.size(); start += words) {
+        uint32_t w = 0;
+        while (w < words && bitmap[start + w] == ~0ULL) {
+            w++;
+        }
+        if (w < words) continue;
+
+        uint32_t index = static_cast<uint32_t>(start * 64);
+        for (uint32_t i = 0; i < count; ++i) {
+            markUsed(index + i);
+        }
+        first = first_frame + index;
+        return true;
+    }
+    return false;
+}
+
+void FrameAllocator::freeRange(uint32_t first, uint32_t count) {
+    for (uint32_t i = 0; i < count; ++i) {
+        free(first + i);
+    }
+}
+
+bool FrameAllocator::isAllocated(uint32_t frame) const {
+    if (!contains(frame)) return false;
+    uint32_t index = frame - first_frame;
+    return (levels[0][index / 64] & (1ULL << (index % 64))) == 0;
+}
+
+void FrameAllocator::markUsed(uint32_t index) {
+    free_frames--;
+    // Clear the bit, and only propagate upwards when the word became empty
+    for (size_t l = 0; l < levels.size(); ++l) {
+        uint64_t& word = levels[l][index / 64];
+        word &= ~(1ULL << (index % 64));
+        if (word != 0) break;
+        index /= 64;
+    }
+}
+
+void FrameAllocator::markFree(uint32_t index) {
+    free_frames++;
+    // Set the bit, and only propagate upwards when the word was empty before
+    for (size_t l = 0; l < levels.size(); ++l) {
+        uint64_t& word = levels[l][index / 64];
+        bool was_empty = (word == 0);
+        word |= 1ULL << (index % 64);
+        if (!was_empty) break;
+        index /= 64;
+    }
+}
+
+void FrameAllocator::save(CheckpointWriter& out) const {
+    out.put<uint32_t>(first_frame);
+    out.put<uint32_t>(total_frames);
+    out.put<uint32_t>(free_frames);
+    for (size_t l = 0; l < levels.size(); ++l) {
+        out.putVector(levels[l]);
+    }
+}
+
+void FrameAllocator::restore(CheckpointReader& in) {
+    if (in.get<uint32_t>() != first_frame || in.get<uint32_t>() != total_frames) {
+        in.fail();
+        return;
+    }
+    free_frames = in.get<uint32_t>();
+    for (size_t l = 0; l < levels.size(); ++l) {
+        in.getArrayInto(levels[l].data(), levels[l].size());
+    }
+}
@@ -0,0 +1,216 @@
+#include "inverted_page_table.h"
+#include "checkpoint.h"
+#include "memory_manager.h"
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+
+std::mutex InvertedPageTable::instance_lock;
+std::unique_ptr<InvertedPageTable> InvertedPageTable::instance;
+
+static std::atomic<uint32_t> next_space_id(0);
+
+InvertedSpace::InvertedSpace() : id(InvertedPageTable::nextSpaceId()), head(INVERTED_NONE), pages(0) {}
+
+InvertedPageTable::InvertedPageTable(uint32_t frames)
+    : frame_count(frames), alias_end(frames), alias_count(0), entry_count(0) {
+    // At least one anchor per frame entry, so chains stay short until
+    // aliases pile up
+    uint32_t bits = 6;
+    while ((1ULL << bits) < frames) bits++;
+    anchor_shift = 64 - bits;
+    anchors.assign(static_cast<size_t>(1) << bits, INVERTED_NONE);
+    blocks.resize((static_cast<size_t>(frames) + BLOCK_ENTRIES - 1) >> BLOCK_SHIFT);
+}
+
+InvertedPageTable& InvertedPageTable::getInstance() {
+    std::lock_guard<std::mutex> lock(instance_lock);
+    if (!instance) {
+        instance.reset(new InvertedPageTable(MemoryManager::getInstance().getTotalPageCount()));
+    }
+    return *instance;
+}
+
+uint32_t InvertedPageTable::nextSpaceId() {
+    return next_space_id.fetch_add(1, std::memory_order_relaxed);
+}
+
+// The frame's own entry if it is free, otherwise an alias entry
+uint32_t InvertedPageTable::takeEntry(uint32_t frame) {
+    uint32_t index;
+    if (frame < frame_count && (!blocks[frame >> BLOCK_SHIFT] || at(frame).space == INVERTED_NONE)) {
+        index = frame;
+    } else if (!free_aliases.empty()) {
+        index = free_aliases.back();
+        free_aliases.pop_back();
+    } else {
+        index = alias_end++;
+    }
+    if (index >= frame_count) {
+        alias_count++;
+        stats.aliases++;
+        stats.peak_aliases = std::max<uint64_t>(stats.peak_aliases, alias_count);
+    }
+
+    size_t block = index >> BLOCK_SHIFT;
+    if (block >= blocks.size()) blocks.resize(block + 1);
+    if (!blocks[block]) {
+        blocks[block].reset(new Entry[BLOCK_ENTRIES]);
+        for (uint32_t i = 0; i < BLOCK_ENTRIES; ++i) {
+            blocks[block][i].space = INVERTED_NONE;
+        }
+    }
+    return index;
+}
+
+void InvertedPageTable::freeEntry(uint32_t index) {
+    at(index).space = INVERTED_NONE;
+    if (index >= frame_count) {
+        free_aliases.push_back(index);
+        alias_count--;
+    }
+}
+
+// Takes the entry off its space's list
+void InvertedPageTable::unlink(InvertedSpace& space, uint32_t index) {
+    Entry& entry = at(index);
+    if (entry.space_prev != INVERTED_NONE) {
+        at(entry.space_prev).space_next = entry.space_next;
+    } else {
+        space.head = entry.space_next;
+    }
+    if (entry.space_next != INVERTED_NONE) {
+        at(entry.space_next).space_prev = entry.space_prev;
+    }
+    space.pages--;
+    entry_count--;
+}
+
+void InvertedPageTable::map(InvertedSpace& space, uint64_t virtual_page, uint32_t frame, uint32_t flags) {
+    uint32_t previous_frame;
+    unmap(space, virtual_page, previous_frame);
+
+    uint32_t index = takeEntry(frame);
+    uint32_t& anchor = anchors[bucket(space.id, virtual_page)];
+    Entry& entry = at(index);
+    entry.virtual_page = virtual_page;
+    entry.space = space.id;
+    entry.pte = makePTE(frame, flags | PTE_PRESENT);
+    entry.chain_next = anchor;
+    anchor = index;
+
+    entry.space_prev = INVERTED_NONE;
+    entry.space_next = space.head;
+    if (space.head != INVERTED_NONE) {
+        at(space.head).space_prev = index;
+    }
+    space.head = index;
+    space.pages++;
+    entry_count++;
+}
+
+bool InvertedPageTable::unmap(InvertedSpace& space, uint64_t virtual_page, uint32_t& frame) {
+    uint32_t* link = &anchors[bucket(space.id, virtual_page)];
+    while (*link != INVERTED_NONE) {
+        uint32_t index = *link;
+        Entry& entry = at(index);
+        if (entry.virtual_page == virtual_page && entry.space == space.id) {
+            *link = entry.chain_next;
+            frame = pteFrame(entry.pte);
+            unlink(space, index);
+            freeEntry(index);
+            return true;
+        }
+        link = &entry.chain_next;
+    }
+    return false;
+}
+
+void InvertedPageTable::clear(InvertedSpace& space) {
+    uint32_t frame;
+    while (space.head != INVERTED_NONE) {
+        unmap(space, at(space.head).virtual_page, frame);
+    }
+}
+
+size_t InvertedPageTable::getMemoryUsage() const {
+    // By size rather than capacity, so a restored table reports the same
+    size_t bytes = sizeof(InvertedPageTable) + anchors.size() * sizeof(uint32_t) +
+                   blocks.size() * sizeof(blocks[0]) + free_aliases.size() * sizeof(uint32_t);
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        if (blocks[i]) bytes += BLOCK_ENTRIES * sizeof(Entry);
+    }
+    return bytes;
+}
+
+void InvertedPageTable::printStats() {
+    std::lock_guard<std::mutex> lock(instance_lock);
+    if (!instance) return;
+
+    const InvertedPageTable& table = *instance;
+    uint64_t slots = 0;
+    for (size_t b = 0; b < table.blocks.size(); ++b) {
+        if (table.blocks[b]) slots += BLOCK_ENTRIES;
+    }
+    const InvertedStats& stats = table.stats;
+
+    std::cout << "\n=== Inverted Page Table ===\n";
+    std::cout << "Memory: " << table.getMemoryUsage() << " bytes (" << table.anchors.size() << " anchors, " << slots
+              << " entries of " << getEntrySize() << " bytes)\n";
+    std::cout << "Mappings: " << table.entry_count << " (aliases: " << table.alias_count
+              << ", peak: " << stats.peak_aliases << ")\n";
+    std::cout << "Lookups: " << stats.lookups << ", Average Probes: "
+              << (stats.lookups > 0 ? static_cast<double>(stats.probes) / stats.lookups : 0.0) << "\n";
+}
+
+void InvertedPageTable::save(CheckpointWriter& out) {
+    out.beginSection("IPTB");
+    const InvertedPageTable* table = instance.get();
+    out.put<uint8_t>(table != nullptr);
+    if (table) {
+        out.put<uint32_t>(table->frame_count);
+        out.putVector(table->anchors);
+        out.put<uint64_t>(table->blocks.size());
+        for (size_t b = 0; b < table->blocks.size(); ++b) {
+            out.put<uint8_t>(table->blocks[b] != nullptr);
+            if (table->blocks[b]) out.putArray(table->blocks[b].get(), BLOCK_ENTRIES);
+        }
+        out.put<uint32_t>(table->alias_end);
+        out.putVector(table->free_aliases);
+        out.put<uint32_t>(table->alias_count);
+        out.put<uint32_t>(table->entry_count);
+        out.put<InvertedStats>(table->stats);
+    }
+    out.endSection();
+}
+
+void InvertedPageTable::restore(CheckpointReader& in) {
+    if (!in.beginSection("IPTB")) return;
+    if (in.get<uint8_t>()) {
+        InvertedPageTable& table = getInstance();
+        if (in.get<uint32_t>() != table.frame_count) {
+            in.fail();
+            return;
+        }
+        size_t anchor_count = table.anchors.size();
+        in.getVector(table.anchors);
+        if (table.anchors.size() != anchor_count) {
+            in.fail();
+            return;
+        }
+        uint64_t block_count = in.get<uint64_t>();
+        table.blocks.clear();
+        table.blocks.resize(static_cast<size_t>(block_count));
+        for (uint64_t b = 0; b < block_count && in.ok(); ++b) {
+            if (!in.get<uint8_t>()) continue;
+            table.blocks[b].reset(new Entry[BLOCK_ENTRIES]);
+            in.getArrayInto(table.blocks[b].get(), BLOCK_ENTRIES);
+        }
+        table.alias_end = in.get<uint32_t>();
+        in.getVector(table.free_aliases);
+        table.alias_count = in.get<uint32_t>();
+        table.entry_count = in.get<uint32_t>();
+        table.stats = in.get<InvertedStats>();
+    }
+    in.endSection();
+}
@@ -0,0 +1,6 @@
+// Inverted page table simulator (bin/inverted_pagetable)
+#include "../include/simulator.h"
+
+int main(int argc, char* argv[]) {
+    return runSimulator(argc, argv, PAGE_TABLE_INVERTED);
+}
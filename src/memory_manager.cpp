@@ -1,12 +1,16 @@
 #include "memory_manager.h"
+#include "checkpoint.h"
 #include "config.h"
+#include "metrics.h"
+#include <algorithm>
 #include <stdexcept>
 
-MemoryManager::MemoryManager() {
-    total_pages = PHYSICAL_MEMORY_SIZE / (MIN_PAGE_SIZE_KB * 1024);
-    for (uint32_t i = 0; i < total_pages; ++i) {
-        free_pages.insert(i);
-    }
+thread_local MemoryManager::FrameCache* MemoryManager::local_cache = nullptr;
+
+MemoryManager::MemoryManager()
+    : frames(0), retired_allocated(0), policy(REPLACE_CLOCK), deferred(false), ordered(false), total_pages(0),
+      large_page_frames(0) {
+    configureMemory(PHYSICAL_MEMORY_SIZE);
 }
 
 MemoryManager& MemoryManager::getInstance() {
@@ -14,44 +18,501 @@ MemoryManager& MemoryManager::getInstance() {
     return instance;
 }
 
-uint32_t MemoryManager::allocatePage() {
-    if (free_pages.empty()) {
-        uint32_t page_to_replace;
-        bool replaced = false;
-        while (!page_allocation_order.empty()) {
-            page_to_replace = page_allocation_order.front();
-            page_allocation_order.pop();
-
-            if (allocated_pages.count(page_to_replace)) {
-                // This page is allocated, so we can replace it.
-                allocated_pages.erase(page_to_replace);
-                free_pages.insert(page_to_replace);
-                replaced = true;
-                std::cout << "Replaced page " << page_to_replace << std::endl;
-                break;
-            }
+void MemoryManager::configureMemory(uint64_t bytes, uint32_t frame_size_kb) {
+    std::lock_guard<std::mutex> lock(pool_lock);
+    frames = FrameAllocator(static_cast<uint32_t>(bytes / (frame_size_kb * 1024)));
+    total_pages = frames.getTotalCount();
+    large_page_frames = LARGE_PAGE_SIZE_KB / frame_size_kb;
+    frame_table.assign(total_pages, FrameEntry());
+    engine.reset(ReplacementEngine::create(policy, frame_table.data()));
+
+    size_t words = (total_pages + 63) / 64;
+    in_use.reset(new std::atomic<uint64_t>[words]);
+    for (size_t i = 0; i < words; ++i) {
+        in_use[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void MemoryManager::setReplacementPolicy(ReplacementPolicy replacement) {
+    policy = replacement;
+    engine.reset(ReplacementEngine::create(policy, frame_table.data()));
+}
+
+MemoryManager::FrameCache& MemoryManager::cache() {
+    if (local_cache == nullptr) {
+        local_cache = new FrameCache();
+        std::lock_guard<std::mutex> lock(pool_lock);
+        caches.push_back(local_cache);
+    }
+    return *local_cache;
+}
+
+void MemoryManager::configurePartitions(unsigned workers) {
+    std::lock_guard<std::mutex> lock(pool_lock);
+    partitions.clear();
+    if (workers <= 1) return;
+
+    uint32_t per_worker = (total_pages + workers - 1) / workers;
+    for (uint32_t first = 0; first < total_pages; first += per_worker) {
+        uint32_t count = std::min(per_worker, total_pages - first);
+        partitions.push_back(std::unique_ptr<FrameAllocator>(new FrameAllocator(count, first)));
+    }
+}
+
+void MemoryManager::attachThread(unsigned worker) {
+    FrameCache& c = cache();
+    std::lock_guard<std::mutex> lock(pool_lock);
+    c.worker = worker;
+    c.partition = partitions.empty() ? nullptr : partitions[worker % partitions.size()].get();
+}
+
+void MemoryManager::detachThread() {
+    if (local_cache == nullptr) return;
+
+    std::lock_guard<std::mutex> lock(pool_lock);
+    for (uint32_t i = 0; i < local_cache->count; ++i) {
+        frames.free(local_cache->frames[i]);
+    }
+    retired_allocated += local_cache->allocated.load(std::memory_order_relaxed);
+    retired_residency.insert(retired_residency.end(), local_cache->residency.begin(), local_cache->residency.end());
+    for (size_t i = 0; i < caches.size(); ++i) {
+        if (caches[i] == local_cache) {
+            caches.erase(caches.begin() + i);
+            break;
+        }
+    }
+    delete local_cache;
+    local_cache = nullptr;
+}
+
+void MemoryManager::deferReplacement() {
+    std::lock_guard<std::mutex> lock(pool_lock);
+    deferred = true;
+    frame_stamps.assign(total_pages, 0);
+}
+
+void MemoryManager::beginRecord(uint64_t sequence) {
+    cache().stamp = sequence << STAMP_SHIFT;
+}
+
+void MemoryManager::orderReplacement() {
+    std::lock_guard<std::mutex> lock(pool_lock);
+    if (!deferred) return;
+
+    // Magazines are bypassed from now on
+    for (size_t i = 0; i < caches.size(); ++i) {
+        for (uint32_t k = 0; k < caches[i]->count; ++k) {
+            frames.free(caches[i]->frames[k]);
         }
-        if (!replaced) {
-            throw std::runtime_error("Out of physical memory and no pages to replace!");
+        caches[i]->count = 0;
+    }
+
+    // Faults and the most pages resident at once, in trace order
+    std::vector<uint64_t> residency;
+    residency.swap(retired_residency);
+    for (size_t i = 0; i < caches.size(); ++i) {
+        residency.insert(residency.end(), caches[i]->residency.begin(), caches[i]->residency.end());
+        std::vector<uint64_t>().swap(caches[i]->residency);
+    }
+    std::sort(residency.begin(), residency.end());
+    uint64_t faults = 0;
+    uint32_t resident = 0;
+    uint32_t peak = 0;
+    for (size_t i = 0; i < residency.size(); ++i) {
+        if (residency[i] & 1) {
+            faults++;
+            peak = std::max(peak, ++resident);
+        } else {
+            resident--;
         }
     }
-    auto it = free_pages.begin();
-    uint32_t page_number = *it;
-    free_pages.erase(it);
-    allocated_pages.insert(page_number);
+
+    // The resident pages go to the engine in the order they came in; their
+    // accessed bits are those a serial run would have at this point
+    std::vector<std::pair<uint64_t, uint32_t>> pages;
+    for (uint32_t frame = 0; frame < total_pages; ++frame) {
+        if (frame_table[frame].owner != nullptr) {
+            pages.push_back(std::make_pair(frame_stamps[frame], frame));
+        }
+    }
+    std::sort(pages.begin(), pages.end());
+    for (size_t i = 0; i < pages.size(); ++i) {
+        FrameEntry& entry = frame_table[pages[i].second];
+        uint8_t accessed = entry.accessed;
+        engine->insert(pages[i].second);
+        entry.accessed = accessed;
+    }
+    engine->notePeakResident(peak);
+    deferred_stats.faults += faults - pages.size();
+
+    std::vector<uint64_t>().swap(frame_stamps);
+    deferred = false;
+    ordered = true;
+}
+
+uint32_t MemoryManager::getDeferredFrames(unsigned worker, unsigned workers) const {
+    std::lock_guard<std::mutex> lock(pool_lock);
+    if (!partitions.empty()) {
+        return partitions[worker % partitions.size()]->getTotalCount();
+    }
+    uint64_t cached = static_cast<uint64_t>(workers) * FRAME_CACHE_SIZE;
+    return total_pages > cached ? static_cast<uint32_t>(total_pages - cached) : 0;
+}
+
+// Sets or clears the frame's in-use bit; returns its previous state
+bool MemoryManager::markInUse(uint32_t page_number, bool used) {
+    std::atomic<uint64_t>& word = in_use[page_number / 64];
+    uint64_t bit = 1ULL << (page_number % 64);
+    uint64_t old = used ? word.fetch_or(bit, std::memory_order_relaxed)
+                        : word.fetch_and(~bit, std::memory_order_relaxed);
+    return (old & bit) != 0;
+}
+
+// Slow path: the thread's magazine is empty. Returns false if the pool is
+// too.
+bool MemoryManager::refill(FrameCache& c, uint32_t& page_number) {
+    std::lock_guard<std::mutex> lock(pool_lock);
+
+    // Take a batch, stored so that the lowest frame is handed out first;
+    // replaying in order, just the one frame
+    uint32_t limit = ordered ? 1 : FRAME_CACHE_BATCH;
+    uint32_t batch[FRAME_CACHE_BATCH];
+    uint32_t taken = 0;
+    while (taken < limit && frames.allocate(batch[taken])) {
+        taken++;
+    }
+    if (taken == 0) return false;
+
+    for (uint32_t i = 0; i < taken; ++i) {
+        c.frames[i] = batch[taken - 1 - i];
+    }
+    c.count = taken - 1;
+    page_number = c.frames[taken - 1];
+    return true;
+}
+
+// Out of frames: take one back from a resident page.
+// The victim stays allocated and is handed straight to the new page.
+uint32_t MemoryManager::replacePage(FrameCache& c) {
+    METRICS_TIME(METRIC_REPLACEMENT);
+    METRICS_COUNT(METRIC_EVICTIONS, 1);
+    uint32_t victim;
+    if (deferred || !engine->selectVictim(victim)) {
+        throw std::runtime_error("Out of physical memory and no pages to replace!");
+    }
+
+    FrameEntry& entry = frame_table[victim];
+    PageOwner* owner = entry.owner;
+    entry.owner = nullptr;
+    owner->evictPage(entry.virtual_page);
+
+    if (entry.large) {
+        // Keep the first frame of the large page, give back the rest
+        entry.large = 0;
+        releaseFrames(c, victim + 1, large_page_frames - 1);
+        METRICS_COUNT(METRIC_FRAMES_FREED, large_page_frames - 1);
+    }
+    return victim;
+}
+
+// Takes a free frame without evicting anything; returns false if none is
+// left
+bool MemoryManager::takeFreeFrame(FrameCache& c, uint32_t& page_number) {
+    bool fresh;
+    if (c.partition != nullptr) {
+        // Deterministic mode: this worker's own frames, no locking. In
+        // order, the next partitions' once they run out.
+        fresh = c.partition->allocate(page_number);
+        for (size_t i = 1; !fresh && ordered && i < partitions.size(); ++i) {
+            fresh = partitions[(c.worker + i) % partitions.size()]->allocate(page_number);
+        }
+    } else if (c.count > 0) {
+        page_number = c.frames[--c.count];
+        fresh = true;
+    } else {
+        fresh = refill(c, page_number);
+    }
+
+    if (fresh) {
+        markInUse(page_number, true);
+        c.allocated.store(c.allocated.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+    return fresh;
+}
+
+// Records the owner in the reverse map and hands the page to the engine,
+// or stamps it until the pages are ordered
+void MemoryManager::registerPage(FrameCache& c, PageOwner* owner, uint64_t virtual_page, uint32_t page_number) {
+    FrameEntry& entry = frame_table[page_number];
+    entry.owner = owner;
+    entry.virtual_page = virtual_page;
+    if (deferred) {
+        entry.accessed = 0;
+        frame_stamps[page_number] = c.stamp;
+        c.residency.push_back(c.stamp++ * 2 + 1);
+    } else {
+        engine->insert(page_number);
+    }
+}
+
+// The owner released the page in page_number
+void MemoryManager::unregisterPage(FrameCache& c, uint32_t page_number) {
+    if (deferred) {
+        c.residency.push_back(c.stamp++ * 2);
+    } else {
+        engine->remove(page_number);
+    }
+    frame_table[page_number].owner = nullptr;
+}
+
+uint32_t MemoryManager::allocatePage(PageOwner* owner, uint64_t virtual_page) {
+    METRICS_TIME(METRIC_FRAME_ALLOC);
+    METRICS_COUNT(METRIC_FRAMES_ALLOCATED, 1);
+    FrameCache& c = cache();
+    uint32_t page_number;
+    if (!takeFreeFrame(c, page_number)) {
+        page_number = replacePage(c);
+    }
+    if (owner != nullptr) {
+        registerPage(c, owner, virtual_page, page_number);
+    }
     return page_number;
 }
 
+uint32_t MemoryManager::allocatePages(PageOwner* owner, const uint64_t* virtual_pages, uint32_t count,
+                                      uint32_t* page_numbers) {
+    METRICS_TIME(METRIC_FRAME_ALLOC);
+    FrameCache& c = cache();
+    uint32_t allocated = 0;
+    while (allocated < count && takeFreeFrame(c, page_numbers[allocated])) {
+        registerPage(c, owner, virtual_pages[allocated], page_numbers[allocated]);
+        allocated++;
+    }
+    METRICS_COUNT(METRIC_FRAMES_ALLOCATED, allocated);
+    return allocated;
+}
+
 void MemoryManager::deallocatePage(uint32_t page_number) {
-    if (allocated_pages.count(page_number) == 0) return;
-    allocated_pages.erase(page_number);
-    free_pages.insert(page_number);
+    if (page_number >= total_pages || !markInUse(page_number, false)) return;
+    METRICS_COUNT(METRIC_FRAMES_FREED, 1);
+
+    FrameCache& c = cache();
+    c.allocated.store(c.allocated.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+
+    if (frame_table[page_number].owner != nullptr) {
+        unregisterPage(c, page_number);
+    }
+
+    if (!partitions.empty()) {
+        // Frames go back to the partition they came from
+        uint32_t per_worker = partitions[0]->getTotalCount();
+        partitions[page_number / per_worker]->free(page_number);
+        return;
+    }
+    if (ordered) {
+        std::lock_guard<std::mutex> lock(pool_lock);
+        frames.free(page_number);
+        return;
+    }
+
+    if (c.count == FRAME_CACHE_SIZE) {
+        // Magazine full: return the oldest half to the pool
+        std::lock_guard<std::mutex> lock(pool_lock);
+        for (uint32_t i = 0; i < FRAME_CACHE_BATCH; ++i) {
+            frames.free(c.frames[i]);
+        }
+        for (uint32_t i = FRAME_CACHE_BATCH; i < c.count; ++i) {
+            c.frames[i - FRAME_CACHE_BATCH] = c.frames[i];
+        }
+        c.count -= FRAME_CACHE_BATCH;
+    }
+    c.frames[c.count++] = page_number;
+}
+
+// Deterministic mode: an aligned run in this worker's partition or, in
+// order, the next ones
+bool MemoryManager::takePartitionRange(FrameCache& c, uint32_t count, uint32_t& first_frame) {
+    if (c.partition->allocateRange(count, first_frame)) return true;
+    for (size_t i = 1; ordered && i < partitions.size(); ++i) {
+        if (partitions[(c.worker + i) % partitions.size()]->allocateRange(count, first_frame)) return true;
+    }
+    return false;
+}
+
+bool MemoryManager::allocateLargePage(PageOwner* owner, uint64_t virtual_page, uint32_t& first_frame) {
+    METRICS_TIME(METRIC_FRAME_ALLOC);
+    FrameCache& c = cache();
+    uint32_t count = large_page_frames;
+
+    bool found;
+    if (c.partition != nullptr) {
+        found = takePartitionRange(c, count, first_frame);
+    } else {
+        std::lock_guard<std::mutex> lock(pool_lock);
+        found = frames.allocateRange(count, first_frame);
+    }
+    if (!found) return false;
+
+    for (uint32_t i = 0; i < count; ++i) {
+        markInUse(first_frame + i, true);
+    }
+    c.allocated.store(c.allocated.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+    METRICS_COUNT(METRIC_FRAMES_ALLOCATED, count);
+
+    frame_table[first_frame].large = 1;
+    registerPage(c, owner, virtual_page, first_frame);
+    return true;
+}
+
+void MemoryManager::deallocateLargePage(uint32_t first_frame) {
+    FrameCache& c = cache();
+    FrameEntry& entry = frame_table[first_frame];
+    if (entry.owner != nullptr) {
+        unregisterPage(c, first_frame);
+    }
+    entry.large = 0;
+    releaseFrames(c, first_frame, large_page_frames);
+    METRICS_COUNT(METRIC_FRAMES_FREED, large_page_frames);
+}
+
+// Returns a run of allocated frames straight to their allocator
+void MemoryManager::releaseFrames(FrameCache& c, uint32_t first_frame, uint32_t count) {
+    for (uint32_t i = 0; i < count; ++i) {
+        markInUse(first_frame + i, false);
+    }
+    c.allocated.store(c.allocated.load(std::memory_order_relaxed) - count, std::memory_order_relaxed);
+
+    if (!partitions.empty()) {
+        uint32_t per_worker = partitions[0]->getTotalCount();
+        partitions[first_frame / per_worker]->freeRange(first_frame, count);
+    } else {
+        std::lock_guard<std::mutex> lock(pool_lock);
+        frames.freeRange(first_frame, count);
+    }
 }
 
 uint32_t MemoryManager::getFreePageCount() const {
-    return free_pages.size();
+    return total_pages - getAllocatedPageCount();
 }
 
 uint32_t MemoryManager::getAllocatedPageCount() const {
-    return allocated_pages.size();
+    std::lock_guard<std::mutex> lock(pool_lock);
+    int64_t allocated = retired_allocated;
+    for (size_t i = 0; i < caches.size(); ++i) {
+        allocated += caches[i]->allocated.load(std::memory_order_relaxed);
+    }
+    return static_cast<uint32_t>(allocated);
+}
+
+ReplacementStats MemoryManager::getReplacementStats() const {
+    std::lock_guard<std::mutex> lock(pool_lock);
+    ReplacementStats total = deferred_stats;
+    total.add(engine->getStats());
+    return total;
+}
+
+void MemoryManager::printReplacementStats() const {
+    ReplacementStats stats = getReplacementStats();
+    std::cout << "\n=== Page Replacement (" << replacementPolicyName(policy) << ") ===\n";
+    std::cout << "Physical Frames: " << total_pages << "\n";
+    std::cout << "Page Faults: " << stats.faults << "\n";
+    std::cout << "Evictions: " << stats.evictions << "\n";
+    std::cout << "Second Chances: " << stats.second_chances << "\n";
+    if (policy == REPLACE_ARC) {
+        std::cout << "Ghost Hits: " << stats.ghost_hits << "\n";
+    }
+}
+
+namespace {
+
+// A reverse map entry as stored in checkpoints
+struct SavedFrame {
+    uint64_t virtual_page;
+    uint32_t owner;          // owner id (CheckpointWriter::ownerId)
+    uint32_t prev;
+    uint32_t next;
+    uint8_t accessed;
+    uint8_t list;
+    uint8_t large;
+    uint8_t unused;
+};
+
+} // namespace
+
+bool MemoryManager::save(CheckpointWriter& out) {
+    FrameCache& c = cache();
+    std::lock_guard<std::mutex> lock(pool_lock);
+    if (caches.size() != 1 || !partitions.empty()) return false;
+
+    out.beginSection("MMGR");
+    out.put<uint32_t>(policy);
+    out.put<uint32_t>(total_pages);
+    out.put<uint32_t>(large_page_frames);
+    frames.save(out);
+    out.put<int64_t>(retired_allocated);
+    out.put<ReplacementStats>(deferred_stats);
+
+    std::vector<uint64_t> in_use_words((total_pages + 63) / 64);
+    for (size_t i = 0; i < in_use_words.size(); ++i) {
+        in_use_words[i] = in_use[i].load(std::memory_order_relaxed);
+    }
+    out.putVector(in_use_words);
+
+    std::vector<SavedFrame> saved(total_pages);
+    for (uint32_t i = 0; i < total_pages; ++i) {
+        const FrameEntry& entry = frame_table[i];
+        SavedFrame frame = {entry.virtual_page, out.ownerId(entry.owner), entry.prev, entry.next,
+                            entry.accessed, entry.list, entry.large, 0};
+        saved[i] = frame;
+    }
+    out.putVector(saved);
+
+    out.putArray(c.frames, c.count);
+    out.put<int64_t>(c.allocated.load(std::memory_order_relaxed));
+    engine->save(out);
+    out.endSection();
+    return true;
+}
+
+bool MemoryManager::restore(CheckpointReader& in) {
+    FrameCache& c = cache();
+    std::lock_guard<std::mutex> lock(pool_lock);
+    if (caches.size() != 1 || !partitions.empty() || !in.beginSection("MMGR")) return false;
+
+    if (in.get<uint32_t>() != static_cast<uint32_t>(policy) || in.get<uint32_t>() != total_pages ||
+        in.get<uint32_t>() != large_page_frames) {
+        return false;
+    }
+    frames.restore(in);
+    retired_allocated = in.get<int64_t>();
+    deferred_stats = in.get<ReplacementStats>();
+
+    size_t count;
+    const uint64_t* in_use_words = in.getArray<uint64_t>(count);
+    if (count != (total_pages + 63) / 64) return false;
+    for (size_t i = 0; i < count; ++i) {
+        in_use[i].store(in_use_words[i], std::memory_order_relaxed);
+    }
+
+    const SavedFrame* saved = in.getArray<SavedFrame>(count);
+    if (count != total_pages) return false;
+    for (uint32_t i = 0; i < total_pages; ++i) {
+        FrameEntry& entry = frame_table[i];
+        entry.owner = in.owner(saved[i].owner);
+        entry.virtual_page = saved[i].virtual_page;
+        entry.prev = saved[i].prev;
+        entry.next = saved[i].next;
+        entry.accessed = saved[i].accessed;
+        entry.list = saved[i].list;
+        entry.large = saved[i].large;
+    }
+
+    const uint32_t* cached = in.getArray<uint32_t>(count);
+    if (count > FRAME_CACHE_SIZE) return false;
+    std::copy(cached, cached + count, c.frames);
+    c.count = static_cast<uint32_t>(count);
+    c.allocated.store(in.get<int64_t>(), std::memory_order_relaxed);
+    engine->restore(in);
+    in.endSection();
+    return in.ok();
 }
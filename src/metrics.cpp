@@ -0,0 +1,318 @@
+#include "metrics.h"
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+
+namespace {
+
+const char* const COUNTER_NAMES[METRIC_COUNTER_COUNT] = {
+    "accesses", "page_walks", "page_faults", "major_faults", "frames_allocated", "frames_freed", "evictions",
+    "page_tables_allocated", "page_tables_freed"
+};
+
+const char* const HISTOGRAM_NAMES[METRIC_HISTOGRAM_COUNT] = {
+    "tlb_lookup_ns", "page_walk_ns", "frame_alloc_ns", "replacement_ns", "parse_ns", "page_in_ns",
+    "walk_depth"
+};
+
+// Percentiles in the export, as numbers and as field names
+const double PERCENTILES[] = {50.0, 90.0, 99.0, 99.9};
+const char* const PERCENTILE_NAMES[] = {"p50", "p90", "p99", "p999"};
+const size_t PERCENTILE_COUNT = sizeof(PERCENTILES) / sizeof(PERCENTILES[0]);
+
+uint64_t wallClockNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+std::string jsonString(const std::string& text) {
+    std::string quoted = "\"";
+    for (size_t i = 0; i < text.size(); ++i) {
+        char c = text[i];
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+            quoted += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+            quoted += escaped;
+        } else {
+            quoted += c;
+        }
+    }
+    return quoted + "\"";
+}
+
+std::string csvField(const std::string& text) {
+    if (text.find_first_of(",\"\n") == std::string::npos) return text;
+    std::string quoted = "\"";
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '"') quoted += '"';
+        quoted += text[i];
+    }
+    return quoted + "\"";
+}
+
+// One histogram's summary, latencies converted from ticks to nanoseconds
+struct HistogramSummary {
+    uint64_t samples;
+    double min;
+    double mean;
+    double percentiles[PERCENTILE_COUNT];
+    double max;
+};
+
+HistogramSummary summarize(const Histogram& histogram, double ticks_per_ns) {
+    HistogramSummary summary;
+    summary.samples = histogram.getCount();
+    summary.min = histogram.getMin() / ticks_per_ns;
+    summary.mean = histogram.getMean() / ticks_per_ns;
+    for (size_t p = 0; p < PERCENTILE_COUNT; ++p) {
+        summary.percentiles[p] = histogram.getPercentile(PERCENTILES[p]) / ticks_per_ns;
+    }
+    summary.max = histogram.getMax() / ticks_per_ns;
+    return summary;
+}
+
+} // namespace
+
+Histogram::Histogram() : count(0), sum(0), min(UINT64_MAX), max(0) {
+    for (uint32_t b = 0; b < BUCKETS; ++b) {
+        buckets[b] = 0;
+    }
+}
+
+uint64_t Histogram::bucketHigh(uint32_t bucket) {
+    if (bucket < SUB_BUCKETS) return bucket;
+    uint32_t exponent = bucket / SUB_BUCKETS + SUB_BITS - 1;
+    uint64_t low = static_cast<uint64_t>(SUB_BUCKETS + bucket % SUB_BUCKETS) << (exponent - SUB_BITS);
+    return low + ((1ULL << (exponent - SUB_BITS)) - 1);
+}
+
+void Histogram::add(const Histogram& other) {
+    for (uint32_t b = 0; b < BUCKETS; ++b) {
+        buckets[b] += other.buckets[b];
+    }
+    count += other.count;
+    sum += other.sum;
+    if (other.min < min) min = other.min;
+    if (other.max > max) max = other.max;
+}
+
+uint64_t Histogram::getPercentile(double percent) const {
+    if (count == 0) return 0;
+    uint64_t rank = static_cast<uint64_t>(percent / 100.0 * count + 0.5);
+    if (rank < 1) rank = 1;
+    uint64_t seen = 0;
+    for (uint32_t b = 0; b < BUCKETS; ++b) {
+        seen += buckets[b];
+        if (seen >= rank) return bucketHigh(b) < max ? bucketHigh(b) : max;
+    }
+    return max;
+}
+
+MetricsThread::MetricsThread() {
+    for (int c = 0; c < METRIC_COUNTER_COUNT; ++c) {
+        counters[c].store(0, std::memory_order_relaxed);
+    }
+    for (int h = 0; h < METRIC_HISTOGRAM_COUNT; ++h) {
+        countdown[h] = METRICS_TIMER_SAMPLING;
+    }
+}
+
+std::atomic<bool> Metrics::enabled(false);
+thread_local MetricsThread* Metrics::local_thread = nullptr;
+
+Metrics::Metrics() : format(METRICS_JSON), sample_every(0), clock_start(0), wall_start_ns(0) {}
+
+Metrics& Metrics::getInstance() {
+    static Metrics instance;
+    return instance;
+}
+
+bool Metrics::open(const std::string& file, MetricsFormat output, uint64_t every, const char* simulator_name) {
+    if (!start(simulator_name)) return false;
+    filename = file;
+    format = output;
+    sample_every = every;
+    return true;
+}
+
+bool Metrics::start(const char* simulator_name) {
+    if (METRICS_LEVEL == 0) {
+        std::cerr << "Metrics were compiled out (METRICS_LEVEL=0)" << std::endl;
+        return false;
+    }
+    if (isEnabled()) return true;
+    simulator = simulator_name;
+    clock_start = metricsClock();
+    wall_start_ns = wallClockNs();
+    enabled.store(true, std::memory_order_relaxed);
+    return true;
+}
+
+MetricsThread* Metrics::attach() {
+    std::lock_guard<std::mutex> lock(threads_lock);
+    threads.push_back(std::unique_ptr<MetricsThread>(new MetricsThread()));
+    local_thread = threads.back().get();
+    return local_thread;
+}
+
+void Metrics::sumCounters(uint64_t* totals) {
+    std::lock_guard<std::mutex> lock(threads_lock);
+    for (int c = 0; c < METRIC_COUNTER_COUNT; ++c) {
+        totals[c] = 0;
+        for (size_t t = 0; t < threads.size(); ++t) {
+            totals[c] += threads[t]->counters[c].load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void Metrics::sample(uint64_t records, uint64_t frames_in_use) {
+    Sample sample;
+    sample.records = records;
+    sumCounters(sample.counters);
+    sample.frames_in_use = frames_in_use;
+    samples.push_back(sample);
+}
+
+bool Metrics::write(const MetricsTotals& totals, const std::vector<TaskMetrics>& tasks) {
+    if (!isEnabled() || !isExporting()) return true;
+
+    uint64_t counters[METRIC_COUNTER_COUNT];
+    sumCounters(counters);
+    HistogramSummary histograms[METRIC_HISTOGRAM_COUNT];
+    {
+        std::lock_guard<std::mutex> lock(threads_lock);
+        uint64_t ticks = metricsClock() - clock_start;
+        uint64_t wall = wallClockNs() - wall_start_ns;
+        double ticks_per_ns = ticks > 0 && wall > 0 ? static_cast<double>(ticks) / wall : 1.0;
+        for (int h = 0; h < METRIC_HISTOGRAM_COUNT; ++h) {
+            Histogram total;
+            for (size_t t = 0; t < threads.size(); ++t) {
+                total.add(threads[t]->histograms[h]);
+            }
+            histograms[h] = summarize(total, h == METRIC_WALK_DEPTH ? 1.0 : ticks_per_ns);
+        }
+    }
+
+    FILE* out = filename == "-" ? stdout : fopen(filename.c_str(), "w");
+    if (!out) {
+        std::cerr << "Could not open file for writing: " << filename << std::endl;
+        return false;
+    }
+    const TranslationStats& translation = totals.translation;
+    unsigned long long gauges[] = {totals.frames_in_use, totals.frames_total, 0};
+    for (size_t i = 0; i < tasks.size(); ++i) {
+        gauges[2] += tasks[i].page_tables;
+    }
+    const char* const gauge_names[] = {"frames_in_use", "frames_total", "page_tables"};
+    unsigned long long translation_values[] = {translation.lookups, translation.l2_hits, translation.misses,
+                                               translation.walk_cache_hits, translation.walk_reads,
+                                               totals.translation_cycles};
+    const char* const translation_names[] = {"lookups", "l2_hits", "page_walks", "walk_cache_hits",
+                                             "walk_reads", "cycles"};
+
+    if (format == METRICS_JSON) {
+        fprintf(out, "{\n  \"simulator\": \"%s\", \"records\": %llu, \"timer_sampling\": %d,\n",
+                simulator.c_str(), static_cast<unsigned long long>(totals.records), METRICS_TIMER_SAMPLING);
+        fprintf(out, "  \"counters\": {");
+        for (int c = 0; c < METRIC_COUNTER_COUNT; ++c) {
+            fprintf(out, "%s\"%s\": %llu", c ? ", " : "", COUNTER_NAMES[c],
+                    static_cast<unsigned long long>(counters[c]));
+        }
+        fprintf(out, "},\n  \"gauges\": {");
+        for (int g = 0; g < 3; ++g) {
+            fprintf(out, "%s\"%s\": %llu", g ? ", " : "", gauge_names[g], gauges[g]);
+        }
+        fprintf(out, "},\n  \"translation\": {");
+        for (int t = 0; t < 6; ++t) {
+            fprintf(out, "%s\"%s\": %llu", t ? ", " : "", translation_names[t], translation_values[t]);
+        }
+        fprintf(out, "},\n  \"histograms\": {\n");
+        for (int h = 0; h < METRIC_HISTOGRAM_COUNT; ++h) {
+            const HistogramSummary& s = histograms[h];
+            fprintf(out, "    \"%s\": {\"samples\": %llu, \"min\": %.1f, \"mean\": %.1f", HISTOGRAM_NAMES[h],
+                    static_cast<unsigned long long>(s.samples), s.min, s.mean);
+            for (size_t p = 0; p < PERCENTILE_COUNT; ++p) {
+                fprintf(out, ", \"%s\": %.1f", PERCENTILE_NAMES[p], s.percentiles[p]);
+            }
+            fprintf(out, ", \"max\": %.1f}%s\n", s.max, h + 1 < METRIC_HISTOGRAM_COUNT ? "," : "");
+        }
+        fprintf(out, "  },\n  \"tasks\": [\n");
+        for (size_t i = 0; i < tasks.size(); ++i) {
+            const TaskMetrics& t = tasks[i];
+            fprintf(out, "    {\"id\": %s, \"page_hits\": %llu, \"page_misses\": %llu, \"cow_faults\": %llu, "
+                         "\"major_faults\": %llu, \"tlb_lookups\": %llu, \"tlb_misses\": %llu, "
+                         "\"mapped_pages\": %llu, \"large_pages\": %llu, \"page_tables\": %llu}%s\n",
+                    jsonString(t.id).c_str(), static_cast<unsigned long long>(t.page_hits),
+                    static_cast<unsigned long long>(t.page_misses), static_cast<unsigned long long>(t.cow_faults),
+                    static_cast<unsigned long long>(t.major_faults), static_cast<unsigned long long>(t.tlb_lookups),
+                    static_cast<unsigned long long>(t.tlb_misses), static_cast<unsigned long long>(t.mapped_pages),
+                    static_cast<unsigned long long>(t.large_pages), static_cast<unsigned long long>(t.page_tables),
+                    i + 1 < tasks.size() ? "," : "");
+        }
+        fprintf(out, "  ],\n  \"samples\": [\n");
+        for (size_t i = 0; i < samples.size(); ++i) {
+            const Sample& sample = samples[i];
+            fprintf(out, "    {\"records\": %llu", static_cast<unsigned long long>(sample.records));
+            for (int c = 0; c < METRIC_COUNTER_COUNT; ++c) {
+                fprintf(out, ", \"%s\": %llu", COUNTER_NAMES[c], static_cast<unsigned long long>(sample.counters[c]));
+            }
+            fprintf(out, ", \"frames_in_use\": %llu}%s\n", static_cast<unsigned long long>(sample.frames_in_use),
+                    i + 1 < samples.size() ? "," : "");
+        }
+        fprintf(out, "  ]\n}\n");
+    } else {
+        // One value per row: section, name, metric, value
+        fprintf(out, "section,name,metric,value\n");
+        fprintf(out, "run,%s,records,%llu\n", simulator.c_str(), static_cast<unsigned long long>(totals.records));
+        fprintf(out, "run,%s,timer_sampling,%d\n", simulator.c_str(), METRICS_TIMER_SAMPLING);
+        for (int c = 0; c < METRIC_COUNTER_COUNT; ++c) {
+            fprintf(out, "counter,global,%s,%llu\n", COUNTER_NAMES[c], static_cast<unsigned long long>(counters[c]));
+        }
+        for (int g = 0; g < 3; ++g) {
+            fprintf(out, "gauge,global,%s,%llu\n", gauge_names[g], gauges[g]);
+        }
+        for (int t = 0; t < 6; ++t) {
+            fprintf(out, "translation,global,%s,%llu\n", translation_names[t], translation_values[t]);
+        }
+        for (int h = 0; h < METRIC_HISTOGRAM_COUNT; ++h) {
+            const HistogramSummary& s = histograms[h];
+            fprintf(out, "histogram,%s,samples,%llu\n", HISTOGRAM_NAMES[h], static_cast<unsigned long long>(s.samples));
+            fprintf(out, "histogram,%s,min,%.1f\n", HISTOGRAM_NAMES[h], s.min);
+            fprintf(out, "histogram,%s,mean,%.1f\n", HISTOGRAM_NAMES[h], s.mean);
+            for (size_t p = 0; p < PERCENTILE_COUNT; ++p) {
+                fprintf(out, "histogram,%s,%s,%.1f\n", HISTOGRAM_NAMES[h], PERCENTILE_NAMES[p], s.percentiles[p]);
+            }
+            fprintf(out, "histogram,%s,max,%.1f\n", HISTOGRAM_NAMES[h], s.max);
+        }
+        for (size_t i = 0; i < tasks.size(); ++i) {
+            const TaskMetrics& t = tasks[i];
+            std::string id = csvField(t.id);
+            unsigned long long values[] = {t.page_hits, t.page_misses, t.cow_faults, t.major_faults, t.tlb_lookups,
+                                           t.tlb_misses, t.mapped_pages, t.large_pages, t.page_tables};
+            const char* const names[] = {"page_hits", "page_misses", "cow_faults", "major_faults", "tlb_lookups",
+                                         "tlb_misses", "mapped_pages", "large_pages", "page_tables"};
+            for (int v = 0; v < 9; ++v) {
+                fprintf(out, "task,%s,%s,%llu\n", id.c_str(), names[v], values[v]);
+            }
+        }
+        // Samples are named by the records replayed when they were taken
+        for (size_t i = 0; i < samples.size(); ++i) {
+            const Sample& sample = samples[i];
+            unsigned long long records = sample.records;
+            for (int c = 0; c < METRIC_COUNTER_COUNT; ++c) {
+                fprintf(out, "sample,%llu,%s,%llu\n", records, COUNTER_NAMES[c],
+                        static_cast<unsigned long long>(sample.counters[c]));
+            }
+            fprintf(out, "sample,%llu,frames_in_use,%llu\n", records,
+                    static_cast<unsigned long long>(sample.frames_in_use));
+        }
+    }
+
+    bool ok = !ferror(out);
+    if (out != stdout) ok = (fclose(out) == 0) && ok;
+    if (!ok) std::cerr << "Error writing " << filename << std::endl;
+    return ok;
+}
@@ -0,0 +1,422 @@
+#include "options.h"
+#include "memory_manager.h"
+#include "shared_frames.h"
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+
+using namespace std;
+
+static void printUsage(const char* prog) {
+    cerr << "Usage: " << prog << " [options] [trace_file]\n"
+         << "  trace_file            trace to replay, or - to stream it from stdin\n"
+         << "                        (default: trace.txt)\n"
+         << "  --page-table L        page-table layout: single (hash map), multi (two-level\n"
+         << "                        radix table, 32-bit addresses), 4level or 5level (radix\n"
+         << "                        tables for 49- and 58-bit addresses) or inverted (one\n"
+         << "                        hashed table for all tasks, sized by physical memory);\n"
+         << "                        default: the executable's own\n"
+         << "  --tlb-sets N          TLB sets, power of two (default: " << TLB_SETS << ")\n"
+         << "  --tlb-ways N          TLB ways per set, 1-64 (default: " << TLB_WAYS << ")\n"
+         << "  --tlb-policy P        TLB replacement: lru, plru or random (default: lru)\n"
+         << "  --tlb-large-entries N TLB entries for large pages, 0-64 (default: " << TLB_LARGE_ENTRIES << ")\n"
+         << "  --l2-tlb-sets N       second-level TLB sets, power of two; 0 = no L2 (default: " << TLB_L2_SETS << ")\n"
+         << "  --l2-tlb-ways N       second-level TLB ways per set, 1-64 (default: " << TLB_L2_WAYS << ")\n"
+         << "  --walk-cache N        page-walk cache entries for directory entries, 0-64\n"
+         << "                        (multilevel only; default: " << TLB_WALK_CACHE_ENTRIES << ")\n"
+         << "  --tlb-cycles L1,L2,WC,MEM\n"
+         << "                        cycles for an L1 TLB lookup, an L2 TLB lookup, a walk cache\n"
+         << "                        hit and a page-table read (default: " << TLB_L1_CYCLES << "," << TLB_L2_CYCLES
+         << "," << WALK_CACHE_CYCLES << "," << WALK_MEMORY_CYCLES << ")\n"
+         << "  --shared-tlb N        give all tasks N shared CPU-level TLBs (default: one TLB per task)\n"
+         << "  --context-switch M    shared TLBs: flush (empty the TLB on every switch) or\n"
+         << "                        asid (keep entries tagged by address space; default)\n"
+         << "  --asids N             shared TLBs: ASIDs per CPU before rollover, 2-" << TLB::MAX_ASID + 1 << " (default: 256)\n"
+         << "  --page-size SIZE      base page size, 4KB-64KB (default: " << MIN_PAGE_SIZE_KB << "KB)\n"
+         << "  --large-pages RANGE   map START-END (hex addresses) or 'all' with "
+         << LARGE_PAGE_SIZE_KB / 1024 << "MB pages\n"
+         << "                        (multilevel only; repeatable)\n"
+         << "  --shared-region RANGE share the pages of START-END (hex addresses) or 'lib'\n"
+         << "                        (the shared-library segment) between all tasks (repeatable)\n"
+         << "  --events FILE         record a binary event log (decode with bin/event_decode)\n"
+         << "  --threads N           simulate tasks on N worker threads (default: 1)\n"
+         << "  --deterministic       give each worker a fixed frame partition so results\n"
+         << "                        (including frame numbers) don't depend on scheduling\n"
+         << "  --memory SIZE         physical memory, e.g. 64MB or 1GB (default: "
+         << (PHYSICAL_MEMORY_SIZE >> 20) << "MB)\n"
+         << "  --replacement P       page replacement: fifo, clock (second-chance), lru\n"
+         << "                        (active/inactive approximation) or arc (default: clock)\n"
+         << "  --swap SIZE           swap space, e.g. 256MB: evicted pages are written to a\n"
+         << "                        backing file and faults on them read them back\n"
+         << "  --swap-file FILE      the backing file (default: an unlinked temporary file)\n"
+         << "  --swap-threads N      I/O threads for the backing file, 1-64 (default: " << SWAP_IO_THREADS << ")\n"
+         << "  --metrics FILE        export counters and latency histograms (\"-\" = stdout)\n"
+         << "  --metrics-format F    json or csv (default: csv for a .csv file, otherwise json)\n"
+         << "  --metrics-every N     also sample the counters every N trace records\n"
+         << "  --window N            print TLB hit rate, fault rate, frames in use and active\n"
+         << "                        tasks on stderr every N trace records\n"
+         << "  --window-seconds T    print them every T seconds (with --window: whichever\n"
+         << "                        comes first)\n"
+         << "  --checkpoint FILE     save the simulator state to FILE and stop (serial runs only)\n"
+         << "  --checkpoint-at N     take the checkpoint after N trace records (default: at the end)\n"
+         << "  --restore FILE        resume from a checkpoint of the same trace, made with the\n"
+         << "                        same memory, page, TLB and region options\n"
+         << "  -h, --help            show this message\n";
+}
+
+// Parses a non-negative integer option value
+static bool parseNumber(const char* text, uint32_t& value) {
+    char* end = nullptr;
+    unsigned long parsed = strtoul(text, &end, 0);
+    if (end == text || *end != '\0') return false;
+    value = static_cast<uint32_t>(parsed);
+    return true;
+}
+
+// Parses the four comma-separated costs of --tlb-cycles
+static bool parseCycles(const string& text, TLBConfig& tlb) {
+    uint32_t* costs[] = {&tlb.l1_cycles, &tlb.l2_cycles, &tlb.walk_cache_cycles, &tlb.memory_cycles};
+    size_t start = 0;
+    for (size_t i = 0; i < 4; ++i) {
+        size_t comma = text.find(',', start);
+        if ((comma == string::npos) != (i == 3)) return false;
+        string field = text.substr(start, comma == string::npos ? string::npos : comma - start);
+        if (field.empty() || !parseNumber(field.c_str(), *costs[i])) return false;
+        start = comma + 1;
+    }
+    return true;
+}
+
+// Parses a hex address range "START-END" (inclusive)
+static bool parseRange(const string& text, AddressRange& range) {
+    size_t dash = text.find('-');
+    if (dash == string::npos) return false;
+
+    string first = text.substr(0, dash);
+    string last = text.substr(dash + 1);
+    char* end = nullptr;
+    unsigned long long start = strtoull(first.c_str(), &end, 16);
+    if (first.empty() || *end != '\0' || start >= VIRTUAL_MEMORY_SIZE) return false;
+    unsigned long long stop = strtoull(last.c_str(), &end, 16);
+    if (last.empty() || *end != '\0' || stop >= VIRTUAL_MEMORY_SIZE) return false;
+
+    range.start = start;
+    range.end = stop;
+    return true;
+}
+
+// Parses "all" or a hex address range "START-END" (inclusive)
+static bool parseLargePages(const string& text, PageSizeConfig& pages) {
+    if (text == "all") {
+        pages.large_everywhere = true;
+        return true;
+    }
+    AddressRange range;
+    if (!parseRange(text, range)) return false;
+    pages.large_regions.push_back(range);
+    return true;
+}
+
+// Parses "lib" (SHARED_LIB_ADDR up to the stack segment) or a hex address range
+static bool parseSharedRegion(const string& text, vector<AddressRange>& regions) {
+    AddressRange range = {SHARED_LIB_ADDR, STACK_BASE_ADDR - 1};
+    if (text != "lib" && !parseRange(text, range)) return false;
+    regions.push_back(range);
+    return true;
+}
+
+// Parses a byte count with an optional KB/MB/GB suffix
+static bool parseSize(const char* text, uint64_t& bytes) {
+    char* end = nullptr;
+    unsigned long long parsed = strtoull(text, &end, 0);
+    if (end == text) return false;
+
+    string suffix = end;
+    if (suffix == "" || suffix == "B") {
+        bytes = parsed;
+    } else if (suffix == "KB" || suffix == "K") {
+        bytes = parsed << 10;
+    } else if (suffix == "MB" || suffix == "M") {
+        bytes = parsed << 20;
+    } else if (suffix == "GB" || suffix == "G") {
+        bytes = parsed << 30;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool parseOptions(int argc, char* argv[], SimOptions& options) {
+    bool have_trace = false;
+    bool have_metrics_format = false;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if (arg == "-h" || arg == "--help") {
+            printUsage(argv[0]);
+            return false;
+        } else if (arg == "--tlb-sets" && has_value) {
+            if (!parseNumber(argv[++i], options.tlb.sets)) {
+                cerr << "Invalid value for --tlb-sets: " << argv[i] << endl;
+                return false;
+            }
+        } else if (arg == "--tlb-ways" && has_value) {
+            if (!parseNumber(argv[++i], options.tlb.ways)) {
+                cerr << "Invalid value for --tlb-ways: " << argv[i] << endl;
+                return false;
+            }
+        } else if (arg == "--tlb-policy" && has_value) {
+            string policy = argv[++i];
+            if (policy == "lru") {
+                options.tlb.policy = TLB_REPLACE_LRU;
+            } else if (policy == "plru") {
+                options.tlb.policy = TLB_REPLACE_PLRU;
+            } else if (policy == "random") {
+                options.tlb.policy = TLB_REPLACE_RANDOM;
+            } else {
+                cerr << "Unknown TLB policy: " << policy << endl;
+                return false;
+            }
+        } else if (arg == "--tlb-large-entries" && has_value) {
+            if (!parseNumber(argv[++i], options.tlb.large_entries)) {
+                cerr << "Invalid value for --tlb-large-entries: " << argv[i] << endl;
+                return false;
+            }
+        } else if (arg == "--l2-tlb-sets" && has_value) {
+            if (!parseNumber(argv[++i], options.tlb.l2_sets)) {
+                cerr << "Invalid value for --l2-tlb-sets: " << argv[i] << endl;
+                return false;
+            }
+        } else if (arg == "--l2-tlb-ways" && has_value) {
+            if (!parseNumber(argv[++i], options.tlb.l2_ways)) {
+                cerr << "Invalid value for --l2-tlb-ways: " << argv[i] << endl;
+                return false;
+            }
+        } else if (arg == "--walk-cache" && has_value) {
+            if (!parseNumber(argv[++i], options.tlb.walk_cache_entries)) {
+                cerr << "Invalid value for --walk-cache: " << argv[i] << endl;
+                return false;
+            }
+        } else if (arg == "--tlb-cycles" && has_value) {
+            if (!parseCycles(argv[++i], options.tlb)) {
+                cerr << "Invalid value for --tlb-cycles: " << argv[i] << endl;
+                return false;
+            }
+        } else if (arg == "--shared-tlb" && has_value) {
+            if (!parseNumber(argv[++i], options.cpu_tlb.cpus) || options.cpu_tlb.cpus > 1024) {
+                cerr << "Invalid value for --shared-tlb: " << argv[i] << endl;
+                return false;
+            }
+        } else if (arg == "--context-switch" && has_value) {
+            string mode = argv[++i];
+            if (mode == "flush") {
+                options.cpu_tlb.mode = SWITCH_FLUSH;
+            } else if (mode == "asid") {
+                options.cpu_tlb.mode = SWITCH_ASID;
+            } else {
+                cerr << "Unknown context switch mode: " << mode << endl;
+                return false;
+            }
+        } else if (arg == "--asids" && has_value) {
+            if (!parseNumber(argv[++i], options.cpu_tlb.asids) || options.cpu_tlb.asids < 2 ||
+                options.cpu_tlb.asids > TLB::MAX_ASID + 1) {
+                cerr << "Invalid value for --asids: " << argv[i] << endl;
+                return false;
+            }
+        } else if (arg == "--page-table" && has_value) {
+            string layout = argv[++i];
+            if (layout == "single") {
+                options.page_table = PAGE_TABLE_SINGLE;
+            } else if (layout == "multi") {
+                options.page_table = PAGE_TABLE_MULTI;
+            } else if (layout == "4level") {
+                options.page_table = PAGE_TABLE_4LEVEL;
+            } else if (layout == "5level") {
+                options.page_table = PAGE_TABLE_5LEVEL;
+            } else if (layout == "inverted") {
+                options.page_table = PAGE_TABLE_INVERTED;
+            } else {
+                cerr << "Unknown page-table layout: " << layout << endl;
+                return false;
+            }
+        } else if (arg == "--page-size" && has_value) {
+            uint64_t bytes;
+            if (!parseSize(argv[++i], bytes) || bytes % 1024 != 0 || bytes > (1ULL << 32)) {
+                cerr << "Invalid value for --page-size: " << argv[i] << endl;
+                return false;
+            }
+            options.pages.page_size_kb = static_cast<uint32_t>(bytes / 1024);
+        } else if (arg == "--large-pages" && has_value) {
+            if (!parseLargePages(argv[++i], options.pages)) {
+                cerr << "Invalid value for --large-pages: " << argv[i] << endl;
+                return false;
+            }
+        } else if (arg == "--shared-region" && has_value) {
+            if (!parseSharedRegion(argv[++i], options.shared_regions)) {
+                cerr << "Invalid value for --shared-region: " << argv[i] << endl;
+                return false;
+            }
+        } else if (arg == "--threads" && has_value) {
+            if (!parseNumber(argv[++i], options.threads) || options.threads == 0) {
+                cerr << "Invalid value for --threads: " << argv[i] << endl;
+                return false;
+            }
+        } else if (arg == "--deterministic") {
+            options.deterministic = true;
+        } else if (arg == "--memory" && has_value) {
+            if (!parseSize(argv[++i], options.memory_bytes)) {
+                cerr << "Invalid value for --memory: " << argv[i] << endl;
+                return false;
+            }
+        } else if (arg == "--replacement" && has_value) {
+            if (!parseReplacementPolicy(argv[++i], options.replacement)) {
+                cerr << "Unknown replacement policy: " << argv[i] << endl;
+                return false;
+            }
+        } else if (arg == "--swap" && has_value) {
+            if (!parseSize(argv[++i], options.swap_bytes) || options.swap_bytes == 0) {
+                cerr << "Invalid value for --swap: " << argv[i] << endl;
+                return false;
+            }
+        } else if (arg == "--swap-file" && has_value) {
+            options.swap_file = argv[++i];
+        } else if (arg == "--swap-threads" && has_value) {
+            if (!parseNumber(argv[++i], options.swap_threads) || options.swap_threads == 0 ||
+                options.swap_threads > 64) {
+                cerr << "Invalid value for --swap-threads: " << argv[i] << endl;
+                return false;
+            }
+        } else if (arg == "--events" && has_value) {
+            options.event_file = argv[++i];
+        } else if (arg == "--metrics" && has_value) {
+            options.metrics_file = argv[++i];
+            if (!have_metrics_format) {
+                size_t length = options.metrics_file.size();
+                bool csv = length >= 4 && options.metrics_file.compare(length - 4, 4, ".csv") == 0;
+                options.metrics_format = csv ? METRICS_CSV : METRICS_JSON;
+            }
+        } else if (arg == "--metrics-format" && has_value) {
+            string format = argv[++i];
+            if (format == "json") {
+                options.metrics_format = METRICS_JSON;
+            } else if (format == "csv") {
+                options.metrics_format = METRICS_CSV;
+            } else {
+                cerr << "Unknown metrics format: " << format << endl;
+                return false;
+            }
+            have_metrics_format = true;
+        } else if (arg == "--metrics-every" && has_value) {
+            char* end = nullptr;
+            options.metrics_every = strtoull(argv[++i], &end, 0);
+            if (end == argv[i] || *end != '\0' || options.metrics_every == 0) {
+                cerr << "Invalid value for --metrics-every: " << argv[i] << endl;
+                return false;
+            }
+        } else if (arg == "--window" && has_value) {
+            char* end = nullptr;
+            options.window_records = strtoull(argv[++i], &end, 0);
+            if (end == argv[i] || *end != '\0' || options.window_records == 0) {
+                cerr << "Invalid value for --window: " << argv[i] << endl;
+                return false;
+            }
+        } else if (arg == "--window-seconds" && has_value) {
+            char* end = nullptr;
+            options.window_seconds = strtod(argv[++i], &end);
+            if (end == argv[i] || *end != '\0' || !(options.window_seconds > 0)) {
+                cerr << "Invalid value for --window-seconds: " << argv[i] << endl;
+                return false;
+            }
+        } else if (arg == "--checkpoint" && has_value) {
+            options.checkpoint_file = argv[++i];
+        } else if (arg == "--checkpoint-at" && has_value) {
+            char* end = nullptr;
+            options.checkpoint_at = strtoull(argv[++i], &end, 0);
+            if (end == argv[i] || *end != '\0' || options.checkpoint_at == 0) {
+                cerr << "Invalid value for --checkpoint-at: " << argv[i] << endl;
+                return false;
+            }
+        } else if (arg == "--restore" && has_value) {
+            options.restore_file = argv[++i];
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            cerr << "Unknown or incomplete option: " << arg << endl;
+            printUsage(argv[0]);
+            return false;
+        } else if (!have_trace) {
+            options.trace_file = arg;
+            have_trace = true;
+        } else {
+            cerr << "Unexpected argument: " << arg << endl;
+            printUsage(argv[0]);
+            return false;
+        }
+    }
+
+    const char* page_error = options.pages.validate();
+    if (page_error) {
+        cerr << "Invalid page size: " << page_error << endl;
+        return false;
+    }
+
+    // Frame numbers must fit the 20-bit frame field of a packed PTE
+    uint64_t frame_size = options.pages.pageBytes();
+    if (options.memory_bytes < frame_size || options.memory_bytes > (1ULL << 20) * frame_size) {
+        cerr << "Invalid memory size: must hold between 1 and " << (1u << 20) << " pages" << endl;
+        return false;
+    }
+
+    // Swap slots are numbered like frames, in a 32-bit allocator
+    if (options.swap_bytes > 0 &&
+        (options.swap_bytes < frame_size || options.swap_bytes > (1ULL << 24) * frame_size)) {
+        cerr << "Invalid swap size: must hold between 1 and " << (1u << 24) << " pages" << endl;
+        return false;
+    }
+    if (options.swap_bytes == 0 && !options.swap_file.empty()) {
+        cerr << "--swap-file needs --swap" << endl;
+        return false;
+    }
+
+    // Each CPU's tasks must all be replayed by the same worker thread
+    if (options.cpu_tlb.cpus > 0 && options.cpu_tlb.cpus % options.threads != 0) {
+        cerr << "--shared-tlb needs a multiple of --threads CPUs" << endl;
+        return false;
+    }
+
+    // Checkpoints hold one thread's frame cache and replacement engine
+    if ((!options.checkpoint_file.empty() || !options.restore_file.empty()) &&
+        (options.threads > 1 || options.deterministic)) {
+        cerr << "--checkpoint and --restore need a serial run (no --threads or --deterministic)" << endl;
+        return false;
+    }
+    if (options.metrics_every > 0 && options.metrics_file.empty()) {
+        cerr << "--metrics-every needs --metrics" << endl;
+        return false;
+    }
+    if (options.checkpoint_at > 0 && options.checkpoint_file.empty()) {
+        cerr << "--checkpoint-at needs --checkpoint" << endl;
+        return false;
+    }
+
+    options.tlb.large_order = options.pages.largeOrder();
+    const char* tlb_error = options.tlb.validate();
+    if (tlb_error) {
+        cerr << "Invalid TLB geometry: " << tlb_error << endl;
+        return false;
+    }
+    return true;
+}
+
+void applyOptions(const SimOptions& options) {
+    TLB::setDefaultConfig(options.tlb);
+    CpuTLBs::getInstance().configure(options.cpu_tlb);
+    PageSizeConfig::setCurrent(options.pages);
+    SharedFrames::setRegions(options.shared_regions);
+
+    MemoryManager& memory = MemoryManager::getInstance();
+    memory.configureMemory(options.memory_bytes, options.pages.page_size_kb);
+    memory.setReplacementPolicy(options.replacement);
+    if (options.deterministic) {
+        memory.configurePartitions(options.threads);
+    }
+}
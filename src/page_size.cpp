@@ -0,0 +1,35 @@
+#include "page_size.h"
+
+PageSizeConfig PageSizeConfig::current_config;
+
+bool PageSizeConfig::wantsLargePage(uint64_t address) const {
+    if (large_everywhere) return true;
+    for (size_t i = 0; i < large_regions.size(); ++i) {
+        if (address >= large_regions[i].start && address <= large_regions[i].end) {
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* PageSizeConfig::validate() const {
+    // A page table page has LEVEL2_ENTRIES slots, and a large page has to
+    // cover at least one bitmap word (64 frames) of the frame allocator
+    if (page_size_kb < 4 || page_size_kb > 64 || (page_size_kb & (page_size_kb - 1)) != 0) {
+        return "page size must be a power of two between 4KB and 64KB";
+    }
+    for (size_t i = 0; i < large_regions.size(); ++i) {
+        if (large_regions[i].start > large_regions[i].end) {
+            return "large page region ends before it starts";
+        }
+    }
+    return nullptr;
+}
+
+void PageSizeConfig::setCurrent(const PageSizeConfig& config) {
+    current_config = config;
+}
+
+const PageSizeConfig& PageSizeConfig::current() {
+    return current_config;
+}
@@ -0,0 +1,397 @@
+#include "page_table.h"
+#include "checkpoint.h"
+#include "metrics.h"
+
+// Frame numbers must fit in the 20 bits above the PTE flags
+static_assert(PHYSICAL_MEMORY_SIZE / (MIN_PAGE_SIZE_KB * 1024) <= (1ULL << (32 - PTE_FRAME_SHIFT)),
+              "physical memory too large for 32-bit PTEs");
+
+RadixPageTable::RadixPageTable()
+    : directory(nullptr), large_directory(nullptr), table_count(0), large_count(0) {}
+
+RadixPageTable::~RadixPageTable() {
+    if (directory != nullptr) {
+        for (uint32_t i = 0; i < LEVEL1_ENTRIES; ++i) {
+            delete directory[i];
+        }
+        delete[] directory;
+    }
+    delete[] large_directory;
+}
+
+void RadixPageTable::map(uint32_t directory_index, uint32_t table_index, uint32_t frame, uint32_t flags) {
+    if (directory == nullptr) {
+        directory = new TablePage*[LEVEL1_ENTRIES]();
+    }
+    TablePage*& table = directory[directory_index];
+    if (table == nullptr) {
+        // Zero-initialised page: every entry starts non-present
+        table = new TablePage();
+        table_count++;
+        METRICS_COUNT(METRIC_TABLES_ALLOCATED, 1);
+    }
+
+    uint32_t& pte = table->entries[table_index];
+    if (!(pte & PTE_PRESENT)) {
+        table->present_count++;
+    }
+    pte = makePTE(frame, flags | PTE_PRESENT);
+}
+
+bool RadixPageTable::mapLarge(uint32_t directory_index, uint32_t frame, uint32_t flags) {
+    if (hasTable(directory_index)) {
+        return false;
+    }
+    if (large_directory == nullptr) {
+        large_directory = new uint32_t[LEVEL1_ENTRIES]();
+    }
+
+    uint32_t& pde = large_directory[directory_index];
+    if (!(pde & PTE_PRESENT)) {
+        large_count++;
+    }
+    pde = makePTE(frame, flags | PTE_PRESENT | PTE_LARGE);
+    return true;
+}
+
+bool RadixPageTable::unmapLarge(uint32_t directory_index, uint32_t& frame) {
+    uint32_t* pde = walkLarge(directory_index);
+    if (pde == nullptr) {
+        return false;
+    }
+    frame = pteFrame(*pde);
+    *pde = 0;
+    large_count--;
+    return true;
+}
+
+bool RadixPageTable::unmap(uint32_t directory_index, uint32_t table_index, uint32_t& frame) {
+    if (directory == nullptr) {
+        return false;
+    }
+    TablePage*& table = directory[directory_index];
+    if (table == nullptr || !(table->entries[table_index] & PTE_PRESENT)) {
+        return false;
+    }
+
+    frame = pteFrame(table->entries[table_index]);
+    table->entries[table_index] = 0;
+
+    // If the page table is empty, remove it from the directory
+    if (--table->present_count == 0) {
+        delete table;
+        table = nullptr;
+        table_count--;
+        METRICS_COUNT(METRIC_TABLES_FREED, 1);
+    }
+    return true;
+}
+
+uint32_t RadixPageTable::getMappedPageCount() const {
+    uint32_t mapped = 0;
+    for (uint32_t d = 0; directory != nullptr && d < LEVEL1_ENTRIES; ++d) {
+        if (directory[d] != nullptr) mapped += directory[d]->present_count;
+    }
+    return mapped;
+}
+
+size_t RadixPageTable::getMemoryUsage() const {
+    size_t tables = directory ? LEVEL1_ENTRIES * sizeof(TablePage*) : 0;
+    size_t large = large_directory ? LEVEL1_ENTRIES * sizeof(uint32_t) : 0;
+    return tables + large + static_cast<size_t>(table_count) * sizeof(TablePage);
+}
+
+void RadixPageTable::save(CheckpointWriter& out) const {
+    out.put<uint8_t>(directory != nullptr);
+    out.put<uint32_t>(table_count);
+    for (uint32_t d = 0; directory != nullptr && d < LEVEL1_ENTRIES; ++d) {
+        if (directory[d] == nullptr) continue;
+        out.put<uint32_t>(d);
+        out.put<uint32_t>(directory[d]->present_count);
+        out.putArray(directory[d]->entries, LEVEL2_ENTRIES);
+    }
+    out.put<uint8_t>(large_directory != nullptr);
+    out.put<uint32_t>(large_count);
+    if (large_directory != nullptr) {
+        out.putArray(large_directory, LEVEL1_ENTRIES);
+    }
+}
+
+void RadixPageTable::restore(CheckpointReader& in) {
+    if (in.get<uint8_t>()) {
+        directory = new TablePage*[LEVEL1_ENTRIES]();
+    }
+    uint32_t tables = in.get<uint32_t>();
+    for (uint32_t i = 0; i < tables && in.ok(); ++i) {
+        uint32_t d = in.get<uint32_t>();
+        if (directory == nullptr || d >= LEVEL1_ENTRIES || directory[d] != nullptr) {
+            in.fail();
+            return;
+        }
+        TablePage* table = new TablePage();
+        table->present_count = in.get<uint32_t>();
+        in.getArrayInto(table->entries, LEVEL2_ENTRIES);
+        directory[d] = table;
+        table_count++;
+    }
+    if (in.get<uint8_t>()) {
+        large_directory = new uint32_t[LEVEL1_ENTRIES]();
+        large_count = in.get<uint32_t>();
+        in.getArrayInto(large_directory, LEVEL1_ENTRIES);
+    } else {
+        large_count = in.get<uint32_t>();
+    }
+}
+
+WideRadixPageTable::WideRadixPageTable(uint32_t level_count)
+    : levels(level_count), root(nullptr), node_counts(), table_count(0), large_count(0), large_arrays(0) {}
+
+WideRadixPageTable::~WideRadixPageTable() {
+    if (root != nullptr) destroy(root, 0);
+}
+
+void WideRadixPageTable::destroy(Node* node, uint32_t depth) {
+    for (uint32_t i = 0; i < NODE_ENTRIES; ++i) {
+        if (node->entries[i] == nullptr) continue;
+        if (depth + 2 == levels) {
+            delete static_cast<TablePage*>(node->entries[i]);
+        } else {
+            destroy(static_cast<Node*>(node->entries[i]), depth + 1);
+        }
+    }
+    delete node;
+}
+
+WideRadixPageTable::Node* WideRadixPageTable::findDirectory(uint64_t directory_key, uint32_t& read) const {
+    if (root == nullptr) {
+        // Like an empty directory slot: the walker reads one entry
+        read = 1;
+        return nullptr;
+    }
+    read = 0;
+    Node* node = root;
+    for (uint32_t depth = 0; node != nullptr && depth + 2 < levels; ++depth) {
+        node = static_cast<Node*>(node->entries[index(directory_key, depth)]);
+        read++;
+    }
+    return node;
+}
+
+WideRadixPageTable::Node* WideRadixPageTable::makeDirectory(uint64_t directory_key, Node** path) {
+    if (root == nullptr) {
+        root = new Node();
+        node_counts[0]++;
+        METRICS_COUNT(METRIC_TABLES_ALLOCATED, 1);
+    }
+    Node* node = root;
+    path[0] = node;
+    for (uint32_t depth = 0; depth + 2 < levels; ++depth) {
+        void*& entry = node->entries[index(directory_key, depth)];
+        if (entry == nullptr) {
+            entry = new Node();
+            node->used++;
+            node_counts[depth + 1]++;
+            METRICS_COUNT(METRIC_TABLES_ALLOCATED, 1);
+        }
+        node = static_cast<Node*>(entry);
+        path[depth + 1] = node;
+    }
+    return node;
+}
+
+void WideRadixPageTable::prune(uint64_t directory_key, Node** path) {
+    for (uint32_t depth = levels - 2; path[depth]->used == 0; --depth) {
+        if (path[depth]->large != nullptr) large_arrays--;
+        delete path[depth];
+        node_counts[depth]--;
+        METRICS_COUNT(METRIC_TABLES_FREED, 1);
+        if (depth == 0) {
+            root = nullptr;
+            return;
+        }
+        path[depth - 1]->entries[index(directory_key, depth - 1)] = nullptr;
+        path[depth - 1]->used--;
+    }
+}
+
+void WideRadixPageTable::map(uint64_t directory_key, uint32_t table_index, uint32_t frame, uint32_t flags) {
+    Node* path[5];
+    Node* directory = makeDirectory(directory_key, path);
+    void*& entry = directory->entries[index(directory_key, levels - 2)];
+    if (entry == nullptr) {
+        // Zero-initialised page: every entry starts non-present
+        entry = new TablePage();
+        directory->used++;
+        table_count++;
+        METRICS_COUNT(METRIC_TABLES_ALLOCATED, 1);
+    }
+
+    TablePage* table = static_cast<TablePage*>(entry);
+    uint32_t& pte = table->entries[table_index];
+    if (!(pte & PTE_PRESENT)) {
+        table->present_count++;
+    }
+    pte = makePTE(frame, flags | PTE_PRESENT);
+}
+
+bool WideRadixPageTable::unmap(uint64_t directory_key, uint32_t table_index, uint32_t& frame) {
+    // Collect the path so emptied nodes can be freed bottom-up
+    Node* path[5];
+    Node* node = root;
+    for (uint32_t depth = 0; node != nullptr && depth + 2 < levels; ++depth) {
+        path[depth] = node;
+        node = static_cast<Node*>(node->entries[index(directory_key, depth)]);
+    }
+    if (node == nullptr) {
+        return false;
+    }
+    path[levels - 2] = node;
+
+    void*& entry = node->entries[index(directory_key, levels - 2)];
+    TablePage* table = static_cast<TablePage*>(entry);
+    if (table == nullptr || !(table->entries[table_index] & PTE_PRESENT)) {
+        return false;
+    }
+
+    frame = pteFrame(table->entries[table_index]);
+    table->entries[table_index] = 0;
+
+    // Free the page table once empty, and then every node it emptied
+    if (--table->present_count == 0) {
+        delete table;
+        entry = nullptr;
+        node->used--;
+        table_count--;
+        METRICS_COUNT(METRIC_TABLES_FREED, 1);
+        prune(directory_key, path);
+    }
+    return true;
+}
+
+bool WideRadixPageTable::mapLarge(uint64_t directory_key, uint32_t frame, uint32_t flags) {
+    if (hasTable(directory_key)) {
+        return false;
+    }
+    Node* path[5];
+    Node* directory = makeDirectory(directory_key, path);
+    if (directory->large == nullptr) {
+        directory->large = new uint32_t[NODE_ENTRIES]();
+        large_arrays++;
+    }
+
+    uint32_t& pde = directory->large[index(directory_key, levels - 2)];
+    if (!(pde & PTE_PRESENT)) {
+        directory->used++;
+        large_count++;
+    }
+    pde = makePTE(frame, flags | PTE_PRESENT | PTE_LARGE);
+    return true;
+}
+
+bool WideRadixPageTable::unmapLarge(uint64_t directory_key, uint32_t& frame) {
+    Node* path[5];
+    Node* node = root;
+    for (uint32_t depth = 0; node != nullptr && depth + 2 < levels; ++depth) {
+        path[depth] = node;
+        node = static_cast<Node*>(node->entries[index(directory_key, depth)]);
+    }
+    if (node == nullptr || node->large == nullptr) {
+        return false;
+    }
+    path[levels - 2] = node;
+
+    uint32_t& pde = node->large[index(directory_key, levels - 2)];
+    if (!(pde & PTE_PRESENT)) {
+        return false;
+    }
+    frame = pteFrame(pde);
+    pde = 0;
+    node->used--;
+    large_count--;
+    prune(directory_key, path);
+    return true;
+}
+
+void WideRadixPageTable::collectLarge(const Node* node, uint32_t depth, uint64_t key, std::vector<uint64_t>& keys,
+                                      std::vector<uint32_t>& pdes) const {
+    for (uint32_t i = 0; i < NODE_ENTRIES; ++i) {
+        uint64_t child_key = (key << UPPER_LEVEL_BITS) | i;
+        if (depth + 2 == levels) {
+            if (node->large != nullptr && (node->large[i] & PTE_PRESENT)) {
+                keys.push_back(child_key);
+                pdes.push_back(node->large[i]);
+            }
+        } else if (node->entries[i] != nullptr) {
+            collectLarge(static_cast<const Node*>(node->entries[i]), depth + 1, child_key, keys, pdes);
+        }
+    }
+}
+
+uint32_t WideRadixPageTable::getMappedPageCount() const {
+    uint32_t mapped = 0;
+    auto count = [&](uint64_t, TablePage& table) { mapped += table.present_count; };
+    if (root != nullptr) const_cast<WideRadixPageTable*>(this)->visitTables(root, 0, 0, count);
+    return mapped;
+}
+
+size_t WideRadixPageTable::getMemoryUsage() const {
+    size_t nodes = 0;
+    for (uint32_t depth = 0; depth + 1 < levels; ++depth) {
+        nodes += node_counts[depth];
+    }
+    return nodes * sizeof(Node) + static_cast<size_t>(large_arrays) * NODE_ENTRIES * sizeof(uint32_t) +
+           static_cast<size_t>(table_count) * sizeof(TablePage);
+}
+
+void WideRadixPageTable::save(CheckpointWriter& out) const {
+    out.put<uint32_t>(table_count);
+    auto tables = [&](uint64_t directory_key, TablePage& table) {
+        out.put<uint64_t>(directory_key);
+        out.put<uint32_t>(table.present_count);
+        out.putArray(table.entries, LEVEL2_ENTRIES);
+    };
+    if (root != nullptr) const_cast<WideRadixPageTable*>(this)->visitTables(root, 0, 0, tables);
+
+    // Large pages, found through the directory nodes
+    out.put<uint32_t>(large_count);
+    std::vector<uint64_t> keys;
+    std::vector<uint32_t> pdes;
+    if (root != nullptr) collectLarge(root, 0, 0, keys, pdes);
+    out.putVector(keys);
+    out.putVector(pdes);
+}
+
+void WideRadixPageTable::restore(CheckpointReader& in) {
+    uint32_t tables = in.get<uint32_t>();
+    for (uint32_t i = 0; i < tables && in.ok(); ++i) {
+        uint64_t directory_key = in.get<uint64_t>();
+        if (hasTable(directory_key) || (directory_key >> ((levels - 1) * UPPER_LEVEL_BITS)) != 0) {
+            in.fail();
+            return;
+        }
+        Node* path[5];
+        Node* directory = makeDirectory(directory_key, path);
+        TablePage* table = new TablePage();
+        table->present_count = in.get<uint32_t>();
+        in.getArrayInto(table->entries, LEVEL2_ENTRIES);
+        directory->entries[index(directory_key, levels - 2)] = table;
+        directory->used++;
+        table_count++;
+    }
+
+    uint32_t large = in.get<uint32_t>();
+    std::vector<uint64_t> keys;
+    std::vector<uint32_t> pdes;
+    in.getVector(keys);
+    in.getVector(pdes);
+    if (keys.size() != large || pdes.size() != large) {
+        in.fail();
+        return;
+    }
+    for (uint32_t i = 0; i < large; ++i) {
+        if ((keys[i] >> ((levels - 1) * UPPER_LEVEL_BITS)) != 0 || !mapLarge(keys[i], pteFrame(pdes[i]), pdes[i])) {
+            in.fail();
+            return;
+        }
+    }
+}
@@ -0,0 +1,437 @@
+#include "replacement.h"
+#include "checkpoint.h"
+#include <algorithm>
+#include <functional>
+#include <list>
+#include <unordered_map>
+
+void ReplacementStats::add(const ReplacementStats& other) {
+    faults += other.faults;
+    evictions += other.evictions;
+    second_chances += other.second_chances;
+    ghost_hits += other.ghost_hits;
+}
+
+void FrameList::pushBack(uint32_t frame) {
+    FrameEntry& e = table[frame];
+    e.prev = tail;
+    e.next = FRAME_NONE;
+    if (tail != FRAME_NONE) {
+        table[tail].next = frame;
+    } else {
+        head = frame;
+    }
+    tail = frame;
+    count++;
+}
+
+void FrameList::remove(uint32_t frame) {
+    FrameEntry& e = table[frame];
+    if (e.prev != FRAME_NONE) {
+        table[e.prev].next = e.next;
+    } else {
+        head = e.next;
+    }
+    if (e.next != FRAME_NONE) {
+        table[e.next].prev = e.prev;
+    } else {
+        tail = e.prev;
+    }
+    e.prev = e.next = FRAME_NONE;
+    count--;
+}
+
+void FrameList::save(CheckpointWriter& out) const {
+    out.put<uint32_t>(head);
+    out.put<uint32_t>(tail);
+    out.put<uint32_t>(count);
+}
+
+void FrameList::restore(CheckpointReader& in) {
+    head = in.get<uint32_t>();
+    tail = in.get<uint32_t>();
+    count = in.get<uint32_t>();
+}
+
+void ReplacementEngine::save(CheckpointWriter& out) const {
+    out.put<ReplacementStats>(stats);
+}
+
+void ReplacementEngine::restore(CheckpointReader& in) {
+    stats = in.get<ReplacementStats>();
+}
+
+namespace {
+
+// Oldest page goes first, accesses are ignored
+class FifoEngine : public ReplacementEngine {
+private:
+    FrameList queue;
+
+public:
+    explicit FifoEngine(FrameEntry* frame_table) : ReplacementEngine(frame_table), queue(frame_table) {}
+
+    void insert(uint32_t frame) override {
+        stats.faults++;
+        queue.pushBack(frame);
+    }
+
+    void remove(uint32_t frame) override {
+        queue.remove(frame);
+    }
+
+    bool selectVictim(uint32_t& frame) override {
+        if (queue.empty()) return false;
+        frame = queue.front();
+        queue.remove(frame);
+        stats.evictions++;
+        return true;
+    }
+
+    void save(CheckpointWriter& out) const override {
+        ReplacementEngine::save(out);
+        queue.save(out);
+    }
+
+    void restore(CheckpointReader& in) override {
+        ReplacementEngine::restore(in);
+        queue.restore(in);
+    }
+};
+
+// CLOCK / second chance
+// The list is the clock face with the hand at its head; new pages go in
+// just behind the hand. A referenced page under the hand has its accessed
+// bit cleared and the hand moves past it.
+class ClockEngine : public ReplacementEngine {
+private:
+    FrameList ring;
+
+public:
+    explicit ClockEngine(FrameEntry* frame_table) : ReplacementEngine(frame_table), ring(frame_table) {}
+
+    void insert(uint32_t frame) override {
+        stats.faults++;
+        table[frame].accessed = 0;
+        ring.pushBack(frame);
+    }
+
+    void remove(uint32_t frame) override {
+        ring.remove(frame);
+    }
+
+    bool selectVictim(uint32_t& frame) override {
+        while (!ring.empty()) {
+            uint32_t hand = ring.front();
+            ring.remove(hand);
+            if (table[hand].accessed) {
+                table[hand].accessed = 0;
+                ring.pushBack(hand);
+                stats.second_chances++;
+                continue;
+            }
+            frame = hand;
+            stats.evictions++;
+            return true;
+        }
+        return false;
+    }
+
+    void save(CheckpointWriter& out) const override {
+        ReplacementEngine::save(out);
+        ring.save(out);
+    }
+
+    void restore(CheckpointReader& in) override {
+        ReplacementEngine::restore(in);
+        ring.restore(in);
+    }
+};
+
+// LRU approximation with an active and an inactive list
+// New pages start on the inactive list. A referenced page reaching the head
+// of the inactive list is promoted; the active list is kept no longer than
+// the inactive one by demoting its unreferenced head. Victims come from the
+// head of the inactive list, so a page has to go unreferenced through both
+// lists' worth of evictions before it is replaced.
+class LruApproxEngine : public ReplacementEngine {
+private:
+    enum { INACTIVE, ACTIVE };
+
+    FrameList inactive;
+    FrameList active;
+
+public:
+    explicit LruApproxEngine(FrameEntry* frame_table)
+        : ReplacementEngine(frame_table), inactive(frame_table), active(frame_table) {}
+
+    void insert(uint32_t frame) override {
+        stats.faults++;
+        table[frame].accessed = 0;
+        table[frame].list = INACTIVE;
+        inactive.pushBack(frame);
+    }
+
+    void remove(uint32_t frame) override {
+        (table[frame].list == ACTIVE ? active : inactive).remove(frame);
+    }
+
+    bool selectVictim(uint32_t& frame) override {
+        while (!inactive.empty() || !active.empty()) {
+            if (active.size() > inactive.size()) {
+                uint32_t oldest = active.front();
+                active.remove(oldest);
+                if (table[oldest].accessed) {
+                    table[oldest].accessed = 0;
+                    active.pushBack(oldest);
+                    stats.second_chances++;
+                } else {
+                    table[oldest].list = INACTIVE;
+                    inactive.pushBack(oldest);
+                }
+                continue;
+            }
+
+            uint32_t candidate = inactive.front();
+            inactive.remove(candidate);
+            if (table[candidate].accessed) {
+                table[candidate].accessed = 0;
+                table[candidate].list = ACTIVE;
+                active.pushBack(candidate);
+                stats.second_chances++;
+                continue;
+            }
+            frame = candidate;
+            stats.evictions++;
+            return true;
+        }
+        return false;
+    }
+
+    void save(CheckpointWriter& out) const override {
+        ReplacementEngine::save(out);
+        inactive.save(out);
+        active.save(out);
+    }
+
+    void restore(CheckpointReader& in) override {
+        ReplacementEngine::restore(in);
+        inactive.restore(in);
+        active.restore(in);
+    }
+};
+
+// ARC with accessed bits (CAR, Bansal & Modha)
+// T1 holds pages seen once, T2 pages seen again; both are clocks. B1/B2
+// remember recently evicted pages of each kind, and a fault on a ghost
+// moves the target size p of T1 towards whichever list would have kept it.
+// The cache size c is the largest number of pages this engine has held.
+class ArcEngine : public ReplacementEngine {
+private:
+    enum { T1, T2 };
+    enum GhostList { B1, B2 };
+
+    // Evicted pages are keyed on their owner's task number
+    struct GhostKey {
+        uint32_t owner;
+        uint64_t virtual_page;
+
+        bool operator==(const GhostKey& other) const {
+            return owner == other.owner && virtual_page == other.virtual_page;
+        }
+    };
+
+    struct GhostHash {
+        size_t operator()(const GhostKey& key) const {
+            return static_cast<size_t>((key.virtual_page ^ (static_cast<uint64_t>(key.owner) << 45)) * 0x9E3779B97F4A7C15ULL);
+        }
+    };
+
+    struct GhostSlot {
+        GhostList list;
+        std::list<GhostKey>::iterator position;
+    };
+
+    FrameList t1;
+    FrameList t2;
+    std::list<GhostKey> b1;   // front = least recently evicted
+    std::list<GhostKey> b2;
+    std::unordered_map<GhostKey, GhostSlot, GhostHash> ghosts;
+    uint32_t target;          // p: desired size of T1
+    uint32_t capacity;        // c
+
+    void forgetOldest(std::list<GhostKey>& ghost_list) {
+        ghosts.erase(ghost_list.front());
+        ghost_list.pop_front();
+    }
+
+    void remember(GhostList which, uint32_t frame) {
+        GhostKey key = {table[frame].owner->getOwnerIndex(), table[frame].virtual_page};
+        std::list<GhostKey>& ghost_list = which == B1 ? b1 : b2;
+        ghost_list.push_back(key);
+        GhostSlot slot = {which, --ghost_list.end()};
+        ghosts[key] = slot;
+    }
+
+public:
+    explicit ArcEngine(FrameEntry* frame_table)
+        : ReplacementEngine(frame_table), t1(frame_table), t2(frame_table), target(0), capacity(0) {}
+
+    void insert(uint32_t frame) override {
+        stats.faults++;
+        FrameEntry& e = table[frame];
+        e.accessed = 0;
+
+        GhostKey key = {e.owner->getOwnerIndex(), e.virtual_page};
+        auto it = ghosts.find(key);
+        if (it == ghosts.end()) {
+            e.list = T1;
+            t1.pushBack(frame);
+        } else {
+            // Seen recently: adapt p towards the list that lost the page
+            stats.ghost_hits++;
+            uint32_t b1_size = static_cast<uint32_t>(b1.size());
+            uint32_t b2_size = static_cast<uint32_t>(b2.size());
+            if (it->second.list == B1) {
+                target = std::min(target + std::max(1u, b2_size / b1_size), capacity);
+                b1.erase(it->second.position);
+            } else {
+                uint32_t step = std::max(1u, b1_size / b2_size);
+                target = target > step ? target - step : 0;
+                b2.erase(it->second.position);
+            }
+            ghosts.erase(it);
+            e.list = T2;
+            t2.pushBack(frame);
+        }
+
+        capacity = std::max(capacity, t1.size() + t2.size());
+
+        // Keep |T1| + |B1| <= c and the whole directory within 2c
+        while (!b1.empty() && t1.size() + b1.size() > capacity) {
+            forgetOldest(b1);
+        }
+        while (b1.size() + b2.size() > capacity) {
+            forgetOldest(b2.empty() ? b1 : b2);
+        }
+    }
+
+    void remove(uint32_t frame) override {
+        (table[frame].list == T2 ? t2 : t1).remove(frame);
+    }
+
+    void notePeakResident(uint32_t pages) override {
+        capacity = std::max(capacity, pages);
+    }
+
+    bool selectVictim(uint32_t& frame) override {
+        while (!t1.empty() || !t2.empty()) {
+            if (!t1.empty() && (t1.size() >= std::max(1u, target) || t2.empty())) {
+                uint32_t hand = t1.front();
+                t1.remove(hand);
+                if (table[hand].accessed) {
+                    // Referenced since it came in: it is a frequent page now
+                    table[hand].accessed = 0;
+                    table[hand].list = T2;
+                    t2.pushBack(hand);
+                    stats.second_chances++;
+                    continue;
+                }
+                remember(B1, hand);
+                frame = hand;
+            } else {
+                uint32_t hand = t2.front();
+                t2.remove(hand);
+                if (table[hand].accessed) {
+                    table[hand].accessed = 0;
+                    t2.pushBack(hand);
+                    stats.second_chances++;
+                    continue;
+                }
+                remember(B2, hand);
+                frame = hand;
+            }
+            stats.evictions++;
+            return true;
+        }
+        return false;
+    }
+
+    void save(CheckpointWriter& out) const override {
+        ReplacementEngine::save(out);
+        t1.save(out);
+        t2.save(out);
+        out.put<uint32_t>(target);
+        out.put<uint32_t>(capacity);
+        const std::list<GhostKey>* ghost_lists[] = {&b1, &b2};
+        for (int g = 0; g < 2; ++g) {
+            out.put<uint64_t>(ghost_lists[g]->size());
+            for (auto it = ghost_lists[g]->begin(); it != ghost_lists[g]->end(); ++it) {
+                out.put<uint32_t>(it->owner);
+                out.put<uint64_t>(it->virtual_page);
+            }
+        }
+    }
+
+    // The ghost directory is rebuilt from the two lists
+    void restore(CheckpointReader& in) override {
+        ReplacementEngine::restore(in);
+        t1.restore(in);
+        t2.restore(in);
+        target = in.get<uint32_t>();
+        capacity = in.get<uint32_t>();
+        b1.clear();
+        b2.clear();
+        ghosts.clear();
+        GhostList which[] = {B1, B2};
+        std::list<GhostKey>* ghost_lists[] = {&b1, &b2};
+        for (int g = 0; g < 2; ++g) {
+            uint64_t count = in.get<uint64_t>();
+            for (uint64_t i = 0; i < count && in.ok(); ++i) {
+                GhostKey key;
+                key.owner = in.get<uint32_t>();
+                key.virtual_page = in.get<uint64_t>();
+                ghost_lists[g]->push_back(key);
+                GhostSlot slot = {which[g], --ghost_lists[g]->end()};
+                ghosts[key] = slot;
+            }
+        }
+    }
+};
+
+} // namespace
+
+ReplacementEngine* ReplacementEngine::create(ReplacementPolicy policy, FrameEntry* frame_table) {
+    switch (policy) {
+        case REPLACE_FIFO:  return new FifoEngine(frame_table);
+        case REPLACE_LRU:   return new LruApproxEngine(frame_table);
+        case REPLACE_ARC:   return new ArcEngine(frame_table);
+        case REPLACE_CLOCK:
+        default:            return new ClockEngine(frame_table);
+    }
+}
+
+const char* replacementPolicyName(ReplacementPolicy policy) {
+    switch (policy) {
+        case REPLACE_FIFO:  return "fifo";
+        case REPLACE_LRU:   return "lru";
+        case REPLACE_ARC:   return "arc";
+        case REPLACE_CLOCK:
+        default:            return "clock";
+    }
+}
+
+bool parseReplacementPolicy(const std::string& name, ReplacementPolicy& policy) {
+    if (name == "fifo") {
+        policy = REPLACE_FIFO;
+    } else if (name == "clock" || name == "second-chance") {
+        policy = REPLACE_CLOCK;
+    } else if (name == "lru") {
+        policy = REPLACE_LRU;
+    } else if (name == "arc") {
+        policy = REPLACE_ARC;
+    } else {
+        return false;
+    }
+    return true;
+}
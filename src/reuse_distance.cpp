@@ -0,0 +1,105 @@
+#include "reuse_distance.h"
+
+// Smallest tree the slots are renumbered into
+static const uint32_t MIN_SLOTS = 1024;
+
+StackDistance::StackDistance() : tree(MIN_SLOTS + 1, 0), slot_key(MIN_SLOTS, 0), next_slot(0) {}
+
+uint32_t StackDistance::countUpTo(uint32_t slot) const {
+    uint32_t count = 0;
+    for (uint32_t i = slot + 1; i > 0; i &= i - 1) {
+        count += tree[i];
+    }
+    return count;
+}
+
+void StackDistance::mark(uint32_t slot, int32_t delta) {
+    uint32_t size = static_cast<uint32_t>(tree.size());
+    for (uint32_t i = slot + 1; i < size; i += i & (0u - i)) {
+        tree[i] += static_cast<uint32_t>(delta);
+    }
+}
+
+void StackDistance::compact() {
+    // Move the latest slot of every key to the front, in order, and leave
+    // at least as many free slots as there are keys
+    uint32_t live = 0;
+    for (uint32_t slot = 0; slot < next_slot; ++slot) {
+        uint32_t key = slot_key[slot];
+        if (last_slot[key] == slot) {
+            slot_key[live] = key;
+            last_slot[key] = live++;
+        }
+    }
+    uint32_t keys = getKeyCount();
+    uint32_t slots = keys * 2 > MIN_SLOTS ? keys * 2 : MIN_SLOTS;
+    slot_key.resize(slots, 0);
+
+    tree.assign(slots + 1, 0);
+    for (uint32_t slot = 0; slot < live; ++slot) {
+        tree[slot + 1] = 1;
+    }
+    // Linear-time Fenwick build: push each node's sum to its parent
+    for (uint32_t i = 1; i <= slots; ++i) {
+        uint32_t parent = i + (i & (0u - i));
+        if (parent <= slots) tree[parent] += tree[i];
+    }
+    next_slot = live;
+}
+
+uint32_t StackDistance::access(uint32_t key) {
+    // The latest key again: nothing was accessed since, and its mark is
+    // already the last one
+    if (next_slot > 0 && slot_key[next_slot - 1] == key) return 0;
+    if (next_slot == slot_key.size()) compact();
+
+    uint32_t distance = STACK_DISTANCE_COLD;
+    if (key < last_slot.size()) {
+        // Marks after the key's slot are the keys accessed since
+        uint32_t previous = last_slot[key];
+        distance = getKeyCount() - countUpTo(previous);
+        mark(previous, -1);
+    } else {
+        last_slot.resize(key + 1, 0);
+    }
+
+    uint32_t slot = next_slot++;
+    slot_key[slot] = key;
+    last_slot[key] = slot;
+    mark(slot, 1);
+    return distance;
+}
+
+void MissRatioCurve::add(const MissRatioCurve& other) {
+    if (other.distances.size() > distances.size()) distances.resize(other.distances.size(), 0);
+    for (size_t d = 0; d < other.distances.size(); ++d) {
+        distances[d] += other.distances[d];
+    }
+    accesses += other.accesses;
+    cold += other.cold;
+}
+
+std::vector<uint64_t> MissRatioCurve::misses(const std::vector<uint32_t>& entries) const {
+    // Walk the sizes from the largest down, adding up the distances beyond each
+    std::vector<uint64_t> result(entries.size(), 0);
+    uint64_t beyond = 0;
+    size_t distance = distances.size();
+    for (size_t i = entries.size(); i-- > 0;) {
+        while (distance > entries[i]) {
+            beyond += distances[--distance];
+        }
+        result[i] = cold + beyond;
+    }
+    return result;
+}
+
+std::vector<uint32_t> missRatioSizes(uint32_t max_entries) {
+    std::vector<uint32_t> sizes;
+    uint32_t step = 1;
+    for (uint64_t size = 1; size < max_entries; size += step) {
+        sizes.push_back(static_cast<uint32_t>(size));
+        if (size >= 16 && (size & (size - 1)) == 0) step = static_cast<uint32_t>(size / 16);
+    }
+    if (max_entries > 0) sizes.push_back(max_entries);
+    return sizes;
+}
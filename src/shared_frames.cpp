@@ -0,0 +1,203 @@
+#include "shared_frames.h"
+#include "checkpoint.h"
+#include "memory_manager.h"
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+
+std::vector<AddressRange> SharedFrames::regions;
+
+void SharedFrames::setRegions(const std::vector<AddressRange>& shared_regions) {
+    regions = shared_regions;
+}
+
+bool SharedFrames::inRegion(uint64_t address) {
+    for (size_t i = 0; i < regions.size(); ++i) {
+        if (address >= regions[i].start && address <= regions[i].end) return true;
+    }
+    return false;
+}
+
+bool SharedFrames::overlapsRegion(uint64_t start, uint64_t end) {
+    for (size_t i = 0; i < regions.size(); ++i) {
+        if (start <= regions[i].end && end >= regions[i].start) return true;
+    }
+    return false;
+}
+
+SharedFrames& SharedFrames::getInstance() {
+    static SharedFrames instance;
+    return instance;
+}
+
+void SharedFrames::addMapping(Frame& frame, PageOwner* owner, uint64_t virtual_page) {
+    if (!frame.mappings.empty()) {
+        saved++;
+        stats.peak_saved = std::max(stats.peak_saved, saved);
+    }
+    Mapping mapping = {owner, virtual_page};
+    frame.mappings.push_back(mapping);
+}
+
+uint32_t SharedFrames::mapRegionPage(PageOwner* owner, uint64_t virtual_page) {
+    auto resident = region_frames.find(virtual_page);
+    if (resident != region_frames.end()) {
+        stats.region_attaches++;
+        addMapping(frames[resident->second], owner, virtual_page);
+        return resident->second;
+    }
+
+    MemoryManager& memory = MemoryManager::getInstance();
+    uint32_t frame = memory.allocatePage(this, 0);
+    memory.setFrameOwner(frame, this, frame);
+    stats.region_faults++;
+
+    Frame& entry = frames[frame];
+    entry.region = true;
+    entry.region_page = virtual_page;
+    addMapping(entry, owner, virtual_page);
+    region_frames[virtual_page] = frame;
+    return frame;
+}
+
+void SharedFrames::share(uint32_t frame, PageOwner* owner, uint64_t virtual_page) {
+    auto it = frames.find(frame);
+    if (it == frames.end()) {
+        MemoryManager& memory = MemoryManager::getInstance();
+        uint64_t first_page;
+        PageOwner* first = memory.getFrameOwner(frame, first_page);
+        memory.setFrameOwner(frame, this, frame);
+
+        it = frames.insert(std::make_pair(frame, Frame())).first;
+        it->second.region = false;
+        it->second.region_page = 0;
+        addMapping(it->second, first, first_page);
+    }
+    addMapping(it->second, owner, virtual_page);
+}
+
+void SharedFrames::countFork(uint32_t mappings) {
+    stats.forks++;
+    stats.fork_mappings += mappings;
+}
+
+bool SharedFrames::unmap(uint32_t frame, PageOwner* owner, uint64_t virtual_page) {
+    auto it = frames.find(frame);
+    if (it == frames.end()) return false;
+
+    std::vector<Mapping>& mappings = it->second.mappings;
+    for (size_t i = 0; i < mappings.size(); ++i) {
+        if (mappings[i].owner == owner && mappings[i].virtual_page == virtual_page) {
+            mappings[i] = mappings.back();
+            mappings.pop_back();
+            if (!mappings.empty()) saved--;
+            break;
+        }
+    }
+
+    MemoryManager& memory = MemoryManager::getInstance();
+    if (mappings.empty()) {
+        if (it->second.region) region_frames.erase(it->second.region_page);
+        frames.erase(it);
+        memory.deallocatePage(frame);
+    } else if (!it->second.region && mappings.size() == 1) {
+        // The last task to map a forked frame gets it back as its own
+        memory.setFrameOwner(frame, mappings[0].owner, mappings[0].virtual_page);
+        frames.erase(it);
+    }
+    return true;
+}
+
+uint32_t SharedFrames::breakCOW(uint32_t frame, PageOwner* owner, uint64_t virtual_page) {
+    // Forked frames with a single mapping have already gone back to it
+    if (!unmap(frame, owner, virtual_page)) {
+        stats.cow_reuses++;
+        return frame;
+    }
+    stats.cow_copies++;
+    return MemoryManager::getInstance().allocatePage(owner, virtual_page);
+}
+
+void SharedFrames::evictPage(uint64_t frame) {
+    auto it = frames.find(static_cast<uint32_t>(frame));
+    if (it == frames.end()) return;
+
+    std::vector<Mapping> mappings;
+    mappings.swap(it->second.mappings);
+    if (it->second.region) region_frames.erase(it->second.region_page);
+    frames.erase(it);
+    saved -= mappings.size() - 1;
+
+    for (size_t i = 0; i < mappings.size(); ++i) {
+        mappings[i].owner->evictPage(mappings[i].virtual_page);
+    }
+}
+
+void SharedFrames::printStats() const {
+    if (regions.empty() && stats.forks == 0) return;
+    uint64_t shared = frames.size();
+    uint64_t mappings = 0;
+    for (auto it = frames.begin(); it != frames.end(); ++it) {
+        mappings += it->second.mappings.size();
+    }
+
+    std::cout << "\n=== Shared Memory ===\n";
+    if (!regions.empty()) {
+        std::cout << "Shared Regions:" << std::hex << std::setfill('0');
+        for (size_t i = 0; i < regions.size(); ++i) {
+            std::cout << (i > 0 ? ", " : " ") << "0x" << std::setw(8) << regions[i].start
+                      << "-0x" << std::setw(8) << regions[i].end;
+        }
+        std::cout << std::dec << std::setfill(' ') << "\n";
+        std::cout << "Region Faults: " << stats.region_faults
+                  << ", Region Attaches: " << stats.region_attaches << "\n";
+    }
+    std::cout << "Forks: " << stats.forks << ", Pages Shared by Fork: " << stats.fork_mappings << "\n";
+    std::cout << "COW Faults: " << stats.cow_copies + stats.cow_reuses << " (copied: " << stats.cow_copies
+              << ", reused: " << stats.cow_reuses << ")\n";
+    std::cout << "Shared Frames: " << shared << ", Mappings: " << mappings
+              << ", Frames Saved: " << mappings - shared << " (peak: " << stats.peak_saved << ")\n";
+}
+
+void SharedFrames::save(CheckpointWriter& out) const {
+    out.beginSection("SHRD");
+    out.put<SharingStats>(stats);
+    out.put<uint64_t>(saved);
+    out.put<uint64_t>(frames.size());
+    for (auto it = frames.begin(); it != frames.end(); ++it) {
+        const Frame& frame = it->second;
+        out.put<uint32_t>(it->first);
+        out.put<uint8_t>(frame.region);
+        out.put<uint64_t>(frame.region_page);
+        out.put<uint64_t>(frame.mappings.size());
+        for (size_t i = 0; i < frame.mappings.size(); ++i) {
+            out.put<uint32_t>(out.ownerId(frame.mappings[i].owner));
+            out.put<uint64_t>(frame.mappings[i].virtual_page);
+        }
+    }
+    out.endSection();
+}
+
+void SharedFrames::restore(CheckpointReader& in) {
+    if (!in.beginSection("SHRD")) return;
+    stats = in.get<SharingStats>();
+    saved = in.get<uint64_t>();
+    frames.clear();
+    region_frames.clear();
+    uint64_t count = in.get<uint64_t>();
+    for (uint64_t n = 0; n < count && in.ok(); ++n) {
+        uint32_t number = in.get<uint32_t>();
+        Frame& frame = frames[number];
+        frame.region = in.get<uint8_t>() != 0;
+        frame.region_page = in.get<uint64_t>();
+        uint64_t mappings = in.get<uint64_t>();
+        for (uint64_t i = 0; i < mappings && in.ok(); ++i) {
+            Mapping mapping;
+            mapping.owner = in.owner(in.get<uint32_t>());
+            mapping.virtual_page = in.get<uint64_t>();
+            frame.mappings.push_back(mapping);
+        }
+        if (frame.region) region_frames[frame.region_page] = number;
+    }
+    in.endSection();
+}
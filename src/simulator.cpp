@@ -0,0 +1,16 @@
+#include "simulator.h"
+
+int runSimulator(int argc, char* argv[], PageTableKind default_layout) {
+    SimOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        return 1;
+    }
+    PageTableKind layout = options.page_table != PAGE_TABLE_DEFAULT ? options.page_table : default_layout;
+    switch (layout) {
+        case PAGE_TABLE_SINGLE: return runSingleLevel(options);
+        case PAGE_TABLE_4LEVEL: return runFourLevel(options);
+        case PAGE_TABLE_5LEVEL: return runFiveLevel(options);
+        case PAGE_TABLE_INVERTED: return runInverted(options);
+        default: return runMultiLevel(options);
+    }
+}
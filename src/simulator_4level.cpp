@@ -0,0 +1,6 @@
+// Four-level page table instantiations of the simulator
+#include "simulator.h"
+
+int runFourLevel(SimOptions& options) {
+    return runLayout<FourLevelTable>(options);
+}
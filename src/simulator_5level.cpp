@@ -0,0 +1,6 @@
+// Five-level page table instantiations of the simulator
+#include "simulator.h"
+
+int runFiveLevel(SimOptions& options) {
+    return runLayout<FiveLevelTable>(options);
+}
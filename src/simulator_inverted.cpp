@@ -0,0 +1,6 @@
+// Inverted page table instantiations of the simulator
+#include "simulator.h"
+
+int runInverted(SimOptions& options) {
+    return runLayout<InvertedTable>(options);
+}
@@ -0,0 +1,6 @@
+// Two-level page table instantiations of the simulator
+#include "simulator.h"
+
+int runMultiLevel(SimOptions& options) {
+    return runLayout<MultiLevelTable>(options);
+}
@@ -0,0 +1,6 @@
+// Single-level page table (hash map) instantiations of the simulator
+#include "simulator.h"
+
+int runSingleLevel(SimOptions& options) {
+    return runLayout<SingleLevelTable>(options);
+}
@@ -0,0 +1,447 @@
+#include "swap.h"
+#include "checkpoint.h"
+#include "memory_manager.h"
+#include "metrics.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#ifndef _WIN32
+#include <unistd.h>
+#else
+#include <io.h>
+#include <sys/stat.h>
+#endif
+
+namespace {
+
+uint64_t nowNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Bytes at the start of a page that identify it: virtual page, then slot
+const size_t PAGE_TAG_BYTES = sizeof(uint64_t) + sizeof(uint32_t);
+
+#ifdef _WIN32
+// Seek and transfer are two calls here, so the I/O threads take turns
+std::mutex file_lock;
+#endif
+
+} // namespace
+
+SwapDevice::SwapDevice()
+    : enabled(false), page_size(0), slot_count(0), fd(-1), frees_since_scan(SWAP_CLUSTER_SLOTS), depth(0),
+      writing(0), reserved(0), stopping(false) {}
+
+SwapDevice::~SwapDevice() {
+    shutdown();
+}
+
+SwapDevice& SwapDevice::getInstance() {
+    static SwapDevice instance;
+    return instance;
+}
+
+bool SwapDevice::configure(uint64_t swap_bytes, uint32_t page_size_kb, const std::string& file_name,
+                           unsigned threads) {
+    page_size = page_size_kb * 1024;
+    slot_count = static_cast<uint32_t>(swap_bytes / page_size);
+
+#ifndef _WIN32
+    if (file_name.empty()) {
+        const char* dir = getenv("TMPDIR");
+        path = std::string(dir != nullptr && *dir != '\0' ? dir : "/tmp") + "/vmsim-swap-XXXXXX";
+        std::vector<char> name(path.begin(), path.end());
+        name.push_back('\0');
+        fd = mkstemp(&name[0]);
+        if (fd >= 0) unlink(&name[0]);
+        path = "temporary file";
+    } else {
+        path = file_name;
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    }
+    bool sized = fd >= 0 && ftruncate(fd, static_cast<off_t>(slot_count) * page_size) == 0;
+#else
+    if (file_name.empty()) {
+        char name[L_tmpnam];
+        if (tmpnam(name) != nullptr) {
+            fd = _open(name, _O_RDWR | _O_CREAT | _O_TRUNC | _O_BINARY | _O_TEMPORARY, _S_IREAD | _S_IWRITE);
+        }
+        path = "temporary file";
+    } else {
+        path = file_name;
+        fd = _open(path.c_str(), _O_RDWR | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+    }
+    bool sized = fd >= 0 && _chsize_s(fd, static_cast<__int64>(slot_count) * page_size) == 0;
+#endif
+    if (!sized) {
+        std::cerr << "Error creating swap file: " << (file_name.empty() ? "(temporary)" : file_name) << std::endl;
+        return false;
+    }
+
+    slots.reset(new FrameAllocator(slot_count));
+    slot_state.assign(slot_count, SLOT_FREE);
+    slot_pages.assign(slot_count, 0);
+    for (unsigned t = 0; t < threads; ++t) {
+        io_threads.push_back(std::thread(&SwapDevice::ioThread, this));
+    }
+    enabled = true;
+    return true;
+}
+
+void SwapDevice::shutdown() {
+    {
+        std::lock_guard<std::mutex> held(lock);
+        stopping = true;
+    }
+    queue_ready.notify_all();
+    for (size_t t = 0; t < io_threads.size(); ++t) {
+        io_threads[t].join();
+    }
+    io_threads.clear();
+    if (fd >= 0) {
+#ifndef _WIN32
+        ::close(fd);
+#else
+        _close(fd);
+#endif
+        fd = -1;
+    }
+}
+
+uint32_t SwapDevice::slotsInUse() const {
+    return slots->getAllocatedCount() - reserved;
+}
+
+// The next slot of the cluster, reserving a new cluster when it is used up.
+// Looking for a free cluster scans the slot bitmap, so after a scan that
+// found none the next one waits until a cluster's worth of slots have been
+// freed.
+bool SwapDevice::allocateSlot(uint32_t& slot) {
+    if (batch.cluster_next == batch.cluster_end && frees_since_scan >= SWAP_CLUSTER_SLOTS) {
+        uint32_t first;
+        if (slots->allocateRange(SWAP_CLUSTER_SLOTS, first)) {
+            batch.cluster_next = first;
+            batch.cluster_end = first + SWAP_CLUSTER_SLOTS;
+            reserved += SWAP_CLUSTER_SLOTS;
+        } else {
+            frees_since_scan = 0;
+        }
+    }
+    if (batch.cluster_next < batch.cluster_end) {
+        slot = batch.cluster_next++;
+        reserved--;
+        return true;
+    }
+    return slots->allocate(slot);
+}
+
+void SwapDevice::freeSlot(uint32_t slot) {
+    slot_state[slot] = SLOT_FREE;
+    slots->free(slot);
+    frees_since_scan++;
+}
+
+// Drops a slot still in the batch, so its page is never written
+void SwapDevice::takeFromBatch(uint32_t slot) {
+    std::vector<uint32_t>::iterator it = std::find(batch.slots.begin(), batch.slots.end(), slot);
+    if (it != batch.slots.end()) batch.slots.erase(it);
+}
+
+// Page-ins go ahead of the queued writes: a task is waiting for them
+void SwapDevice::submit(Request* request) {
+    if (request->write) {
+        queue.push_back(request);
+    } else {
+        queue.push_front(request);
+    }
+    depth++;
+    if (request->write) writing++;
+    stats.requests++;
+    stats.depth_sum += depth;
+    stats.peak_depth = std::max<uint64_t>(stats.peak_depth, depth);
+    queue_ready.notify_one();
+}
+
+// Hands the batch to the I/O threads, one write per run of contiguous slots
+void SwapDevice::flush() {
+    std::vector<uint32_t>& pending = batch.slots;
+    if (pending.empty()) return;
+    std::sort(pending.begin(), pending.end());
+    size_t first = 0;
+    while (first < pending.size()) {
+        size_t end = first + 1;
+        while (end < pending.size() && pending[end] == pending[end - 1] + 1) end++;
+
+        Request* request = new Request();
+        request->write = true;
+        request->first_slot = pending[first];
+        request->count = static_cast<uint32_t>(end - first);
+        request->ok = false;
+        request->done = false;
+        for (size_t i = first; i < end; ++i) {
+            slot_state[pending[i]] = SLOT_WRITING;
+        }
+        submit(request);
+        stats.writes++;
+        first = end;
+    }
+    stats.batches++;
+    pending.clear();
+}
+
+void SwapDevice::fillPage(uint32_t slot, char* page) const {
+    memcpy(page, &slot_pages[slot], sizeof(uint64_t));
+    memcpy(page + sizeof(uint64_t), &slot, sizeof(uint32_t));
+    memset(page + PAGE_TAG_BYTES, 0, page_size - PAGE_TAG_BYTES);
+}
+
+bool SwapDevice::transfer(bool write, uint32_t first_slot, uint32_t count, char* data) {
+    size_t bytes = static_cast<size_t>(count) * page_size;
+    uint64_t offset = static_cast<uint64_t>(first_slot) * page_size;
+#ifndef _WIN32
+    while (bytes > 0) {
+        ssize_t n = write ? pwrite(fd, data, bytes, static_cast<off_t>(offset))
+                          : pread(fd, data, bytes, static_cast<off_t>(offset));
+        if (n <= 0) return false;
+        data += n;
+        bytes -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+#else
+    std::lock_guard<std::mutex> held(file_lock);
+    if (_lseeki64(fd, static_cast<__int64>(offset), SEEK_SET) < 0) return false;
+    while (bytes > 0) {
+        int n = write ? _write(fd, data, static_cast<unsigned>(bytes)) : _read(fd, data, static_cast<unsigned>(bytes));
+        if (n <= 0) return false;
+        data += n;
+        bytes -= static_cast<size_t>(n);
+    }
+#endif
+    return true;
+}
+
+// An I/O thread: takes requests off the queue until shutdown. The pages of
+// a write are filled in here, outside the lock; their slots are not freed
+// while the write is in flight.
+void SwapDevice::ioThread() {
+    std::vector<char> buffer;
+    std::unique_lock<std::mutex> held(lock);
+    for (;;) {
+        queue_ready.wait(held, [this] { return stopping || !queue.empty(); });
+        if (queue.empty()) return;
+        Request* request = queue.front();
+        queue.pop_front();
+        held.unlock();
+
+        bool ok;
+        if (request->write) {
+            buffer.resize(static_cast<size_t>(request->count) * page_size);
+            for (uint32_t i = 0; i < request->count; ++i) {
+                fillPage(request->first_slot + i, &buffer[static_cast<size_t>(i) * page_size]);
+            }
+            ok = transfer(true, request->first_slot, request->count, &buffer[0]);
+        } else {
+            ok = transfer(false, request->first_slot, request->count, &request->data[0]);
+        }
+
+        held.lock();
+        depth--;
+        if (request->write) {
+            for (uint32_t i = 0; i < request->count; ++i) {
+                slot_state[request->first_slot + i] = SLOT_STORED;
+            }
+            if (!ok) stats.io_errors++;
+            writing--;
+            delete request;
+        } else {
+            // The reader owns its request
+            request->ok = ok;
+            request->done = true;
+        }
+        io_done.notify_all();
+    }
+}
+
+void SwapDevice::waitForWrites(std::unique_lock<std::mutex>& held) {
+    io_done.wait(held, [this] { return writing == 0; });
+}
+
+bool SwapDevice::pageOut(uint64_t virtual_page, uint32_t& slot) {
+    std::lock_guard<std::mutex> held(lock);
+    if (!allocateSlot(slot)) {
+        stats.full++;
+        return false;
+    }
+    slot_state[slot] = SLOT_BATCHED;
+    slot_pages[slot] = virtual_page;
+    stats.swap_outs++;
+    stats.peak_slots = std::max<uint64_t>(stats.peak_slots, slotsInUse());
+
+    batch.slots.push_back(slot);
+    if (batch.slots.size() >= SWAP_BATCH_PAGES) flush();
+    return true;
+}
+
+bool SwapDevice::pageIn(uint64_t virtual_page, uint32_t slot) {
+    uint64_t start = nowNs();
+#if METRICS_LEVEL > 0
+    uint64_t start_ticks = metricsClock();
+#endif
+    std::unique_lock<std::mutex> held(lock);
+
+    // Still batched: take the page back without I/O
+    if (slot_state[slot] == SLOT_BATCHED) {
+        takeFromBatch(slot);
+        freeSlot(slot);
+        stats.cache_hits++;
+        return false;
+    }
+
+    io_done.wait(held, [&] { return slot_state[slot] != SLOT_WRITING; });
+    Request request;
+    request.write = false;
+    request.first_slot = slot;
+    request.count = 1;
+    request.data.resize(page_size);
+    request.ok = false;
+    request.done = false;
+    submit(&request);
+    io_done.wait(held, [&] { return request.done; });
+
+    uint64_t tag_page;
+    uint32_t tag_slot;
+    memcpy(&tag_page, &request.data[0], sizeof(tag_page));
+    memcpy(&tag_slot, &request.data[sizeof(tag_page)], sizeof(tag_slot));
+    if (!request.ok || tag_page != virtual_page || tag_slot != slot) stats.io_errors++;
+
+    freeSlot(slot);
+    stats.swap_ins++;
+    uint64_t waited = nowNs() - start;
+    stats.wait_ns += waited;
+    stats.peak_wait_ns = std::max(stats.peak_wait_ns, waited);
+    held.unlock();
+    METRICS_RECORD(METRIC_PAGE_IN, metricsClock() - start_ticks);
+    return true;
+}
+
+void SwapDevice::discard(uint32_t slot) {
+    std::unique_lock<std::mutex> held(lock);
+    if (slot_state[slot] == SLOT_BATCHED) {
+        takeFromBatch(slot);
+    }
+    io_done.wait(held, [&] { return slot_state[slot] != SLOT_WRITING; });
+    freeSlot(slot);
+    stats.discards++;
+}
+
+void SwapDevice::printStats() {
+    if (!enabled) return;
+    uint64_t faults = MemoryManager::getInstance().getReplacementStats().faults;
+    std::unique_lock<std::mutex> held(lock);
+    flush();
+    waitForWrites(held);
+
+    double page_kb = page_size / 1024.0;
+    std::cout << "\n=== Swap ===\n";
+    std::cout << "Swap Space: " << slot_count << " slots of " << page_size / 1024 << "KB, " << path
+              << " (in use: " << slotsInUse() << ", peak: " << stats.peak_slots << ")\n";
+    std::cout << "Swap-Outs: " << stats.swap_outs << " pages (" << stats.swap_outs * page_kb / 1024 << " MB) in "
+              << stats.batches << " batches, " << stats.writes << " writes";
+    if (stats.full > 0) {
+        std::cout << ", Swap Full: " << stats.full;
+    }
+    std::cout << "\nSwap-Ins: " << stats.swap_ins << " pages (" << stats.swap_ins * page_kb / 1024
+              << " MB), Discarded: " << stats.discards << "\n";
+    // Of the faults that took a frame, only the page-ins waited for the file
+    std::cout << "Faults: " << stats.swap_ins << " major, " << faults - std::min(faults, stats.swap_ins)
+              << " minor (" << stats.cache_hits << " from write batches)\n";
+    std::cout << "I/O Queue Depth: average "
+              << (stats.requests > 0 ? static_cast<double>(stats.depth_sum) / stats.requests : 0.0)
+              << ", peak " << stats.peak_depth << " (" << io_threads.size() << " I/O threads)\n";
+    std::cout << "Page-In Wait: average "
+              << (stats.swap_ins > 0 ? stats.wait_ns / 1000.0 / stats.swap_ins : 0.0) << " us, max "
+              << stats.peak_wait_ns / 1000.0 << " us, total " << stats.wait_ns / 1e9 << " s\n";
+    if (stats.io_errors > 0) {
+        std::cout << "I/O Errors: " << stats.io_errors << "\n";
+    }
+}
+
+void SwapDevice::save(CheckpointWriter& out) {
+    std::unique_lock<std::mutex> held(lock);
+    out.beginSection("SWAP");
+    out.put<uint8_t>(enabled);
+    if (enabled) {
+        waitForWrites(held);
+        out.put<uint32_t>(slot_count);
+        slots->save(out);
+        out.putVector(slot_pages);
+        out.putVector(batch.slots);
+        out.put<uint32_t>(batch.cluster_next);
+        out.put<uint32_t>(batch.cluster_end);
+        out.put<uint32_t>(frees_since_scan);
+        out.put<SwapStats>(stats);
+    }
+    out.endSection();
+}
+
+void SwapDevice::restore(CheckpointReader& in) {
+    if (!in.beginSection("SWAP")) return;
+    if (in.get<uint8_t>() != 0) {
+        std::unique_lock<std::mutex> held(lock);
+        if (!enabled || in.get<uint32_t>() != slot_count) {
+            in.fail();
+            return;
+        }
+        slots->restore(in);
+        in.getVector(slot_pages);
+        in.getVector(batch.slots);
+        batch.cluster_next = in.get<uint32_t>();
+        batch.cluster_end = in.get<uint32_t>();
+        frees_since_scan = in.get<uint32_t>();
+        stats = in.get<SwapStats>();
+        if (slot_pages.size() != slot_count || batch.cluster_next > batch.cluster_end ||
+            batch.cluster_end > slot_count) {
+            in.fail();
+            return;
+        }
+
+        // The pages written before the checkpoint go to this run's file
+        reserved = batch.cluster_end - batch.cluster_next;
+        for (uint32_t slot = 0; slot < slot_count; ++slot) {
+            bool unused = slot >= batch.cluster_next && slot < batch.cluster_end;
+            slot_state[slot] = slots->isAllocated(slot) && !unused ? SLOT_STORED : SLOT_FREE;
+        }
+        for (size_t i = 0; i < batch.slots.size(); ++i) {
+            if (batch.slots[i] < slot_count) slot_state[batch.slots[i]] = SLOT_BATCHED;
+        }
+        for (uint32_t slot = 0; slot < slot_count;) {
+            if (slot_state[slot] != SLOT_STORED) {
+                slot++;
+                continue;
+            }
+            uint32_t end = slot + 1;
+            while (end < slot_count && end - slot < SWAP_BATCH_PAGES && slot_state[end] == SLOT_STORED) end++;
+            Request* request = new Request();
+            request->write = true;
+            request->first_slot = slot;
+            request->count = end - slot;
+            request->ok = false;
+            request->done = false;
+            for (uint32_t s = slot; s < end; ++s) {
+                slot_state[s] = SLOT_WRITING;
+            }
+            queue.push_back(request);
+            depth++;
+            writing++;
+            queue_ready.notify_one();
+            slot = end;
+        }
+        waitForWrites(held);
+    }
+    in.endSection();
+}
@@ -1,46 +1,372 @@
 #include "../include/tlb.h"
+#include "../include/checkpoint.h"
+#include "../include/metrics.h"
 #include <iostream>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
-TLB::TLB() : hits(0), misses(0) {}
+const uint64_t TLB::INVALID_TAG;
+const uint32_t TLB::ASID_SHIFT;
+const uint32_t TLB::MAX_ASID;
+TLBConfig TLB::default_config;
 
-bool TLB::lookup(uint32_t virtual_page, uint32_t& physical_page) {
-    auto it = tlb_map.find(virtual_page);
-    if (it != tlb_map.end()) {
-        // TLB hit - move to front of LRU list
-        lru_list.splice(lru_list.begin(), lru_list, it->second);
-        physical_page = it->second->physical_page;
+const char* TLBConfig::validate() const {
+    if (sets == 0 || (sets & (sets - 1)) != 0) {
+        return "TLB set count must be a power of two";
+    }
+    if (ways == 0 || ways > 64) {
+        return "TLB ways must be between 1 and 64";
+    }
+    if (large_entries > 64) {
+        return "TLB large-page entries must be between 0 and 64";
+    }
+    if (policy == TLB_REPLACE_PLRU && (ways & (ways - 1)) != 0) {
+        return "tree-PLRU needs a power-of-two way count";
+    }
+    if (l2_sets != 0) {
+        if ((l2_sets & (l2_sets - 1)) != 0) {
+            return "L2 TLB set count must be a power of two";
+        }
+        if (l2_ways == 0 || l2_ways > 64) {
+            return "L2 TLB ways must be between 1 and 64";
+        }
+        if (policy == TLB_REPLACE_PLRU && (l2_ways & (l2_ways - 1)) != 0) {
+            return "tree-PLRU needs a power-of-two L2 way count";
+        }
+    }
+    if (walk_cache_entries > 64) {
+        return "page-walk cache entries must be between 0 and 64";
+    }
+    return nullptr;
+}
+
+void TranslationStats::add(const TranslationStats& other) {
+    lookups += other.lookups;
+    l2_hits += other.l2_hits;
+    misses += other.misses;
+    walk_cache_hits += other.walk_cache_hits;
+    walk_reads += other.walk_reads;
+}
+
+uint64_t TranslationStats::walkCycles(const TLBConfig& config) const {
+    return walk_cache_hits * config.walk_cache_cycles + walk_reads * config.memory_cycles;
+}
+
+uint64_t TranslationStats::cycles(const TLBConfig& config) const {
+    uint64_t l2 = config.l2_sets != 0 ? (l2_hits + misses) * config.l2_cycles : 0;
+    return lookups * config.l1_cycles + l2 + walkCycles(config);
+}
+
+void TranslationStats::printLatency(const TLBConfig& config) const {
+    uint64_t total = cycles(config);
+    double average = lookups > 0 ? static_cast<double>(total) / lookups : 0;
+    double walk_share = total > 0 ? (static_cast<double>(walkCycles(config)) / total) * 100 : 0;
+    std::cout << "Average Translation Latency: " << average << " cycles (page walks: "
+              << walk_share << "% of cycles)\n";
+}
+
+TLB::TLB() : config(default_config) {
+    init();
+}
+
+TLB::TLB(const TLBConfig& cfg) : config(cfg) {
+    init();
+}
+
+void TLB::setDefaultConfig(const TLBConfig& cfg) {
+    default_config = cfg;
+}
+
+const TLBConfig& TLB::getDefaultConfig() {
+    return default_config;
+}
+
+TLBConfig TLB::nestedConfig(uint32_t sets, uint32_t ways, TLBReplacement policy) {
+    TLBConfig nested;
+    nested.sets = sets;
+    nested.ways = ways;
+    nested.policy = policy;
+    nested.large_entries = 0;
+    nested.l2_sets = 0;
+    nested.walk_cache_entries = 0;
+    return nested;
+}
+
+void TLB::init() {
+    set_mask = config.sets - 1;
+    stride = (config.ways + 3) & ~3u;
+    tags.assign(static_cast<size_t>(config.sets) * stride, static_cast<uint32_t>(INVALID_TAG));
+    tags_high.assign(tags.size(), static_cast<uint32_t>(INVALID_TAG >> 32));
+    frames.assign(tags.size(), 0);
+    occupied.assign(config.sets, 0);
+    if (config.policy == TLB_REPLACE_LRU) {
+        // Every set starts as the list 0 -> 1 -> ... -> ways - 1
+        lru_prev.assign(tags.size(), 0);
+        lru_next.assign(tags.size(), 0);
+        lru_head.assign(config.sets, 0);
+        lru_tail.assign(config.sets, static_cast<uint8_t>(config.ways - 1));
+        for (uint32_t set = 0; set < config.sets; ++set) {
+            for (uint32_t w = 0; w < config.ways; ++w) {
+                lru_prev[set * stride + w] = static_cast<uint8_t>(w - 1);
+                lru_next[set * stride + w] = static_cast<uint8_t>(w + 1);
+            }
+        }
+    } else if (config.policy == TLB_REPLACE_PLRU) {
+        plru_bits.assign(config.sets, 0);
+    }
+    if (config.l2_sets != 0) {
+        l2.reset(new TLB(nestedConfig(config.l2_sets, config.l2_ways, config.policy)));
+    }
+    rng_state = 0x9E3779B9u;
+    asid_bits = 0;
+    hits = 0;
+    misses = 0;
+    large_hits = 0;
+    l2_hits = 0;
+    foreign_evictions = 0;
+    walk_cache_hits = 0;
+    walk_reads = 0;
+}
+
+// Returns the first way in the set holding `tag`, or -1
+int TLB::findWay(uint32_t set, uint64_t tag) const {
+    const uint32_t* row = &tags[set * stride];
+    const uint32_t* row_high = &tags_high[set * stride];
+    uint32_t low = static_cast<uint32_t>(tag);
+    uint32_t high = static_cast<uint32_t>(tag >> 32);
+#if defined(__SSE2__)
+    // Compare the low words of four ways per step; padding ways always hold
+    // INVALID_TAG
+    __m128i key = _mm_set1_epi32(static_cast<int>(low));
+    for (uint32_t w = 0; w < stride; w += 4) {
+        __m128i ways = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + w));
+        int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(ways, key)));
+        for (; mask; mask &= mask - 1) {
+            uint32_t way = w + __builtin_ctz(mask);
+            if (row_high[way] == high) return static_cast<int>(way);
+        }
+    }
+#else
+    for (uint32_t w = 0; w < stride; ++w) {
+        if (row[w] == low && row_high[w] == high) return static_cast<int>(w);
+    }
+#endif
+    return -1;
+}
+
+// Record an access to (set, way) for the replacement policy
+void TLB::touch(uint32_t set, uint32_t way) {
+    if (config.policy == TLB_REPLACE_LRU) {
+        // Unlink `way` and put it at the head of the set's recency list
+        uint8_t head = lru_head[set];
+        if (way == head) return;
+        uint8_t* prev = &lru_prev[set * stride];
+        uint8_t* next = &lru_next[set * stride];
+        if (way == lru_tail[set]) {
+            lru_tail[set] = prev[way];
+        } else {
+            prev[next[way]] = prev[way];
+        }
+        next[prev[way]] = next[way];
+        next[way] = head;
+        prev[head] = static_cast<uint8_t>(way);
+        lru_head[set] = static_cast<uint8_t>(way);
+    } else if (config.policy == TLB_REPLACE_PLRU) {
+        // Walk root to leaf, pointing every node on the path away from `way`
+        uint64_t& bits = plru_bits[set];
+        uint32_t node = 1;
+        for (uint32_t half = config.ways >> 1; half > 0; half >>= 1) {
+            uint32_t right = (way & half) ? 1 : 0;
+            if (right) bits &= ~(1ULL << node);
+            else bits |= 1ULL << node;
+            node = node * 2 + right;
+        }
+    }
+}
+
+uint32_t TLB::chooseVictim(uint32_t set) {
+    // Fill empty ways before evicting anything
+    if (occupied[set] < config.ways) {
+        occupied[set]++;
+        return static_cast<uint32_t>(findWay(set, INVALID_TAG));
+    }
+
+    switch (config.policy) {
+        case TLB_REPLACE_LRU:
+            return lru_tail[set];
+        case TLB_REPLACE_PLRU: {
+            // Follow the tree bits from the root down to a leaf
+            uint64_t bits = plru_bits[set];
+            uint32_t node = 1;
+            while (node < config.ways) {
+                node = node * 2 + ((bits >> node) & 1);
+            }
+            return node - config.ways;
+        }
+        case TLB_REPLACE_RANDOM:
+        default: {
+            rng_state ^= rng_state << 13;
+            rng_state ^= rng_state >> 17;
+            rng_state ^= rng_state << 5;
+            return rng_state % config.ways;
+        }
+    }
+}
+
+bool TLB::lookup(uint64_t virtual_page, uint32_t& physical_page) {
+    uint32_t set = static_cast<uint32_t>(virtual_page) & set_mask;
+    int way = findWay(set, virtual_page | asid_bits);
+    if (way >= 0) {
+        // TLB hit - update replacement state
+        touch(set, static_cast<uint32_t>(way));
+        physical_page = frames[set * stride + way];
+        hits++;
+        return true;
+    }
+
+    // Size-tagged second probe: one large entry covers a whole large page
+    if (large && large->lookup(virtual_page >> config.large_order, physical_page)) {
+        physical_page += static_cast<uint32_t>(virtual_page) & ((1u << config.large_order) - 1);
+        hits++;
+        large_hits++;
+        return true;
+    }
+
+    // Second level: the L1 sets were just probed, so the hit goes straight
+    // into a victim way
+    if (l2 && l2->lookup(virtual_page, physical_page)) {
+        fillWay(set, chooseVictim(set), virtual_page | asid_bits, physical_page);
         hits++;
+        l2_hits++;
         return true;
     }
-    
+
     misses++;
     return false;
 }
 
-void TLB::add(uint32_t virtual_page, uint32_t physical_page) {
-    // If the TLB is full, remove the least recently used entry
-    if (lru_list.size() >= TLB_SIZE) {
-        tlb_map.erase(lru_list.back().virtual_page);
-        lru_list.pop_back();
+void TLB::walk(uint32_t levels, uint64_t directory_key, bool to_table) {
+    if (to_table && levels > 1 && config.walk_cache_entries > 0) {
+        if (!walk_cache) {
+            walk_cache.reset(new TLB(nestedConfig(1, config.walk_cache_entries, TLB_REPLACE_LRU)));
+            walk_cache->setASID(getASID());
+        }
+        uint32_t unused;
+        if (walk_cache->lookup(directory_key, unused)) {
+            walk_cache_hits++;
+            levels = 1;
+        } else {
+            walk_cache->fill(directory_key, 0);
+        }
     }
-    
-    // Add new entry at the front of the LRU list
-    TLBEntry entry{virtual_page, physical_page, false};
-    lru_list.push_front(entry);
-    tlb_map[virtual_page] = lru_list.begin();
+    walk_reads += levels;
+    METRICS_COUNT(METRIC_PAGE_WALKS, 1);
+    METRICS_RECORD(METRIC_WALK_DEPTH, levels);
 }
 
-void TLB::invalidate(uint32_t virtual_page) {
-    auto it = tlb_map.find(virtual_page);
-    if (it != tlb_map.end()) {
-        lru_list.erase(it->second);
-        tlb_map.erase(it);
+void TLB::add(uint64_t virtual_page, uint32_t physical_page) {
+    uint32_t set = static_cast<uint32_t>(virtual_page) & set_mask;
+    uint64_t tag = virtual_page | asid_bits;
+    int existing = findWay(set, tag);
+
+    // Reuse the way if the page is already cached, otherwise evict a victim
+    uint32_t way = existing >= 0 ? static_cast<uint32_t>(existing) : chooseVictim(set);
+    fillWay(set, way, tag, physical_page);
+    if (l2) {
+        l2->add(virtual_page, physical_page);
     }
 }
 
-void TLB::invalidateAll() {
-    lru_list.clear();
-    tlb_map.clear();
+void TLB::fill(uint64_t virtual_page, uint32_t physical_page) {
+    uint32_t set = static_cast<uint32_t>(virtual_page) & set_mask;
+    fillWay(set, chooseVictim(set), virtual_page | asid_bits, physical_page);
+    if (l2) {
+        l2->fill(virtual_page, physical_page);
+    }
+}
+
+void TLB::fillWay(uint32_t set, uint32_t way, uint64_t tag, uint32_t physical_page) {
+    uint32_t slot = set * stride + way;
+    uint64_t old = static_cast<uint64_t>(tags_high[slot]) << 32 | tags[slot];
+    if (old != INVALID_TAG && (old ^ tag) >> ASID_SHIFT) {
+        foreign_evictions++;
+    }
+    tags[slot] = static_cast<uint32_t>(tag);
+    tags_high[slot] = static_cast<uint32_t>(tag >> 32);
+    frames[set * stride + way] = physical_page;
+    touch(set, way);
+}
+
+void TLB::addLarge(uint64_t virtual_page, uint32_t physical_base) {
+    if (config.large_entries == 0) return;
+    if (!large) {
+        large.reset(new TLB(nestedConfig(1, config.large_entries, TLB_REPLACE_LRU)));
+        large->setASID(getASID());
+    }
+    large->add(virtual_page >> config.large_order, physical_base);
+}
+
+void TLB::invalidate(uint64_t virtual_page) {
+    uint32_t set = static_cast<uint32_t>(virtual_page) & set_mask;
+    int way = findWay(set, virtual_page | asid_bits);
+    if (way >= 0) {
+        tags[set * stride + way] = static_cast<uint32_t>(INVALID_TAG);
+        tags_high[set * stride + way] = static_cast<uint32_t>(INVALID_TAG >> 32);
+        occupied[set]--;
+    }
+    if (l2) {
+        l2->invalidate(virtual_page);
+    }
+}
+
+void TLB::invalidateLarge(uint64_t virtual_page) {
+    if (large) {
+        large->invalidate(virtual_page >> config.large_order);
+    }
+}
+
+void TLB::invalidateWalk(uint64_t directory_key) {
+    if (walk_cache) {
+        walk_cache->invalidate(directory_key);
+    }
+}
+
+uint32_t TLB::invalidateAll() {
+    uint32_t valid = 0;
+    for (uint32_t set = 0; set < config.sets; ++set) {
+        valid += occupied[set];
+    }
+    tags.assign(tags.size(), static_cast<uint32_t>(INVALID_TAG));
+    tags_high.assign(tags.size(), static_cast<uint32_t>(INVALID_TAG >> 32));
+    occupied.assign(config.sets, 0);
+    if (large) {
+        valid += large->invalidateAll();
+    }
+    if (l2) {
+        valid += l2->invalidateAll();
+    }
+    if (walk_cache) {
+        walk_cache->invalidateAll();
+    }
+    return valid;
+}
+
+void TLB::setASID(uint32_t id) {
+    asid_bits = static_cast<uint64_t>(id) << ASID_SHIFT;
+    if (large) {
+        large->setASID(id);
+    }
+    if (l2) {
+        l2->setASID(id);
+    }
+    if (walk_cache) {
+        walk_cache->setASID(id);
+    }
+}
+
+uint32_t TLB::getForeignEvictions() const {
+    return foreign_evictions + (l2 ? l2->getForeignEvictions() : 0);
 }
 
 void TLB::getStats(uint32_t& hit_count, uint32_t& miss_count) const {
@@ -48,12 +374,113 @@ void TLB::getStats(uint32_t& hit_count, uint32_t& miss_count) const {
     miss_count = misses;
 }
 
+TranslationStats TLB::getTranslationStats() const {
+    TranslationStats stats;
+    stats.lookups = static_cast<uint64_t>(hits) + misses;
+    stats.l2_hits = l2_hits;
+    stats.misses = misses;
+    stats.walk_cache_hits = walk_cache_hits;
+    stats.walk_reads = walk_reads;
+    return stats;
+}
+
 void TLB::printStats() const {
     uint32_t total = hits + misses;
     double hit_rate = total > 0 ? (static_cast<double>(hits) / total) * 100 : 0;
-    
+
     std::cout << "\n=== TLB Statistics ===\n";
     std::cout << "Hits: " << hits << "\n";
     std::cout << "Misses: " << misses << "\n";
     std::cout << "Hit Rate: " << hit_rate << "%\n";
+    if (large) {
+        std::cout << "Large Page Hits: " << large_hits << "\n";
+    }
+    if (l2) {
+        std::cout << "L2 Hits: " << l2_hits << "\n";
+    }
+    if (walk_cache) {
+        std::cout << "Walk Cache Hits: " << walk_cache_hits << "\n";
+    }
+    getTranslationStats().printLatency(config);
+}
+
+size_t TLB::getMemoryUsage() const {
+    size_t bytes = sizeof(TLB) + (tags.capacity() + tags_high.capacity()) * sizeof(uint32_t) + frames.capacity() * sizeof(uint32_t) +
+                   lru_prev.capacity() + lru_next.capacity() + lru_head.capacity() + lru_tail.capacity() +
+                   plru_bits.capacity() * sizeof(uint64_t) + occupied.capacity();
+    if (large) bytes += large->getMemoryUsage();
+    if (l2) bytes += l2->getMemoryUsage();
+    if (walk_cache) bytes += walk_cache->getMemoryUsage();
+    return bytes;
+}
+
+void TLB::save(CheckpointWriter& out) const {
+    out.putVector(tags);
+    out.putVector(tags_high);
+    out.putVector(frames);
+    out.putVector(lru_prev);
+    out.putVector(lru_next);
+    out.putVector(lru_head);
+    out.putVector(lru_tail);
+    out.putVector(plru_bits);
+    out.putVector(occupied);
+    out.put<uint32_t>(rng_state);
+    out.put<uint64_t>(asid_bits);
+    out.put<uint32_t>(hits);
+    out.put<uint32_t>(misses);
+    out.put<uint32_t>(large_hits);
+    out.put<uint32_t>(l2_hits);
+    out.put<uint32_t>(foreign_evictions);
+    out.put<uint64_t>(walk_cache_hits);
+    out.put<uint64_t>(walk_reads);
+
+    // Nested TLBs, each preceded by whether it exists
+    const TLB* nested[] = {large.get(), l2.get(), walk_cache.get()};
+    for (int i = 0; i < 3; ++i) {
+        out.put<uint8_t>(nested[i] != nullptr);
+        if (nested[i]) nested[i]->save(out);
+    }
+}
+
+void TLB::restore(CheckpointReader& in) {
+    size_t entries = tags.size();
+    in.getVector(tags);
+    in.getVector(tags_high);
+    in.getVector(frames);
+    in.getVector(lru_prev);
+    in.getVector(lru_next);
+    in.getVector(lru_head);
+    in.getVector(lru_tail);
+    in.getVector(plru_bits);
+    in.getVector(occupied);
+    if (tags.size() != entries || tags_high.size() != entries || frames.size() != entries || occupied.size() != config.sets) {
+        in.fail();
+        return;
+    }
+    rng_state = in.get<uint32_t>();
+    asid_bits = in.get<uint64_t>();
+    hits = in.get<uint32_t>();
+    misses = in.get<uint32_t>();
+    large_hits = in.get<uint32_t>();
+    l2_hits = in.get<uint32_t>();
+    foreign_evictions = in.get<uint32_t>();
+    walk_cache_hits = in.get<uint64_t>();
+    walk_reads = in.get<uint64_t>();
+
+    std::unique_ptr<TLB>* nested[] = {&large, &l2, &walk_cache};
+    TLBConfig configs[] = {nestedConfig(1, config.large_entries, TLB_REPLACE_LRU),
+                           nestedConfig(config.l2_sets, config.l2_ways, config.policy),
+                           nestedConfig(1, config.walk_cache_entries, TLB_REPLACE_LRU)};
+    for (int i = 0; i < 3 && in.ok(); ++i) {
+        if (in.get<uint8_t>()) {
+            if (configs[i].sets == 0 || configs[i].ways == 0) {
+                in.fail();
+                return;
+            }
+            nested[i]->reset(new TLB(configs[i]));
+            (*nested[i])->restore(in);
+        } else {
+            nested[i]->reset();
+        }
+    }
 }
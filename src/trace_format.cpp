@@ -0,0 +1,135 @@
+#include "trace_format.h"
+#include <cstring>
+#include <iostream>
+
+bool isBinaryTrace(const void* data, size_t size) {
+    if (size < sizeof(BinaryTraceHeader)) return false;
+    uint32_t magic;
+    memcpy(&magic, data, sizeof(magic));
+    return magic == BINARY_TRACE_MAGIC;
+}
+
+BinaryTraceWriter::BinaryTraceWriter()
+    : file(nullptr), owns_file(false), block_records(0), record_count(0), position(0) {}
+
+BinaryTraceWriter::~BinaryTraceWriter() {
+    close();
+}
+
+bool BinaryTraceWriter::open(const std::string& filename, const std::vector<std::string>& task_ids) {
+    close();
+
+    if (filename == "-") {
+        file = stdout;
+        owns_file = false;
+    } else {
+        file = fopen(filename.c_str(), "wb");
+        owns_file = true;
+    }
+    if (!file) {
+        std::cerr << "Could not open file for writing: " << filename << std::endl;
+        return false;
+    }
+
+    std::vector<uint8_t> strings;
+    for (size_t i = 0; i < task_ids.size(); ++i) {
+        uint16_t length = static_cast<uint16_t>(task_ids[i].size() > 0xFFFF ? 0xFFFF : task_ids[i].size());
+        strings.push_back(static_cast<uint8_t>(length & 0xFF));
+        strings.push_back(static_cast<uint8_t>(length >> 8));
+        strings.insert(strings.end(), task_ids[i].begin(), task_ids[i].begin() + length);
+    }
+
+    BinaryTraceHeader header;
+    header.magic = BINARY_TRACE_MAGIC;
+    header.version = BINARY_TRACE_VERSION;
+    header.task_count = static_cast<uint32_t>(task_ids.size());
+    header.string_table_bytes = static_cast<uint32_t>(strings.size());
+    header.record_count = 0;
+    header.index_offset = 0;
+
+    fwrite(&header, sizeof(header), 1, file);
+    if (!strings.empty()) fwrite(&strings[0], 1, strings.size(), file);
+    position = sizeof(header) + strings.size();
+
+    last_address.assign(task_ids.size(), 0);
+    index.clear();
+    block.clear();
+    block_records = 0;
+    record_count = 0;
+    return true;
+}
+
+void BinaryTraceWriter::append(uint32_t task_index, uint64_t logical_address, uint32_t size_in_bytes) {
+    uint8_t encoded[30];
+    uint8_t* out = putVarint(encoded, static_cast<uint64_t>(task_index) << 1);
+    out = putVarint(out, encodeAddressDelta(last_address[task_index], logical_address));
+    out = putVarint(out, size_in_bytes / 1024);
+    block.insert(block.end(), encoded, out);
+
+    last_address[task_index] = logical_address;
+    record_count++;
+    if (++block_records == BINARY_TRACE_BLOCK_RECORDS) {
+        flushBlock();
+    }
+}
+
+void BinaryTraceWriter::appendFork(uint32_t task_index, uint32_t parent_index) {
+    uint8_t encoded[20];
+    uint8_t* out = putVarint(encoded, (static_cast<uint64_t>(task_index) << 1) | 1);
+    out = putVarint(out, parent_index);
+    block.insert(block.end(), encoded, out);
+
+    record_count++;
+    if (++block_records == BINARY_TRACE_BLOCK_RECORDS) {
+        flushBlock();
+    }
+}
+
+void BinaryTraceWriter::flushBlock() {
+    if (block_records == 0) return;
+
+    BinaryTraceIndexEntry entry = {position, record_count - block_records};
+    index.push_back(entry);
+
+    BinaryTraceBlock header = {block_records, static_cast<uint32_t>(block.size())};
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(&block[0], 1, block.size(), file);
+    position += sizeof(header) + block.size();
+
+    // Blocks decode independently: restart the per-task deltas
+    block.clear();
+    block_records = 0;
+    last_address.assign(last_address.size(), 0);
+}
+
+bool BinaryTraceWriter::close() {
+    if (!file) return true;
+
+    flushBlock();
+
+    // An empty block ends the block sequence (readers need it when the
+    // header could not be patched, e.g. when writing to a pipe)
+    BinaryTraceBlock terminator = {0, 0};
+    fwrite(&terminator, sizeof(terminator), 1, file);
+    position += sizeof(terminator);
+
+    BinaryTraceIndex trailer = {static_cast<uint32_t>(index.size()), 0};
+    uint64_t index_offset = position;
+    fwrite(&trailer, sizeof(trailer), 1, file);
+    if (!index.empty()) fwrite(&index[0], sizeof(BinaryTraceIndexEntry), index.size(), file);
+
+    // Patch record count and index location into the header when seekable
+    bool ok = !ferror(file);
+    if (fseek(file, static_cast<long>(offsetof(BinaryTraceHeader, record_count)), SEEK_SET) == 0) {
+        fwrite(&record_count, sizeof(record_count), 1, file);
+        fwrite(&index_offset, sizeof(index_offset), 1, file);
+    }
+
+    if (owns_file) {
+        ok = (fclose(file) == 0) && ok;
+    } else {
+        fflush(file);
+    }
+    file = nullptr;
+    return ok;
+}
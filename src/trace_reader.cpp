@@ -0,0 +1,671 @@
+#include "trace_reader.h"
+#include "trace_format.h"
+#include "config.h"
+#include "metrics.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <fcntl.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <io.h>
+#endif
+
+namespace {
+
+inline bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+}
+
+// Hex digit values, 0xFF for anything that isn't a hex digit
+struct HexTable {
+    uint8_t value[256];
+    HexTable() {
+        memset(value, 0xFF, sizeof(value));
+        for (int c = '0'; c <= '9'; ++c) value[c] = static_cast<uint8_t>(c - '0');
+        for (int c = 'a'; c <= 'f'; ++c) value[c] = static_cast<uint8_t>(c - 'a' + 10);
+        for (int c = 'A'; c <= 'F'; ++c) value[c] = static_cast<uint8_t>(c - 'A' + 10);
+    }
+};
+const HexTable hex_table;
+
+// Value of a hex digit, or -1
+inline int hexValue(char c) {
+    uint8_t v = hex_table.value[static_cast<unsigned char>(c)];
+    return v == 0xFF ? -1 : v;
+}
+
+// Same leniency as stoul(s, nullptr, 16): leading whitespace, optional
+// 0x prefix, then as many hex digits as are present (at least one); 64-bit
+bool scanHex(const char* p, const char* end, uint64_t& value) {
+    while (p < end && isSpace(*p)) ++p;
+    if (p < end && *p == '+') ++p;
+    if (end - p >= 3 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X') && hexValue(p[2]) >= 0) {
+        p += 2;
+    }
+
+    const char* digits = p;
+    uint64_t result = 0;
+    int v;
+    while (p < end && (v = hexValue(*p)) >= 0) {
+        result = (result << 4) | static_cast<uint64_t>(v);
+        ++p;
+    }
+    value = result;
+    return p != digits;
+}
+
+// Same leniency as stoi: leading whitespace, optional sign, decimal digits
+bool scanDecimal(const char* p, const char* end, uint32_t& value) {
+    while (p < end && isSpace(*p)) ++p;
+    bool negative = false;
+    if (p < end && (*p == '+' || *p == '-')) {
+        negative = (*p == '-');
+        ++p;
+    }
+
+    const char* digits = p;
+    uint32_t result = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        result = result * 10 + static_cast<uint32_t>(*p - '0');
+        ++p;
+    }
+    value = negative ? 0u - result : result;
+    return p != digits;
+}
+
+// True if the two-character unit appears anywhere in [p, end)
+inline bool containsUnit(const char* p, const char* end, char first, char second) {
+    for (; p + 1 < end; ++p) {
+        if (p[0] == first && p[1] == second) return true;
+    }
+    return false;
+}
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define TRACE_READER_SWAR 1
+
+const uint64_t SWAR_ONES = 0x0101010101010101ULL;
+const uint64_t SWAR_HIGH = 0x8080808080808080ULL;
+
+// Per byte (high bit clear): 0x80 where byte >= k
+inline uint64_t bytesAtLeast(uint64_t x, uint8_t k) {
+    return ((x | SWAR_HIGH) - SWAR_ONES * k) & SWAR_HIGH;
+}
+
+// Parses the hex digits terminated by ':' from 8 bytes at p (8 bytes must be
+// readable). Returns the digit count, or 0 if the field isn't 1-8 hex digits
+// followed by ':' within the word (p[8] == ':' is checked by the caller).
+inline uint32_t swarHex(const char* p, uint32_t& value) {
+    uint64_t word;
+    memcpy(&word, p, sizeof(word));
+
+    // Position of the first ':' byte (exact for the lowest match)
+    uint64_t x = word ^ (SWAR_ONES * ':');
+    uint64_t colon = (x - SWAR_ONES) & ~x & SWAR_HIGH;
+    uint32_t n = colon ? static_cast<uint32_t>(__builtin_ctzll(colon)) / 8 : 8;
+    if (n == 0) return 0;
+    uint64_t keep = n == 8 ? ~0ULL : (1ULL << (n * 8)) - 1;
+
+    // Every kept byte must be 0-9, a-f or A-F
+    uint64_t lower = word | (SWAR_ONES * 0x20);
+    uint64_t digit = bytesAtLeast(word, '0') & ~bytesAtLeast(word, '9' + 1);
+    uint64_t alpha = bytesAtLeast(lower, 'a') & ~bytesAtLeast(lower, 'f' + 1);
+    uint64_t valid = (digit | alpha) & ~word & SWAR_HIGH;
+    if ((valid & keep) != (SWAR_HIGH & keep)) return 0;
+
+    // ASCII -> nibble, then gather nibbles with the first digit most significant
+    uint64_t v = ((word & (SWAR_ONES * 0x0F)) + ((word >> 6) & SWAR_ONES) * 9) & keep;
+    v = __builtin_bswap64(v) >> ((8 - n) * 8);
+    v = (v & 0x000F000F000F000FULL) | ((v & 0x0F000F000F000F00ULL) >> 4);
+    v = (v & 0x000000FF000000FFULL) | ((v & 0x00FF000000FF0000ULL) >> 8);
+    v = (v & 0x000000000000FFFFULL) | ((v & 0x0000FFFF00000000ULL) >> 16);
+    value = static_cast<uint32_t>(v);
+    return n;
+}
+#endif
+
+// Fast path for the canonical form "T<id>: 0x<hex>: <n>KB|MB" followed by an
+// optional '\r' and a newline (or end of input). Scans the line exactly once
+// and returns the start of the next line, or nullptr if the line needs the
+// general parser (odd spacing, errors, extra fields, ...).
+const char* scanCanonical(const char* p, const char* end, TraceRecord& record) {
+    const char* begin = p;
+    while (p < end && *p != ':' && *p != '\n') ++p;
+    if (p == begin || p + 4 >= end || *p != ':') return nullptr;
+    record.task_id = begin;
+    record.task_id_length = static_cast<uint32_t>(p - begin);
+    record.kind = TRACE_ACCESS;
+
+    if (p[1] != ' ' || p[2] != '0' || (p[3] != 'x' && p[3] != 'X')) return nullptr;
+    p += 4;
+    const char* digits = p;
+    uint64_t address = 0;
+#ifdef TRACE_READER_SWAR
+    uint32_t n, low;
+    if (end - p >= 9 && (n = swarHex(p, low)) > 0 && p[n] == ':') {
+        address = low;
+        p += n;
+    } else
+#endif
+    {
+        // Addresses longer than 8 digits (64-bit traces) take this loop
+        int v;
+        while (p < end && (v = hexValue(*p)) >= 0) {
+            address = (address << 4) | static_cast<uint64_t>(v);
+            ++p;
+        }
+    }
+    if (p == digits || end - p < 5 || p[0] != ':' || p[1] != ' ') return nullptr;
+    p += 2;
+
+    digits = p;
+    uint32_t number = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        number = number * 10 + static_cast<uint32_t>(*p - '0');
+        ++p;
+    }
+    if (p == digits || end - p < 2 || p[1] != 'B') return nullptr;
+    uint32_t multiplier;
+    if (p[0] == 'K') {
+        multiplier = 1024;
+    } else if (p[0] == 'M') {
+        multiplier = 1024 * 1024;
+    } else {
+        return nullptr;
+    }
+    p += 2;
+    if (p < end && *p == '\r') ++p;
+    if (p < end && *p != '\n') return nullptr;
+
+    record.logical_address = address;
+    record.size_in_bytes = number * multiplier;
+    return p < end ? p + 1 : end;
+}
+
+// FNV-1a
+inline uint32_t hashTaskId(const char* name, uint32_t length) {
+    uint32_t hash = 2166136261u;
+    for (uint32_t i = 0; i < length; ++i) {
+        hash = (hash ^ static_cast<unsigned char>(name[i])) * 16777619u;
+    }
+    return hash;
+}
+
+void reportMalformed(const char* begin, const char* end) {
+    std::cerr << "Malformed line: ";
+    std::cerr.write(begin, end - begin);
+    std::cerr << std::endl;
+}
+
+// "fork <parent>" after the task ID's colon; false if the field is not a fork
+bool scanFork(const char* p, const char* end, TraceRecord& record) {
+    while (p < end && isSpace(*p)) ++p;
+    if (end - p < 6 || memcmp(p, "fork", 4) != 0 || !isSpace(p[4])) return false;
+    p += 5;
+    while (p < end && isSpace(*p)) ++p;
+    while (end > p && isSpace(end[-1])) --end;
+    if (p == end || memchr(p, ':', end - p) != nullptr) return false;
+
+    record.kind = TRACE_FORK;
+    record.parent_id = p;
+    record.parent_id_length = static_cast<uint32_t>(end - p);
+    record.logical_address = 0;
+    record.size_in_bytes = 0;
+    return true;
+}
+
+} // namespace
+
+TraceParseResult parseTraceLine(const char* begin, const char* end, TraceRecord& record,
+                                bool report) {
+    if (begin == end) return TRACE_LINE_EMPTY;
+
+    // Split line by ':' (format: T1: 0x4000: 16KB); the size field keeps
+    // anything after a further ':'
+    const char* colon1 = static_cast<const char*>(memchr(begin, ':', end - begin));
+    if (colon1 != nullptr && colon1 != begin && scanFork(colon1 + 1, end, record)) {
+        record.task_id = begin;
+        record.task_id_length = static_cast<uint32_t>(colon1 - begin);
+        return TRACE_LINE_OK;
+    }
+    const char* colon2 = colon1 ? static_cast<const char*>(memchr(colon1 + 1, ':', end - colon1 - 1)) : nullptr;
+    if (colon1 == nullptr || colon2 == nullptr || colon1 == begin ||
+        colon2 == colon1 + 1 || colon2 + 1 == end) {
+        if (report) reportMalformed(begin, end);
+        return TRACE_LINE_MALFORMED;
+    }
+
+    record.task_id = begin;
+    record.task_id_length = static_cast<uint32_t>(colon1 - begin);
+    record.kind = TRACE_ACCESS;
+    if (!scanHex(colon1 + 1, colon2, record.logical_address)) {
+        if (report) reportMalformed(begin, end);
+        return TRACE_LINE_MALFORMED;
+    }
+
+    // Parses size string like "16KB" or "4MB" into bytes
+    const char* size_begin = colon2 + 1;
+    uint32_t multiplier;
+    if (containsUnit(size_begin, end, 'K', 'B')) {
+        multiplier = 1024;
+    } else if (containsUnit(size_begin, end, 'M', 'B')) {
+        multiplier = 1024 * 1024;
+    } else {
+        if (report) {
+            std::cerr << "Unknown size format: ";
+            std::cerr.write(size_begin, end - size_begin);
+            std::cerr << std::endl;
+        }
+        record.size_in_bytes = 0;
+        return TRACE_LINE_UNKNOWN_SIZE;
+    }
+
+    uint32_t number;
+    if (!scanDecimal(size_begin, end, number)) {
+        if (report) reportMalformed(begin, end);
+        return TRACE_LINE_MALFORMED;
+    }
+    record.size_in_bytes = number * multiplier;
+    return TRACE_LINE_OK;
+}
+
+TraceReader::TraceReader()
+    : data(nullptr), size(0), cursor(nullptr), mapped(false), report_errors(true), streaming(false),
+      stream_end(false), stream_fd(-1), owns_fd(false), window(nullptr), window_capacity(0), buffered(0),
+      last_task(0), binary(false), records_begin(nullptr), binary_version(0), block_remaining(0) {}
+
+TraceReader::~TraceReader() {
+    close();
+}
+
+bool TraceReader::open(const std::string& filename) {
+    close();
+    bool from_stdin = filename == "-";
+
+#ifndef _WIN32
+    int fd = from_stdin ? STDIN_FILENO : ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Error opening file: " << filename << std::endl;
+        return false;
+    }
+
+    struct stat st;
+    bool regular = fstat(fd, &st) == 0 && S_ISREG(st.st_mode);
+    if (regular && st.st_size > 0) {
+        void* map = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            madvise(map, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+            data = static_cast<const char*>(map);
+            size = static_cast<size_t>(st.st_size);
+            cursor = data;
+            mapped = true;
+        }
+    }
+    if (!regular || (from_stdin && !mapped)) {
+        // Pipes, terminals and special files
+        openStream(fd, !from_stdin);
+        return openBinary(filename);
+    }
+    if (!from_stdin) ::close(fd);
+    if (mapped) return openBinary(filename);
+    // Empty files and files that can't be mapped are read instead
+#else
+    if (from_stdin) {
+        _setmode(_fileno(stdin), _O_BINARY);
+        openStream(_fileno(stdin), false);
+        return openBinary(filename);
+    }
+#endif
+
+    // Fallback: read the whole file into memory
+    std::ifstream infile(filename, std::ios::binary);
+    if (!infile) {
+        std::cerr << "Error opening file: " << filename << std::endl;
+        return false;
+    }
+    std::string contents((std::istreambuf_iterator<char>(infile)), std::istreambuf_iterator<char>());
+    size = contents.size();
+    char* buffer = new char[size > 0 ? size : 1];
+    memcpy(buffer, contents.data(), size);
+    data = buffer;
+    cursor = data;
+    return openBinary(filename);
+}
+
+// Reads the input through a window from now on
+void TraceReader::openStream(int fd, bool owns) {
+    streaming = true;
+    stream_end = false;
+    stream_fd = fd;
+    owns_fd = owns;
+    window_capacity = TRACE_STREAM_BUFFER;
+    window = new char[window_capacity];
+    buffered = 0;
+    data = window;
+    cursor = data;
+    size = 0;
+}
+
+// Reads what the input has ready into the free end of the window; 0 at the
+// end of the input (or on a read error, which is reported)
+size_t TraceReader::readInput() {
+    while (!stream_end) {
+#ifndef _WIN32
+        ssize_t n = ::read(stream_fd, window + buffered, window_capacity - buffered);
+#else
+        int n = _read(stream_fd, window + buffered, static_cast<unsigned>(window_capacity - buffered));
+#endif
+        if (n > 0) {
+            buffered += static_cast<size_t>(n);
+            return static_cast<size_t>(n);
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) std::cerr << "Error reading trace input: " << strerror(errno) << std::endl;
+        stream_end = true;
+    }
+    return 0;
+}
+
+// Moves the unread bytes to the front of the window, first growing it to
+// `capacity` bytes if it is smaller
+void TraceReader::compactWindow(size_t capacity) {
+    size_t unread = buffered - static_cast<size_t>(cursor - data);
+    if (capacity > window_capacity) {
+        char* larger = new char[capacity];
+        memcpy(larger, cursor, unread);
+        delete[] window;
+        window = larger;
+        window_capacity = capacity;
+    } else {
+        memmove(window, cursor, unread);
+    }
+    data = window;
+    cursor = window;
+    buffered = unread;
+    size = unread;
+}
+
+// Binary streams: makes the next `bytes` bytes readable at the cursor;
+// false if the input ends first
+bool TraceReader::fillWindow(size_t bytes) {
+    if (buffered - static_cast<size_t>(cursor - data) < bytes) {
+        compactWindow(std::max(window_capacity, bytes));
+        while (buffered < bytes && readInput() > 0) {
+        }
+    }
+    size = buffered;
+    return buffered - static_cast<size_t>(cursor - data) >= bytes;
+}
+
+// Text streams: keeps the unparsed end of the window (part of a line) and
+// reads until there is a complete line; size then ends after the last
+// newline, or at the end of the input. False once everything is parsed.
+bool TraceReader::refillLines() {
+    compactWindow(window_capacity);
+    size_t scanned = buffered;   // no newline before this
+    for (;;) {
+        if (buffered == window_capacity) compactWindow(window_capacity * 2);   // a very long line
+        if (readInput() == 0) {
+            size = buffered;
+            return size > 0;
+        }
+        for (size_t i = buffered; i > scanned; --i) {
+            if (data[i - 1] == '\n') {
+                size = i;
+                return true;
+            }
+        }
+        scanned = buffered;
+    }
+}
+
+// Detects a binary trace and loads its task table; text traces pass through
+bool TraceReader::openBinary(const std::string& filename) {
+    if (streaming) fillWindow(sizeof(BinaryTraceHeader));
+    records_begin = data;
+    if (!isBinaryTrace(data, size)) {
+        if (streaming) size = 0;   // text is parsed as complete lines arrive
+        return true;
+    }
+
+    BinaryTraceHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (streaming && header.version >= 1 && header.version <= BINARY_TRACE_VERSION) {
+        fillWindow(sizeof(header) + static_cast<size_t>(header.string_table_bytes));
+    }
+    if (header.version < 1 || header.version > BINARY_TRACE_VERSION ||
+        header.string_table_bytes > size - sizeof(header)) {
+        std::cerr << "Unsupported or corrupt binary trace: " << filename << std::endl;
+        close();
+        return false;
+    }
+
+    const char* p = data + sizeof(header);
+    const char* strings_end = p + header.string_table_bytes;
+    binary_tasks.resize(header.task_count);
+    for (uint32_t i = 0; i < header.task_count; ++i) {
+        if (strings_end - p < 2) {
+            std::cerr << "Corrupt task table in binary trace: " << filename << std::endl;
+            close();
+            return false;
+        }
+        uint32_t length = static_cast<uint8_t>(p[0]) | (static_cast<uint8_t>(p[1]) << 8);
+        p += 2;
+        if (static_cast<uint32_t>(strings_end - p) < length) length = static_cast<uint32_t>(strings_end - p);
+        binary_tasks[i] = internTask(p, length);
+        p += length;
+    }
+
+    binary = true;
+    binary_version = header.version;
+    records_begin = strings_end;
+    rewind();
+    return true;
+}
+
+void TraceReader::close() {
+    if (owns_fd) {
+#ifndef _WIN32
+        ::close(stream_fd);
+#else
+        _close(stream_fd);
+#endif
+    }
+    if (data) {
+#ifndef _WIN32
+        if (mapped) {
+            munmap(const_cast<char*>(data), size);
+        } else
+#endif
+        {
+            delete[] data;
+        }
+    }
+    data = nullptr;
+    cursor = nullptr;
+    size = 0;
+    mapped = false;
+    streaming = false;
+    stream_end = false;
+    stream_fd = -1;
+    owns_fd = false;
+    window = nullptr;
+    window_capacity = 0;
+    buffered = 0;
+    name_copies.clear();
+    binary = false;
+    records_begin = nullptr;
+    binary_version = 0;
+    task_names.clear();
+    task_slots.clear();
+    last_task = 0;
+    binary_tasks.clear();
+    last_address.clear();
+    block_remaining = 0;
+}
+
+// Dense index of a task ID; new IDs get the next index
+uint32_t TraceReader::internTask(const char* name, uint32_t length) {
+    if (last_task < task_names.size()) {
+        const TaskName& last = task_names[last_task];
+        if (last.length == length && memcmp(last.name, name, length) == 0) return last_task;
+    }
+
+    uint32_t hash = hashTaskId(name, length);
+    size_t mask = task_slots.size() - 1;
+    size_t slot = hash & mask;
+    if (!task_slots.empty()) {
+        for (; task_slots[slot] != 0; slot = (slot + 1) & mask) {
+            const TaskName& entry = task_names[task_slots[slot] - 1];
+            if (entry.hash == hash && entry.length == length && memcmp(entry.name, name, length) == 0) {
+                last_task = task_slots[slot] - 1;
+                return last_task;
+            }
+        }
+    }
+
+    last_task = static_cast<uint32_t>(task_names.size());
+    if (streaming) {
+        name_copies.push_back(std::string(name, length));
+        name = name_copies.back().data();
+    }
+    TaskName entry = {name, length, hash};
+    task_names.push_back(entry);
+
+    if (task_names.size() * 2 > task_slots.size()) {
+        // Grow and reinsert everything (the new name included)
+        task_slots.assign(task_slots.empty() ? 64 : task_slots.size() * 2, 0);
+        mask = task_slots.size() - 1;
+        for (uint32_t i = 0; i < task_names.size(); ++i) {
+            for (slot = task_names[i].hash & mask; task_slots[slot] != 0; slot = (slot + 1) & mask) {}
+            task_slots[slot] = i + 1;
+        }
+    } else {
+        task_slots[slot] = last_task + 1;
+    }
+    return last_task;
+}
+
+void TraceReader::rewind() {
+    cursor = records_begin;
+    block_remaining = 0;
+    last_address.assign(binary_tasks.size(), 0);
+}
+
+bool TraceReader::nextBinary(TraceRecord& record) {
+    const uint8_t* end = reinterpret_cast<const uint8_t*>(data + size);
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(cursor);
+
+    while (block_remaining == 0) {
+        BinaryTraceBlock block;
+        if (streaming) {
+            // Whole blocks are buffered, so records never straddle a refill.
+            // A record is at most three 10-byte varints.
+            cursor = reinterpret_cast<const char*>(p);
+            if (fillWindow(sizeof(block))) {
+                memcpy(&block, cursor, sizeof(block));
+                if (block.payload_bytes <= static_cast<uint64_t>(block.record_count) * 30) {
+                    fillWindow(sizeof(block) + block.payload_bytes);
+                }
+            }
+            p = reinterpret_cast<const uint8_t*>(cursor);
+            end = reinterpret_cast<const uint8_t*>(data + size);
+        }
+        if (end - p < static_cast<ptrdiff_t>(sizeof(block))) return false;
+        memcpy(&block, p, sizeof(block));
+        if (block.record_count == 0) {
+            cursor = data + size;   // terminator block
+            return false;
+        }
+        p += sizeof(block);
+        block_remaining = block.record_count;
+        last_address.assign(binary_tasks.size(), 0);
+    }
+
+    // Version 2 flags fork records in bit 0 of the task index; the second
+    // field of a fork is the parent's task index
+    uint64_t task_index, field, size_kb = 0;
+    bool fork = false;
+    p = getVarint(p, end, task_index);
+    if (p && binary_version >= 2) {
+        fork = (task_index & 1) != 0;
+        task_index >>= 1;
+    }
+    if (!p || !(p = getVarint(p, end, field)) || (!fork && !(p = getVarint(p, end, size_kb))) ||
+        task_index >= binary_tasks.size() || (fork && field >= binary_tasks.size())) {
+        if (report_errors) std::cerr << "Corrupt record in binary trace" << std::endl;
+        cursor = data + size;
+        return false;
+    }
+
+    const TaskName& task = task_names[binary_tasks[task_index]];
+    record.task_id = task.name;
+    record.task_id_length = task.length;
+    record.task_index = binary_tasks[task_index];
+    if (fork) {
+        const TaskName& parent = task_names[binary_tasks[field]];
+        record.kind = TRACE_FORK;
+        record.parent_id = parent.name;
+        record.parent_id_length = parent.length;
+        record.parent_index = binary_tasks[field];
+        record.logical_address = 0;
+        record.size_in_bytes = 0;
+    } else {
+        uint64_t& previous = last_address[task_index];
+        previous = decodeAddressDelta(previous, field);
+        record.kind = TRACE_ACCESS;
+        record.logical_address = previous;
+        record.size_in_bytes = static_cast<uint32_t>(size_kb * 1024);
+    }
+
+    block_remaining--;
+    cursor = reinterpret_cast<const char*>(p);
+    return true;
+}
+
+bool TraceReader::next(TraceRecord& record) {
+    METRICS_TIME(METRIC_PARSE);
+    if (data == nullptr) return false;
+    if (binary) return nextBinary(record);
+
+    const char* end = data + size;
+    for (;;) {
+        while (cursor < end) {
+            const char* next_line = scanCanonical(cursor, end, record);
+            if (next_line != nullptr) {
+                cursor = next_line;
+                record.task_index = internTask(record.task_id, record.task_id_length);
+                if (streaming) record.task_id = task_names[record.task_index].name;
+                return true;
+            }
+
+            const char* line_end = static_cast<const char*>(memchr(cursor, '\n', end - cursor));
+            if (line_end == nullptr) line_end = end;
+
+            const char* line = cursor;
+            cursor = line_end < end ? line_end + 1 : end;
+
+            TraceParseResult result = parseTraceLine(line, line_end, record, report_errors);
+            if (result == TRACE_LINE_OK || result == TRACE_LINE_UNKNOWN_SIZE) {
+                record.task_index = internTask(record.task_id, record.task_id_length);
+                if (streaming) record.task_id = task_names[record.task_index].name;
+                if (record.kind == TRACE_FORK) {
+                    record.parent_index = internTask(record.parent_id, record.parent_id_length);
+                    if (streaming) record.parent_id = task_names[record.parent_index].name;
+                }
+                return true;
+            }
+        }
+        // The window only ever ends after a complete line
+        if (!streaming || !refillLines()) return false;
+        end = data + size;
+    }
+}
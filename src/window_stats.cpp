@@ -0,0 +1,80 @@
+#include "window_stats.h"
+#include "memory_manager.h"
+#include "swap.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+namespace {
+
+uint64_t nowNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+double percent(uint64_t part, uint64_t whole) {
+    return whole > 0 ? 100.0 * static_cast<double>(part) / static_cast<double>(whole) : 0.0;
+}
+
+} // namespace
+
+WindowStats::WindowStats()
+    : enabled(false), every_records(0), every_ns(0), window(1), first_record(0), start_ns(0), active_tasks(0) {
+    for (int c = 0; c < METRIC_COUNTER_COUNT; ++c) {
+        counters[c] = 0;
+    }
+}
+
+WindowStats& WindowStats::getInstance() {
+    static WindowStats instance;
+    return instance;
+}
+
+void WindowStats::start(uint64_t records, uint64_t window_records, double window_seconds) {
+    every_records = window_records;
+    every_ns = static_cast<uint64_t>(window_seconds * 1e9);
+    enabled = every_records != 0 || every_ns != 0;
+    first_record = records;
+    start_ns = nowNs();
+    Metrics::getInstance().sumCounters(counters);
+}
+
+void WindowStats::checkClock(uint64_t records) {
+    if (nowNs() - start_ns >= every_ns) close(records);
+}
+
+void WindowStats::close(uint64_t records) {
+    uint64_t now = nowNs();
+    uint64_t totals[METRIC_COUNTER_COUNT];
+    Metrics::getInstance().sumCounters(totals);
+    uint64_t accesses = totals[METRIC_ACCESSES] - counters[METRIC_ACCESSES];
+    uint64_t walks = totals[METRIC_PAGE_WALKS] - counters[METRIC_PAGE_WALKS];
+    uint64_t faults = totals[METRIC_PAGE_FAULTS] - counters[METRIC_PAGE_FAULTS];
+    MemoryManager& memory = MemoryManager::getInstance();
+
+    fprintf(stderr,
+            "Window %u (records %llu-%llu, %.2fs): TLB hit rate %.2f%%, fault rate %.2f%% (%llu of %llu pages), "
+            "frames %u/%u, active tasks %u",
+            window, static_cast<unsigned long long>(first_record + 1), static_cast<unsigned long long>(records),
+            (now - start_ns) / 1e9, percent(accesses - std::min(walks, accesses), accesses),
+            percent(faults, accesses), static_cast<unsigned long long>(faults),
+            static_cast<unsigned long long>(accesses), memory.getAllocatedPageCount(), memory.getTotalPageCount(),
+            active_tasks);
+    if (SwapDevice::getInstance().isEnabled()) {
+        fprintf(stderr, ", major faults %llu",
+                static_cast<unsigned long long>(totals[METRIC_MAJOR_FAULTS] - counters[METRIC_MAJOR_FAULTS]));
+    }
+    fprintf(stderr, "\n");
+
+    for (int c = 0; c < METRIC_COUNTER_COUNT; ++c) {
+        counters[c] = totals[c];
+    }
+    window++;
+    first_record = records;
+    start_ns = now;
+    active_tasks = 0;
+}
+
+void WindowStats::finish(uint64_t records) {
+    if (enabled && records > first_record) close(records);
+}
@@ -1,24 +1,24 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <cstdio>
 #include <cstdlib>
-#include <ctime>
+#include <cstring>
+#include <cmath>
 #include <vector>
-#include <iomanip>
-#include <sstream>
-#include <windows.h>
-#include "common/config.h"
+#include <thread>
+#include <algorithm>
+#include "config.h"
+#include "trace_format.h"
 #include <cstdint>
 #define SECTIONS 5 // text, data, heap, stack, shared_lib
 
-// Thread-safe random number generation
-CRITICAL_SECTION rand_cs;
-int thread_safe_rand() {
-    EnterCriticalSection(&rand_cs);
-    int result = rand();
-    LeaveCriticalSection(&rand_cs);
-    return result;
-}
+// Lines are dealt to the tasks round-robin in bursts of up to this many, so
+// the task and per-task index of any line follow from its position alone
+#define TASK_BURST 32
+
+// Lines generated per chunk (one unit of work for a thread)
+#define CHUNK_LINES (1u << 16)
 
 // Random section names
 enum SectionType { TEXT, DATA, HEAP, STACK, SHARED_LIB };
@@ -46,153 +46,432 @@ uint32_t sectionBase(SectionType s) {
     return 0;
 }
 
-// Align address to page boundary
-uint32_t getAlignedAddress(uint32_t base) {
-    uint32_t page_size = MIN_PAGE_SIZE_KB * 1024;
-    return base + (rand() % 1024) * page_size;
+// Access patterns
+enum Pattern {
+    PATTERN_RANDOM,      // random section, random page among the first 1024
+    PATTERN_SEQUENTIAL,  // scan through the working set page by page
+    PATTERN_STRIDED,     // walk an array 16 pages at a time
+    PATTERN_ZIPF,        // hot set: page ranks drawn with weight 1 / rank^0.99
+    PATTERN_STACK,       // reuse of recent pages at log-uniform stack distances
+    PATTERN_PHASED       // switches pattern and working set every phase
+};
+
+const char* patternName(Pattern p) {
+    switch (p) {
+        case PATTERN_RANDOM: return "random";
+        case PATTERN_SEQUENTIAL: return "sequential";
+        case PATTERN_STRIDED: return "strided";
+        case PATTERN_ZIPF: return "zipf";
+        case PATTERN_STACK: return "stack";
+        case PATTERN_PHASED: return "phased";
+    }
+    return "unknown";
 }
 
-// Generate a size string (randomly 4KB to 16KB)
-std::string randomSizeStr() {
-    int sizes[] = {4, 8, 16, 32}; // in KB
-    int s = sizes[rand() % 3];
-    return std::to_string(s) + "KB";
+bool parsePattern(const std::string& name, Pattern& p) {
+    for (int i = PATTERN_RANDOM; i <= PATTERN_PHASED; ++i) {
+        if (name == patternName(static_cast<Pattern>(i))) {
+            p = static_cast<Pattern>(i);
+            return true;
+        }
+    }
+    return false;
 }
 
-// Thread-safe file writing
-CRITICAL_SECTION file_cs;
+// splitmix64: every access seeds its own generator from (seed, task, index),
+// so any line can be generated on any thread and the output only depends
+// on the seed
+struct Random {
+    uint64_t state;
+
+    explicit Random(uint64_t seed) : state(seed) {}
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
 
-// Thread arguments structure
-struct ThreadArgs {
-    int task_id;
-    int num_lines;  // Changed from max_lines to num_lines
-    std::ofstream* file;
+    uint32_t below(uint32_t bound) { return static_cast<uint32_t>(next() % bound); }
+    double unit() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
 };
 
-// Thread function to generate trace lines for a single task
-DWORD WINAPI generateTaskTrace(LPVOID arg) {
-    ThreadArgs* args = static_cast<ThreadArgs*>(arg);
-    std::string task_id = "T" + std::to_string(args->task_id);
-
-    for (int i = 0; i < args->num_lines; ++i) {
-        SectionType section = static_cast<SectionType>(thread_safe_rand() % SECTIONS);
-        uint32_t addr = getAlignedAddress(sectionBase(section));
-        std::stringstream line;
-        line << task_id << ": 0x" << std::hex << addr << ": " << randomSizeStr();
-        
-        // Thread-safe file writing
-        EnterCriticalSection(&file_cs);
-        *args->file << line.str() << "\n";
-        LeaveCriticalSection(&file_cs);
+uint64_t mixSeed(uint64_t seed, uint64_t stream, uint64_t index) {
+    Random r(seed ^ (stream * 0xD1B54A32D192ED03ULL));
+    r.state ^= index * 0x8CB92BA72F3D8DD7ULL;
+    return r.next();
+}
+
+struct GeneratorConfig {
+    uint64_t total_lines;
+    uint32_t num_tasks;
+    uint64_t seed;
+    Pattern pattern;
+    uint32_t working_set;     // pages per task for the locality patterns
+    uint64_t phase_length;    // accesses per phase (phased pattern)
+    uint64_t burst;           // consecutive lines per task
+    std::vector<double> zipf_cdf;
+
+    GeneratorConfig()
+        : total_lines(1000000), num_tasks(10), seed(1), pattern(PATTERN_RANDOM),
+          working_set(4096), phase_length(100000), burst(TASK_BURST) {}
+};
+
+const uint32_t PAGE_BYTES = MIN_PAGE_SIZE_KB * 1024;
+const uint32_t SECTION_PAGES = 0x10000000u / PAGE_BYTES;   // pages between section bases
+
+// Generate a size in KB (randomly 4KB to 16KB)
+int randomSizeKB(Random& rng) {
+    int sizes[] = {4, 8, 16}; // in KB
+    return sizes[rng.below(3)];
+}
+
+// Page of a stack-distance stream: with probability 0.9 an access reuses
+// the page of an access 1..4096 steps back (log-uniform), else it touches a
+// fresh page. Following the chain back is cheap: each step is a coin flip.
+uint32_t stackPage(const GeneratorConfig& cfg, uint64_t stream, uint64_t index) {
+    for (;;) {
+        Random rng(mixSeed(~cfg.seed, stream, index));
+        if (index == 0 || rng.unit() >= 0.9) {
+            return rng.below(cfg.working_set);
+        }
+        uint64_t distance = static_cast<uint64_t>(std::exp(rng.unit() * std::log(4096.0))) + 1;
+        if (distance > index) {
+            return rng.below(cfg.working_set);
+        }
+        index -= distance;
     }
-    return 0;
 }
 
-// Distribute total lines randomly among tasks
-std::vector<int> distributeLines(int total_lines, int num_tasks) {
-    std::vector<int> distribution(num_tasks, 0);
-    
-    // First give at least 1 line to each task
-    for (int i = 0; i < num_tasks; i++) {
-        distribution[i] = 1;
+// Page within the working set for one access of a locality pattern
+uint32_t patternPage(const GeneratorConfig& cfg, Pattern pattern, uint64_t stream,
+                     uint64_t index, Random& rng) {
+    switch (pattern) {
+        case PATTERN_SEQUENTIAL:
+            return static_cast<uint32_t>(index % cfg.working_set);
+        case PATTERN_STRIDED: {
+            // One pass per starting column, 16 pages apart
+            uint64_t rows = (cfg.working_set + 15) / 16;
+            uint64_t step = index % (rows * 16);
+            return static_cast<uint32_t>(((step % rows) * 16 + step / rows) % cfg.working_set);
+        }
+        case PATTERN_ZIPF: {
+            double u = rng.unit() * cfg.zipf_cdf.back();
+            size_t rank = std::lower_bound(cfg.zipf_cdf.begin(), cfg.zipf_cdf.end(), u) -
+                          cfg.zipf_cdf.begin();
+            // Scatter the ranks so hot pages are not all neighbours
+            return static_cast<uint32_t>((rank * 2654435761u + stream) % cfg.working_set);
+        }
+        case PATTERN_STACK:
+            return stackPage(cfg, stream, index);
+        default:
+            return rng.below(cfg.working_set);
     }
-    
-    // Distribute remaining lines randomly
-    int remaining_lines = total_lines - num_tasks;
-    while (remaining_lines > 0) {
-        int task_idx = thread_safe_rand() % num_tasks;
-        distribution[task_idx]++;
-        remaining_lines--;
+}
+
+SectionType patternSection(Pattern pattern) {
+    switch (pattern) {
+        case PATTERN_SEQUENTIAL: return TEXT;
+        case PATTERN_STRIDED: return DATA;
+        case PATTERN_ZIPF: return HEAP;
+        case PATTERN_STACK: return STACK;
+        default: return SHARED_LIB;
     }
-    
-    return distribution;
 }
 
-void generateTraceFile(int num_tasks, int total_lines, const std::string& filename) {
-    std::ofstream file(filename);
-    if (!file) {
-        std::cerr << "Could not open file for writing.\n";
+// Address and size of the index-th access of task `task`
+void generateAccess(const GeneratorConfig& cfg, uint32_t task, uint64_t index,
+                    uint32_t& addr, int& size_kb) {
+    Random rng(mixSeed(cfg.seed, task, index));
+    size_kb = randomSizeKB(rng);
+
+    if (cfg.pattern == PATTERN_RANDOM) {
+        SectionType section = static_cast<SectionType>(rng.below(SECTIONS));
+        addr = sectionBase(section) + rng.below(1024) * PAGE_BYTES;
         return;
     }
 
-    // Initialize critical sections
-    InitializeCriticalSection(&rand_cs);
-    InitializeCriticalSection(&file_cs);
-
-    srand(static_cast<unsigned int>(time(nullptr)));
-
-    // Distribute lines among tasks
-    std::vector<int> line_distribution = distributeLines(total_lines, num_tasks);
-
-    // Create thread array
-    HANDLE* threads = new HANDLE[num_tasks];
-    ThreadArgs* thread_args = new ThreadArgs[num_tasks];
-
-    // Create threads
-    for (int t = 0; t < num_tasks; ++t) {
-        thread_args[t].task_id = t + 1;
-        thread_args[t].num_lines = line_distribution[t];
-        thread_args[t].file = &file;
-        
-        threads[t] = CreateThread(
-            NULL,                   // default security attributes
-            0,                      // use default stack size
-            generateTaskTrace,      // thread function name
-            &thread_args[t],        // argument to thread function
-            0,                      // use default creation flags
-            NULL                    // returns the thread identifier
-        );
-
-        if (threads[t] == NULL) {
-            std::cerr << "Failed to create thread " << t << std::endl;
+    Pattern pattern = cfg.pattern;
+    uint64_t stream = task;
+    uint32_t offset = 0;   // first page of the working set within the section
+    if (pattern == PATTERN_PHASED) {
+        // Each phase picks its own pattern and working set
+        uint64_t phase = index / cfg.phase_length;
+        Random phase_rng(mixSeed(cfg.seed ^ 0x5048415345ULL, task, phase));
+        pattern = static_cast<Pattern>(PATTERN_SEQUENTIAL + phase_rng.below(4));
+        stream = mixSeed(cfg.seed, task, phase) | 1;
+        index -= phase * cfg.phase_length;
+        offset = phase_rng.below(SECTION_PAGES / cfg.working_set) * cfg.working_set;
+    }
+
+    uint32_t page = patternPage(cfg, pattern, stream, index, rng);
+    addr = sectionBase(patternSection(pattern)) + (offset + page) * PAGE_BYTES;
+}
+
+// Task and per-task access index of a trace line
+void lineOwner(const GeneratorConfig& cfg, uint64_t line, uint32_t& task, uint64_t& index) {
+    uint64_t burst = line / cfg.burst;
+    task = static_cast<uint32_t>(burst % cfg.num_tasks);
+    index = (burst / cfg.num_tasks) * cfg.burst + line % cfg.burst;
+}
+
+// Lines of one task (closed form of the burst schedule)
+uint64_t linesForTask(const GeneratorConfig& cfg, uint32_t task) {
+    uint64_t round = cfg.burst * cfg.num_tasks;
+    uint64_t rest = cfg.total_lines % round;
+    uint64_t start = task * cfg.burst;
+    uint64_t partial = rest > start ? std::min(rest - start, cfg.burst) : 0;
+    return (cfg.total_lines / round) * cfg.burst + partial;
+}
+
+// One chunk of output, generated by one thread into its own buffer
+struct Chunk {
+    uint64_t first_line;
+    uint64_t lines;
+    std::vector<char> text;
+    struct Record {
+        uint32_t task;
+        uint32_t addr;
+        uint32_t size_kb;
+    };
+    std::vector<Record> records;   // binary output
+};
+
+char* appendDecimal(char* out, uint32_t value) {
+    char digits[10];
+    int n = 0;
+    do {
+        digits[n++] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value);
+    while (n) *out++ = digits[--n];
+    return out;
+}
+
+char* appendHex(char* out, uint32_t value) {
+    static const char hex[] = "0123456789abcdef";
+    int shift = 28;
+    while (shift > 0 && (value >> shift) == 0) shift -= 4;
+    for (; shift >= 0; shift -= 4) *out++ = hex[(value >> shift) & 0xF];
+    return out;
+}
+
+void generateChunk(const GeneratorConfig& cfg, Chunk& chunk, bool binary) {
+    chunk.text.resize(binary ? 0 : chunk.lines * 32);
+    chunk.records.resize(binary ? chunk.lines : 0);
+    char* out = chunk.text.data();
+
+    for (uint64_t k = 0; k < chunk.lines; ++k) {
+        uint32_t task;
+        uint64_t index;
+        lineOwner(cfg, chunk.first_line + k, task, index);
+
+        uint32_t addr;
+        int size_kb;
+        generateAccess(cfg, task, index, addr, size_kb);
+
+        if (binary) {
+            // Task T<n> is entry n-1 in the binary trace's task table
+            Chunk::Record record = {task, addr, static_cast<uint32_t>(size_kb)};
+            chunk.records[k] = record;
             continue;
         }
+
+        // "T<id>: 0x<hex>: <n>KB\n" (at most 31 bytes)
+        *out++ = 'T';
+        out = appendDecimal(out, task + 1);
+        memcpy(out, ": 0x", 4);
+        out = appendHex(out + 4, addr);
+        *out++ = ':';
+        *out++ = ' ';
+        out = appendDecimal(out, static_cast<uint32_t>(size_kb));
+        memcpy(out, "KB\n", 3);
+        out += 3;
     }
+    chunk.text.resize(out - chunk.text.data());
+}
 
-    // Wait for all threads to complete
-    WaitForMultipleObjects(num_tasks, threads, TRUE, INFINITE);
+// Generates rounds of `threads` chunks in parallel; while one round is
+// being written out in order, the next one is already being generated
+bool generateTraceFile(const GeneratorConfig& cfg, unsigned threads, const std::string& filename, bool binary) {
+    FILE* file = nullptr;
+    BinaryTraceWriter writer;
+    if (binary) {
+        std::vector<std::string> task_ids;
+        for (uint32_t t = 0; t < cfg.num_tasks; ++t) {
+            task_ids.push_back("T" + std::to_string(t + 1));
+        }
+        if (!writer.open(filename, task_ids)) {
+            return false;
+        }
+    } else {
+        file = filename == "-" ? stdout : fopen(filename.c_str(), "wb");
+        if (!file) {
+            std::cerr << "Could not open file for writing.\n";
+            return false;
+        }
+    }
+
+    std::vector<Chunk> current(threads), next(threads);
+    std::vector<std::thread> workers;
+    uint64_t next_line = 0;
 
-    // Cleanup
-    for (int t = 0; t < num_tasks; ++t) {
-        CloseHandle(threads[t]);
+    auto launch = [&](std::vector<Chunk>& round) {
+        workers.clear();
+        for (unsigned t = 0; t < threads; ++t) {
+            round[t].first_line = next_line;
+            round[t].lines = std::min<uint64_t>(CHUNK_LINES, cfg.total_lines - next_line);
+            next_line += round[t].lines;
+            if (round[t].lines > 0) {
+                workers.push_back(std::thread(generateChunk, std::cref(cfg), std::ref(round[t]), binary));
+            }
+        }
+    };
+    auto join = [&]() {
+        for (size_t i = 0; i < workers.size(); ++i) workers[i].join();
+    };
+
+    launch(current);
+    join();
+    while (current[0].lines > 0) {
+        launch(next);
+        for (unsigned t = 0; t < threads && current[t].lines > 0; ++t) {
+            if (binary) {
+                for (size_t k = 0; k < current[t].records.size(); ++k) {
+                    const Chunk::Record& r = current[t].records[k];
+                    writer.append(r.task, r.addr, r.size_kb * 1024);
+                }
+            } else {
+                fwrite(current[t].text.data(), 1, current[t].text.size(), file);
+            }
+        }
+        join();
+        current.swap(next);
     }
-    delete[] threads;
-    delete[] thread_args;
 
-    // Cleanup critical sections
-    DeleteCriticalSection(&rand_cs);
-    DeleteCriticalSection(&file_cs);
+    bool ok;
+    if (binary) {
+        ok = writer.close();
+    } else {
+        ok = !ferror(file);
+        ok = (file == stdout ? fflush(file) == 0 : fclose(file) == 0) && ok;
+    }
+    if (!ok) {
+        std::cerr << "Error writing " << filename << "\n";
+        return false;
+    }
 
-    file.close();
-    std::cout << "Trace file generated: " << filename << "\n";
-    std::cout << "Total lines: " << total_lines << "\n";
-    std::cout << "Number of tasks: " << num_tasks << "\n";
-    std::cout << "Line distribution per task:\n";
-    for (int t = 0; t < num_tasks; ++t) {
-        std::cout << "Task " << (t + 1) << ": " << line_distribution[t] << " lines\n";
+    // Keep the report out of a trace written to stdout
+    std::ostream& report = filename == "-" ? std::cerr : std::cout;
+    report << "Trace file generated: " << filename << "\n";
+    report << "Total lines: " << cfg.total_lines << "\n";
+    report << "Number of tasks: " << cfg.num_tasks << "\n";
+    report << "Pattern: " << patternName(cfg.pattern) << ", seed " << cfg.seed << "\n";
+    report << "Line distribution per task:\n";
+    for (uint32_t t = 0; t < cfg.num_tasks; ++t) {
+        report << "Task " << (t + 1) << ": " << linesForTask(cfg, t) << " lines\n";
     }
+    return true;
+}
+
+void usage(const char* program) {
+    std::cerr << "Usage: " << program << " [total_lines] [num_tasks] [options]\n"
+              << "  --binary            write trace.bin in the binary format\n"
+              << "  --output FILE       output file, - for stdout (default trace.txt / trace.bin)\n"
+              << "  --seed N            random seed; equal seeds give equal traces (default 1)\n"
+              << "  --threads N         generator threads (default: hardware threads)\n"
+              << "  --pattern P         random (default), sequential, strided, zipf, stack or phased\n"
+              << "  --working-set N     pages per task for the locality patterns, 16-32768 (default 4096)\n"
+              << "  --phase-length N    accesses per phase for --pattern phased (default 100000)\n";
+}
+
+bool parseNumber(const char* text, uint64_t& value) {
+    char* end;
+    value = strtoull(text, &end, 10);
+    return *text != '\0' && *end == '\0';
 }
 
 int main(int argc, char* argv[]) {
-    int total_lines = 1000000;  // Default: 1 million lines
-    int num_tasks = 10;         // Default: 10 tasks
-
-    if (argc == 3) {
-        total_lines = std::stoi(argv[1]);
-        num_tasks = std::stoi(argv[2]);
-    } else if (argc != 1) {
-        std::cerr << "Usage: " << argv[0] << " [total_lines] [num_tasks]\n";
-        std::cerr << "Using default values: " << total_lines << " lines, " << num_tasks << " tasks\n";
+    GeneratorConfig cfg;
+    bool binary = false;        // --binary: write trace.bin in the binary format
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    std::string output;
+    std::vector<uint64_t> positional;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        uint64_t value;
+        if (arg == "--binary") {
+            binary = true;
+            continue;
+        }
+        if (arg.compare(0, 2, "--") != 0) {
+            if (!parseNumber(argv[i], value) || positional.size() == 2) {
+                usage(argv[0]);
+                return 1;
+            }
+            positional.push_back(value);
+            continue;
+        }
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return 1;
+        }
+        const char* text = argv[++i];
+        if (arg == "--output") {
+            output = text;
+        } else if (arg == "--pattern") {
+            if (!parsePattern(text, cfg.pattern)) {
+                std::cerr << "Unknown pattern: " << text << "\n";
+                return 1;
+            }
+        } else if (arg == "--seed" && parseNumber(text, value)) {
+            cfg.seed = value;
+        } else if (arg == "--threads" && parseNumber(text, value) && value >= 1 && value <= 256) {
+            threads = static_cast<unsigned>(value);
+        } else if (arg == "--working-set" && parseNumber(text, value) && value >= 16 && value <= SECTION_PAGES) {
+            cfg.working_set = static_cast<uint32_t>(value);
+        } else if (arg == "--phase-length" && parseNumber(text, value) && value >= 1) {
+            cfg.phase_length = value;
+        } else {
+            std::cerr << "Invalid option or value: " << arg << " " << text << "\n";
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (positional.size() == 1) {
+        usage(argv[0]);
         return 1;
     }
+    if (positional.size() == 2) {
+        cfg.total_lines = positional[0];
+        if (positional[1] == 0 || positional[1] > 100000) {
+            std::cerr << "Error: Number of tasks must be between 1 and 100000\n";
+            return 1;
+        }
+        cfg.num_tasks = static_cast<uint32_t>(positional[1]);
+    }
 
-    if (total_lines < num_tasks) {
+    if (cfg.total_lines < cfg.num_tasks) {
         std::cerr << "Error: Total lines must be greater than or equal to number of tasks\n";
         return 1;
     }
 
-    std::cout << "Generating trace file with " << total_lines << " lines across " << num_tasks << " tasks...\n";
-    generateTraceFile(num_tasks, total_lines, "trace.txt");
-    return 0;
-}
+    // Short bursts when there are few lines per task, so every task gets one
+    cfg.burst = std::min<uint64_t>(TASK_BURST, cfg.total_lines / cfg.num_tasks);
 
+    if (cfg.pattern == PATTERN_ZIPF || cfg.pattern == PATTERN_PHASED) {
+        cfg.zipf_cdf.resize(cfg.working_set);
+        double sum = 0;
+        for (uint32_t r = 0; r < cfg.working_set; ++r) {
+            sum += 1.0 / std::pow(r + 1.0, 0.99);
+            cfg.zipf_cdf[r] = sum;
+        }
+    }
+
+    if (output.empty()) output = binary ? "trace.bin" : "trace.txt";
+    (output == "-" ? std::cerr : std::cout) << "Generating trace file with " << cfg.total_lines << " lines across " << cfg.num_tasks << " tasks...\n";
+    return generateTraceFile(cfg, threads, output, binary) ? 0 : 1;
+}
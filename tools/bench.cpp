@@ -0,0 +1,465 @@
+// Microbenchmarks for the translation hot paths
+//
+// Every case replays a synthetic page stream (sequential, strided, uniform
+// random or Zipfian) that is generated up front, so only the code under
+// test is timed. Results go to stdout as a table and, with --json, to a
+// machine-readable file for comparing builds.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+#include "config.h"
+#include "memory_manager.h"
+#include "page_size.h"
+#include "page_table_layouts.h"
+#include "tlb.h"
+#include "trace_reader.h"
+#include "translation_engine.h"
+
+using namespace std;
+
+// Heap allocations made by the code under test (the bench is single-threaded)
+static uint64_t heap_allocations = 0;
+
+void* operator new(size_t size) {
+    heap_allocations++;
+    void* p = malloc(size ? size : 1);
+    if (p == nullptr) throw bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+enum WorkloadKind {
+    WORKLOAD_SEQUENTIAL,
+    WORKLOAD_STRIDED,
+    WORKLOAD_UNIFORM,
+    WORKLOAD_ZIPF
+};
+
+static const char* workloadName(WorkloadKind kind) {
+    switch (kind) {
+        case WORKLOAD_SEQUENTIAL: return "sequential";
+        case WORKLOAD_STRIDED:    return "strided";
+        case WORKLOAD_UNIFORM:    return "uniform";
+        case WORKLOAD_ZIPF:       return "zipf";
+    }
+    return "unknown";
+}
+
+struct BenchOptions {
+    uint32_t ops;             // accesses per case
+    uint32_t working_set;     // pages per task
+    vector<uint32_t> tasks;   // task counts to run the task benchmarks with
+    uint64_t seed;
+    double zipf_skew;
+    string json_file;         // empty = table only
+
+    BenchOptions() : ops(1000000), working_set(2048), seed(1), zipf_skew(0.99) {
+        tasks.push_back(1);
+        tasks.push_back(4);
+        tasks.push_back(16);
+    }
+};
+
+struct BenchResult {
+    string name;
+    string workload;
+    uint32_t tasks;
+    uint64_t ops;
+    double seconds;
+    uint64_t frames;          // frames allocated (net) during the case
+    uint64_t heap;            // heap allocations during the case
+    double hit_rate;          // TLB hit rate in percent, < 0 if not measured
+};
+
+// splitmix64: small, fast and identical on every platform
+class Random {
+private:
+    uint64_t state;
+
+public:
+    explicit Random(uint64_t seed) : state(seed) {}
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    uint32_t below(uint32_t bound) {
+        return static_cast<uint32_t>(next() % bound);
+    }
+
+    double unit() {
+        return (next() >> 11) * (1.0 / 9007199254740992.0);
+    }
+};
+
+// Page numbers in [0, pages) following the workload's locality pattern
+static vector<uint32_t> makePageStream(WorkloadKind kind, uint32_t pages, uint32_t count,
+                                       uint64_t seed, double skew) {
+    vector<uint32_t> stream(count);
+    Random random(seed);
+
+    switch (kind) {
+        case WORKLOAD_SEQUENTIAL:
+            for (uint32_t i = 0; i < count; ++i) stream[i] = i % pages;
+            break;
+        case WORKLOAD_STRIDED: {
+            // 17 pages apart; odd stride so every page is visited per round
+            for (uint32_t i = 0; i < count; ++i) {
+                stream[i] = static_cast<uint32_t>((static_cast<uint64_t>(i) * 17) % pages);
+            }
+            break;
+        }
+        case WORKLOAD_UNIFORM:
+            for (uint32_t i = 0; i < count; ++i) stream[i] = random.below(pages);
+            break;
+        case WORKLOAD_ZIPF: {
+            // Rank r is drawn with weight 1 / r^skew from the inverted CDF;
+            // ranks are scattered over the pages by a random permutation
+            vector<double> cdf(pages);
+            double sum = 0;
+            for (uint32_t r = 0; r < pages; ++r) {
+                sum += 1.0 / pow(r + 1.0, skew);
+                cdf[r] = sum;
+            }
+            vector<uint32_t> permutation(pages);
+            for (uint32_t p = 0; p < pages; ++p) permutation[p] = p;
+            for (uint32_t p = pages - 1; p > 0; --p) {
+                swap(permutation[p], permutation[random.below(p + 1)]);
+            }
+            for (uint32_t i = 0; i < count; ++i) {
+                double u = random.unit() * sum;
+                size_t rank = lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin();
+                stream[i] = permutation[min<size_t>(rank, pages - 1)];
+            }
+            break;
+        }
+    }
+    return stream;
+}
+
+// Times a case; the counters are read outside the timed interval
+class Stopwatch {
+private:
+    uint32_t frames_start;
+    uint64_t heap_start;
+    chrono::steady_clock::time_point start;
+
+public:
+    Stopwatch()
+        : frames_start(MemoryManager::getInstance().getAllocatedPageCount()),
+          heap_start(heap_allocations), start(chrono::steady_clock::now()) {}
+
+    void finish(BenchResult& result) const {
+        result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        result.heap = heap_allocations - heap_start;
+        result.frames = MemoryManager::getInstance().getAllocatedPageCount() - frames_start;
+    }
+};
+
+static BenchResult newResult(const string& name, const string& workload, uint32_t tasks, uint64_t ops) {
+    BenchResult result;
+    result.name = name;
+    result.workload = workload;
+    result.tasks = tasks;
+    result.ops = ops;
+    result.seconds = 0;
+    result.frames = 0;
+    result.heap = 0;
+    result.hit_rate = -1;
+    return result;
+}
+
+// TLB::lookup, plus fill() on every miss (what the tasks do after a walk)
+static BenchResult benchTLB(WorkloadKind kind, const vector<uint32_t>& stream) {
+    BenchResult result = newResult("tlb", workloadName(kind), 1, stream.size());
+    TLB tlb;
+    uint32_t physical_page;
+
+    Stopwatch watch;
+    for (size_t i = 0; i < stream.size(); ++i) {
+        if (!tlb.lookup(stream[i], physical_page)) {
+            tlb.fill(stream[i], stream[i]);
+        }
+    }
+    watch.finish(result);
+
+    uint32_t hits, misses;
+    tlb.getStats(hits, misses);
+    result.hit_rate = 100.0 * hits / max<uint64_t>(1, hits + misses);
+    return result;
+}
+
+// The simulator's translation engines at the default page size (8KB)
+typedef TranslationEngine<SingleLevelTable, 13> SingleLevelTask;
+typedef TranslationEngine<MultiLevelTable, 13> MultiLevelTask;
+
+// Task::accessMemory over `tasks` tasks, taking the accesses round-robin.
+// The tasks stay alive until the end so their frames are never reused by
+// (or evicted into) another case.
+template <typename Task>
+static BenchResult benchTasks(const char* name, WorkloadKind kind, const vector<uint32_t>& stream,
+                              uint32_t tasks, vector<unique_ptr<PageOwner>>& keep) {
+    BenchResult result = newResult(name, workloadName(kind), tasks, stream.size());
+    uint32_t page_shift = PageSizeConfig::current().pageShift();
+
+    vector<Task*> owners;
+    for (uint32_t t = 0; t < tasks; ++t) {
+        Task* owner = new Task("B" + to_string(t), static_cast<uint32_t>(keep.size()));
+        keep.push_back(unique_ptr<PageOwner>(owner));
+        owners.push_back(owner);
+    }
+
+    Stopwatch watch;
+    for (size_t i = 0; i < stream.size(); ++i) {
+        owners[i % tasks]->accessMemory(DATA_BASE_ADDR + (stream[i] << page_shift));
+    }
+    watch.finish(result);
+    return result;
+}
+
+class NullOwner : public PageOwner {
+public:
+    NullOwner() : PageOwner(0) {}
+    void evictPage(uint64_t) override {}
+};
+
+// MemoryManager::allocatePage / deallocatePage, timed separately: rounds of
+// `batch` allocations followed by freeing them in shuffled order
+static void benchAllocator(uint32_t ops, uint64_t seed, vector<BenchResult>& results) {
+    const uint32_t batch = 1024;
+    uint32_t rounds = max<uint32_t>(1, ops / batch);
+    BenchResult allocate = newResult("allocatePage", "batch", 1, static_cast<uint64_t>(rounds) * batch);
+    BenchResult deallocate = newResult("deallocatePage", "shuffled", 1, allocate.ops);
+
+    MemoryManager& memory = MemoryManager::getInstance();
+    NullOwner owner;
+    vector<uint32_t> frames(batch);
+    Random random(seed);
+
+    for (uint32_t round = 0; round < rounds; ++round) {
+        BenchResult step = allocate;
+        Stopwatch allocate_watch;
+        for (uint32_t i = 0; i < batch; ++i) {
+            frames[i] = memory.allocatePage(&owner, i);
+        }
+        allocate_watch.finish(step);
+        allocate.seconds += step.seconds;
+        allocate.heap += step.heap;
+        allocate.frames += step.frames;
+
+        for (uint32_t i = batch - 1; i > 0; --i) {
+            swap(frames[i], frames[random.below(i + 1)]);
+        }
+
+        Stopwatch deallocate_watch;
+        for (uint32_t i = 0; i < batch; ++i) {
+            memory.deallocatePage(frames[i]);
+        }
+        deallocate_watch.finish(step);
+        deallocate.seconds += step.seconds;
+        deallocate.heap += step.heap;
+    }
+
+    results.push_back(allocate);
+    results.push_back(deallocate);
+}
+
+// parseTraceLine over an in-memory text trace (no file I/O)
+static BenchResult benchParse(const vector<uint32_t>& stream, uint32_t tasks) {
+    string text;
+    text.reserve(stream.size() * 28);
+    char line[64];
+    for (size_t i = 0; i < stream.size(); ++i) {
+        snprintf(line, sizeof(line), "T%u: 0x%x: %uKB\n", static_cast<unsigned>(i % tasks),
+                 DATA_BASE_ADDR + stream[i] * MIN_PAGE_SIZE_KB * 1024,
+                 static_cast<unsigned>(MIN_PAGE_SIZE_KB << (i % 4)));
+        text += line;
+    }
+
+    BenchResult result = newResult("parseTraceLine", "uniform", tasks, stream.size());
+    const char* cursor = text.data();
+    const char* end = cursor + text.size();
+    TraceRecord record;
+    uint64_t checksum = 0;
+
+    Stopwatch watch;
+    while (cursor < end) {
+        const char* newline = static_cast<const char*>(memchr(cursor, '\n', end - cursor));
+        if (newline == nullptr) newline = end;
+        if (parseTraceLine(cursor, newline, record) == TRACE_LINE_OK) {
+            checksum += record.logical_address;
+        }
+        cursor = newline + 1;
+    }
+    watch.finish(result);
+
+    if (checksum == 0) cerr << "parseTraceLine: no records parsed\n";
+    return result;
+}
+
+static void printTable(const vector<BenchResult>& results) {
+    printf("%-16s %-11s %5s %10s %10s %14s %9s %10s %8s\n", "benchmark", "workload", "tasks",
+           "ops", "ns/op", "accesses/s", "frames", "heap", "tlb hit");
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& r = results[i];
+        double ns = r.ops ? r.seconds * 1e9 / r.ops : 0;
+        double rate = r.seconds > 0 ? r.ops / r.seconds : 0;
+        printf("%-16s %-11s %5u %10llu %10.1f %14.0f %9llu %10llu", r.name.c_str(), r.workload.c_str(),
+               r.tasks, static_cast<unsigned long long>(r.ops), ns, rate,
+               static_cast<unsigned long long>(r.frames), static_cast<unsigned long long>(r.heap));
+        if (r.hit_rate >= 0) printf(" %7.2f%%", r.hit_rate);
+        printf("\n");
+    }
+}
+
+static bool writeJSON(const string& filename, const BenchOptions& options,
+                      const vector<BenchResult>& results) {
+    FILE* out = filename == "-" ? stdout : fopen(filename.c_str(), "w");
+    if (!out) {
+        cerr << "Could not open file for writing: " << filename << endl;
+        return false;
+    }
+
+    const TLBConfig& tlb = TLB::getDefaultConfig();
+    fprintf(out, "{\n  \"config\": {\"ops\": %u, \"working_set_pages\": %u, \"seed\": %llu, "
+                 "\"zipf_skew\": %g, \"page_size_kb\": %u, \"tlb_sets\": %u, \"tlb_ways\": %u, "
+                 "\"event_trace_level\": %d},\n",
+            options.ops, options.working_set, static_cast<unsigned long long>(options.seed),
+            options.zipf_skew, PageSizeConfig::current().page_size_kb, tlb.sets, tlb.ways,
+            EVENT_TRACE_LEVEL);
+    fprintf(out, "  \"results\": [\n");
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& r = results[i];
+        double ns = r.ops ? r.seconds * 1e9 / r.ops : 0;
+        double rate = r.seconds > 0 ? r.ops / r.seconds : 0;
+        fprintf(out, "    {\"name\": \"%s\", \"workload\": \"%s\", \"tasks\": %u, \"ops\": %llu, "
+                     "\"seconds\": %.6f, \"ns_per_op\": %.3f, \"accesses_per_sec\": %.0f, "
+                     "\"frames_allocated\": %llu, \"heap_allocations\": %llu",
+                r.name.c_str(), r.workload.c_str(), r.tasks, static_cast<unsigned long long>(r.ops),
+                r.seconds, ns, rate, static_cast<unsigned long long>(r.frames),
+                static_cast<unsigned long long>(r.heap));
+        if (r.hit_rate >= 0) fprintf(out, ", \"tlb_hit_rate\": %.4f", r.hit_rate);
+        fprintf(out, "}%s\n", i + 1 < results.size() ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+
+    bool ok = !ferror(out);
+    if (out != stdout) ok = (fclose(out) == 0) && ok;
+    if (!ok) cerr << "Error writing " << filename << endl;
+    return ok;
+}
+
+static void usage(const char* program) {
+    cerr << "Usage: " << program << " [options]\n"
+         << "  --ops N            accesses per benchmark case (default 1000000)\n"
+         << "  --working-set N    pages touched per task, 16..65536 (default 2048)\n"
+         << "  --tasks N[,N...]   task counts for the task benchmarks (default 1,4,16)\n"
+         << "  --seed N           random seed for the workloads (default 1)\n"
+         << "  --zipf S           Zipf skew (default 0.99)\n"
+         << "  --json FILE        also write the results as JSON (\"-\" = stdout)\n";
+}
+
+static bool parseNumber(const char* text, uint64_t& value) {
+    char* end;
+    value = strtoull(text, &end, 10);
+    return *text != '\0' && *end == '\0';
+}
+
+static bool parseArguments(int argc, char* argv[], BenchOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--help" || i + 1 >= argc) {
+            usage(argv[0]);
+            return false;
+        }
+        const char* value = argv[++i];
+        uint64_t number;
+
+        if (arg == "--ops" && parseNumber(value, number) && number > 0 && number <= 0xFFFFFFFFu) {
+            options.ops = static_cast<uint32_t>(number);
+        } else if (arg == "--working-set" && parseNumber(value, number) && number >= 16 && number <= 65536) {
+            options.working_set = static_cast<uint32_t>(number);
+        } else if (arg == "--seed" && parseNumber(value, number)) {
+            options.seed = number;
+        } else if (arg == "--zipf" && atof(value) > 0) {
+            options.zipf_skew = atof(value);
+        } else if (arg == "--json") {
+            options.json_file = value;
+        } else if (arg == "--tasks") {
+            options.tasks.clear();
+            string list = value;
+            size_t pos = 0;
+            while (pos <= list.size()) {
+                size_t comma = list.find(',', pos);
+                if (comma == string::npos) comma = list.size();
+                if (!parseNumber(list.substr(pos, comma - pos).c_str(), number) || number == 0 || number > 1024) {
+                    cerr << "Invalid task count list: " << value << endl;
+                    return false;
+                }
+                options.tasks.push_back(static_cast<uint32_t>(number));
+                pos = comma + 1;
+            }
+        } else {
+            cerr << "Invalid option or value: " << arg << " " << value << endl;
+            usage(argv[0]);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+    if (!parseArguments(argc, argv, options)) {
+        return 1;
+    }
+
+    // Enough frames that no case has to evict (frames of finished cases stay
+    // mapped); a bigger working set than that makes later cases evict
+    const PageSizeConfig& pages = PageSizeConfig::current();
+    MemoryManager& memory = MemoryManager::getInstance();
+    memory.configureMemory(static_cast<uint64_t>(1) << 20 << pages.pageShift(), pages.page_size_kb);
+
+    const WorkloadKind kinds[] = {WORKLOAD_SEQUENTIAL, WORKLOAD_STRIDED, WORKLOAD_UNIFORM, WORKLOAD_ZIPF};
+    vector<BenchResult> results;
+    vector<unique_ptr<PageOwner>> keep;
+
+    for (size_t k = 0; k < sizeof(kinds) / sizeof(kinds[0]); ++k) {
+        vector<uint32_t> stream = makePageStream(kinds[k], options.working_set, options.ops,
+                                                 options.seed, options.zipf_skew);
+        results.push_back(benchTLB(kinds[k], stream));
+
+        // Each task gets its own copy of the working set
+        for (size_t t = 0; t < options.tasks.size(); ++t) {
+            results.push_back(benchTasks<SingleLevelTask>("task", kinds[k], stream, options.tasks[t], keep));
+        }
+        for (size_t t = 0; t < options.tasks.size(); ++t) {
+            results.push_back(benchTasks<MultiLevelTask>("taskmulti", kinds[k], stream, options.tasks[t], keep));
+        }
+    }
+
+    benchAllocator(options.ops, options.seed, results);
+    results.push_back(benchParse(makePageStream(WORKLOAD_UNIFORM, options.working_set, options.ops,
+                                                options.seed, options.zipf_skew),
+                                 options.tasks.back()));
+
+    printTable(results);
+    if (!options.json_file.empty() && !writeJSON(options.json_file, options, results)) {
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,148 @@
+// Turns a binary event log (--events) back into the simulator's
+// human-readable per-access lines.
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "event_trace.h"
+
+using namespace std;
+
+static bool bySequence(const EventRecord& a, const EventRecord& b) {
+    return a.sequence < b.sequence;
+}
+
+static void printSingle(const EventRecord& r, const string& task_id) {
+    switch (r.type) {
+        case EVENT_TLB_HIT:
+            cout << "TLB hit for task " << task_id << ": Logical page " << r.virtual_page
+                 << " -> Physical page " << r.physical_page << "\n";
+            break;
+        case EVENT_PAGE_HIT:
+            cout << "Page hit for task " << task_id << ": Page number " << r.virtual_page << "\n";
+            break;
+        case EVENT_PAGE_MISS:
+            cout << "Page miss for task " << task_id << ": Page number " << r.virtual_page << "\n";
+            break;
+        case EVENT_ALLOCATE:
+            cout << "Allocated physical page number " << r.physical_page
+                 << " for logical page number " << r.virtual_page << "\n";
+            break;
+        case EVENT_DEALLOCATE:
+            cout << task_id << " - Deallocated virtual page " << r.virtual_page
+                 << " (physical page " << r.physical_page << ")\n";
+            break;
+        case EVENT_COW_FAULT:
+            cout << "COW fault for task " << task_id << ": Logical page " << r.virtual_page
+                 << " -> Physical page " << r.physical_page << "\n";
+            break;
+    }
+}
+
+static void printMulti(const EventRecord& r, const string& task_id, uint32_t table_bits) {
+    uint64_t dir = r.virtual_page >> table_bits;
+    uint32_t table = static_cast<uint32_t>(r.virtual_page) & ((1u << table_bits) - 1);
+    switch (r.type) {
+        case EVENT_TLB_HIT:
+            cout << "TLB hit for task " << task_id << ": Virtual page " << r.virtual_page
+                 << " -> Physical page " << r.physical_page << "\n";
+            break;
+        case EVENT_PAGE_HIT:
+            cout << "Page hit for task " << task_id << ": Directory index " << dir
+                 << ", Table index " << table << "\n";
+            break;
+        case EVENT_PAGE_MISS:
+            cout << "Page miss for task " << task_id << ": Directory index " << dir
+                 << ", Table index " << table << "\n";
+            break;
+        case EVENT_ALLOCATE:
+            cout << "Allocated physical page number " << r.physical_page
+                 << " for directory index " << dir << ", table index " << table << "\n";
+            break;
+        case EVENT_DEALLOCATE:
+            cout << task_id << " - Deallocated virtual page (dir: " << dir
+                 << ", table: " << table << ", physical: " << r.physical_page << ")\n";
+            break;
+        case EVENT_COW_FAULT:
+            cout << "COW fault for task " << task_id << ": Directory index " << dir
+                 << ", Table index " << table << " -> Physical page " << r.physical_page << "\n";
+            break;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        cerr << "Usage: " << argv[0] << " <event_log>\n";
+        return 1;
+    }
+
+    FILE* file = fopen(argv[1], "rb");
+    if (!file) {
+        cerr << "Error opening file: " << argv[1] << endl;
+        return 1;
+    }
+
+    EventLogHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != EVENT_LOG_MAGIC ||
+        header.version != EVENT_LOG_VERSION || header.record_size != sizeof(EventRecord) ||
+        header.page_size_kb == 0) {
+        cerr << "Not an event log (or unsupported version): " << argv[1] << endl;
+        fclose(file);
+        return 1;
+    }
+
+    vector<string> task_names;
+    vector<EventRecord> records;
+    EventBlockHeader block;
+    while (fread(&block, sizeof(block), 1, file) == 1) {
+        vector<char> payload(block.length);
+        if (block.length > 0 && fread(&payload[0], 1, block.length, file) != block.length) {
+            cerr << "Truncated event log" << endl;
+            break;
+        }
+
+        if (block.type == EVENT_BLOCK_TASK && block.length >= sizeof(uint32_t)) {
+            uint32_t index;
+            memcpy(&index, &payload[0], sizeof(index));
+            if (index >= task_names.size()) task_names.resize(index + 1);
+            task_names[index].assign(payload.begin() + sizeof(index), payload.end());
+        } else if (block.type == EVENT_BLOCK_RECORDS) {
+            size_t count = block.length / sizeof(EventRecord);
+            size_t first = records.size();
+            records.resize(first + count);
+            memcpy(&records[first], &payload[0], count * sizeof(EventRecord));
+        }
+    }
+    fclose(file);
+
+    // A directory entry spans LARGE_PAGE_SHIFT bits of address; the page
+    // table index is what is left above the page offset
+    uint32_t page_shift = static_cast<uint32_t>(__builtin_ctz(header.page_size_kb * 1024));
+    uint32_t table_bits = LARGE_PAGE_SHIFT - page_shift;
+
+    // Rings are drained task by task; restore the global order
+    stable_sort(records.begin(), records.end(), bySequence);
+
+    for (size_t i = 0; i < records.size(); ++i) {
+        const EventRecord& r = records[i];
+        const string& task_id = r.task < task_names.size() ? task_names[r.task] : string("?");
+        if (r.type == EVENT_EVICT) {
+            cout << "Replaced page " << r.physical_page << " (task " << task_id
+                 << ", virtual page " << r.virtual_page << ")\n";
+            continue;
+        }
+        if (r.type == EVENT_SWAP_OUT || r.type == EVENT_SWAP_IN) {
+            cout << (r.type == EVENT_SWAP_OUT ? "Swapped out" : "Swapped in") << " virtual page " << r.virtual_page
+                 << " (task " << task_id << ", swap slot " << r.physical_page << ")\n";
+            continue;
+        }
+        if (header.mode == EVENT_LOG_MULTI) {
+            printMulti(r, task_id, table_bits);
+        } else {
+            printSingle(r, task_id);
+        }
+    }
+    return 0;
+}
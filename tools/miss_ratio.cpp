@@ -0,0 +1,353 @@
+// One-pass capacity study of a trace: the LRU miss-ratio curve for every
+// TLB size (or resident-page budget) and for page-table pages, per task and
+// for all tasks together, and the working-set size over time. Replaces one
+// replay per candidate TLB size.
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "config.h"
+#include "page_size.h"
+#include "reuse_distance.h"
+#include "trace_reader.h"
+
+using namespace std;
+
+// Keys of one page table and of its pages, like a radix page table
+struct TableKeys {
+    uint32_t key;                 // task table key, UINT32_MAX until first use
+    vector<uint32_t> page_keys;   // task page key of each page, UINT32_MAX until first use
+
+    TableKeys() : key(UINT32_MAX) {}
+};
+
+// Distances within one task: what a private TLB of each size would miss
+struct TaskStreams {
+    StackDistance pages;
+    StackDistance tables;
+    MissRatioCurve page_curve;
+    MissRatioCurve table_curve;
+    unordered_map<uint64_t, TableKeys> directory;   // by page-table number
+    vector<uint32_t> global_page;    // task page key -> global page key
+    vector<uint32_t> global_table;
+    uint64_t last_window;            // window of the task's latest access
+
+    TaskStreams() : last_window(UINT64_MAX) {}
+};
+
+// Working set of one window of records
+struct WindowSample {
+    uint64_t records;     // at the end of the window
+    uint64_t accesses;    // page accesses in the window
+    uint32_t pages;       // distinct (task, page) in the window
+    uint32_t tables;      // distinct (task, page table)
+    uint32_t tasks;       // tasks that accessed memory
+    uint32_t footprint;   // distinct pages since the start of the trace
+};
+
+class Analysis {
+private:
+    uint32_t page_shift;
+    uint32_t table_shift;    // page number -> page-table number
+    uint64_t interval;
+
+    vector<unique_ptr<TaskStreams>> tasks;   // by trace task index
+    StackDistance pages;                     // all tasks, keys (task, page)
+    StackDistance tables;
+    MissRatioCurve page_curve;
+    MissRatioCurve table_curve;
+    vector<uint64_t> page_window;            // global key -> window of its latest access
+    vector<uint64_t> table_window;
+
+    uint64_t records;
+    uint64_t window;
+    WindowSample current;
+    vector<WindowSample> samples;
+
+    TaskStreams& task(uint32_t index) {
+        if (index >= tasks.size()) tasks.resize(index + 1);
+        if (!tasks[index]) tasks[index].reset(new TaskStreams());
+        return *tasks[index];
+    }
+
+    // Task key of a page or table in `slot`; a new one also gets the next
+    // global key
+    static uint32_t intern(uint32_t& slot, vector<uint32_t>& global, vector<uint64_t>& windows) {
+        if (slot == UINT32_MAX) {
+            slot = static_cast<uint32_t>(global.size());
+            global.push_back(static_cast<uint32_t>(windows.size()));
+            windows.push_back(UINT64_MAX);
+        }
+        return slot;
+    }
+
+    void touch(vector<uint64_t>& windows, uint32_t key, uint32_t& distinct) {
+        if (windows[key] != window) {
+            windows[key] = window;
+            distinct++;
+        }
+    }
+
+    void endWindow() {
+        current.records = records;
+        current.footprint = static_cast<uint32_t>(page_window.size());
+        samples.push_back(current);
+        current = WindowSample();
+        window++;
+    }
+
+public:
+    Analysis(uint32_t page_size_shift, uint64_t window_records)
+        : page_shift(page_size_shift), table_shift(LARGE_PAGE_SHIFT - page_size_shift),
+          interval(window_records), records(0), window(0), current() {}
+
+    void access(uint32_t task_index, uint64_t start, uint32_t length) {
+        TaskStreams& streams = task(task_index);
+        if (streams.last_window != window) {
+            streams.last_window = window;
+            current.tasks++;
+        }
+
+        uint32_t page_size = 1u << page_shift;
+        uint32_t num_pages = (length + page_size - 1) / page_size;
+        for (uint32_t k = 0; k < num_pages; ++k) {
+            uint64_t page = (start + static_cast<uint64_t>(k) * page_size) >> page_shift;
+            TableKeys& table = streams.directory[page >> table_shift];
+            if (table.page_keys.empty()) table.page_keys.assign(1u << table_shift, UINT32_MAX);
+
+            uint32_t page_key = intern(table.page_keys[page & ((1u << table_shift) - 1)], streams.global_page,
+                                       page_window);
+            uint32_t table_key = intern(table.key, streams.global_table, table_window);
+            uint32_t global_page = streams.global_page[page_key];
+            uint32_t global_table = streams.global_table[table_key];
+
+            streams.page_curve.record(streams.pages.access(page_key));
+            streams.table_curve.record(streams.tables.access(table_key));
+            page_curve.record(pages.access(global_page));
+            table_curve.record(tables.access(global_table));
+
+            touch(page_window, global_page, current.pages);
+            touch(table_window, global_table, current.tables);
+        }
+        current.accesses += num_pages;
+    }
+
+    // Called after each record
+    void endRecord() {
+        records++;
+        if (interval != 0 && records % interval == 0) endWindow();
+    }
+
+    void finish() {
+        if (interval != 0 && records % interval != 0) endWindow();
+    }
+
+    // The curves of all tasks, each with its own cache
+    MissRatioCurve privatePages() const {
+        MissRatioCurve sum;
+        for (size_t i = 0; i < tasks.size(); ++i) {
+            if (tasks[i]) sum.add(tasks[i]->page_curve);
+        }
+        return sum;
+    }
+    MissRatioCurve privateTables() const {
+        MissRatioCurve sum;
+        for (size_t i = 0; i < tasks.size(); ++i) {
+            if (tasks[i]) sum.add(tasks[i]->table_curve);
+        }
+        return sum;
+    }
+
+    const MissRatioCurve& sharedPages() const { return page_curve; }
+    const MissRatioCurve& sharedTables() const { return table_curve; }
+    const TaskStreams* getTask(uint32_t index) const {
+        return index < tasks.size() ? tasks[index].get() : nullptr;
+    }
+    uint64_t getRecords() const { return records; }
+    uint32_t getPageCount() const { return static_cast<uint32_t>(page_window.size()); }
+    uint32_t getTableCount() const { return static_cast<uint32_t>(table_window.size()); }
+    const vector<WindowSample>& getSamples() const { return samples; }
+};
+
+static double ratio(uint64_t misses, uint64_t accesses) {
+    return accesses > 0 ? static_cast<double>(misses) / accesses : 0.0;
+}
+
+static void printCurves(const Analysis& analysis, uint32_t page_size_kb) {
+    MissRatioCurve private_pages = analysis.privatePages();
+    MissRatioCurve private_tables = analysis.privateTables();
+    const MissRatioCurve& shared_pages = analysis.sharedPages();
+    const MissRatioCurve& shared_tables = analysis.sharedTables();
+    uint64_t accesses = shared_pages.getAccesses();
+
+    printf("Miss-ratio curves: fully associative LRU, %uKB pages\n", page_size_kb);
+    printf("Records: %llu  Page accesses: %llu  Pages: %u  Page tables: %u\n",
+           static_cast<unsigned long long>(analysis.getRecords()), static_cast<unsigned long long>(accesses),
+           analysis.getPageCount(), analysis.getTableCount());
+    printf("\n%10s %14s %14s %14s %14s\n", "Entries", "Per-task TLB", "Shared TLB", "Per-task PT",
+           "Shared PT");
+
+    // Powers of two up to the size past which only cold misses are left
+    uint32_t largest = shared_pages.getMaxUsefulSize();
+    if (private_pages.getMaxUsefulSize() > largest) largest = private_pages.getMaxUsefulSize();
+    vector<uint32_t> sizes;
+    for (uint64_t size = 1; size < largest; size *= 2) {
+        sizes.push_back(static_cast<uint32_t>(size));
+    }
+    sizes.push_back(largest > 0 ? largest : 1);
+
+    vector<uint64_t> pp = private_pages.misses(sizes);
+    vector<uint64_t> sp = shared_pages.misses(sizes);
+    vector<uint64_t> pt = private_tables.misses(sizes);
+    vector<uint64_t> st = shared_tables.misses(sizes);
+    for (size_t i = 0; i < sizes.size(); ++i) {
+        printf("%10u %13.4f%% %13.4f%% %13.4f%% %13.4f%%\n", sizes[i], 100.0 * ratio(pp[i], accesses),
+               100.0 * ratio(sp[i], accesses), 100.0 * ratio(pt[i], accesses), 100.0 * ratio(st[i], accesses));
+    }
+    printf("Cold misses: %llu pages, %llu page tables (per task)\n",
+           static_cast<unsigned long long>(private_pages.getColdMisses()),
+           static_cast<unsigned long long>(private_tables.getColdMisses()));
+
+    const vector<WindowSample>& samples = analysis.getSamples();
+    if (!samples.empty()) {
+        uint64_t sum = 0;
+        uint32_t peak = 0;
+        for (size_t i = 0; i < samples.size(); ++i) {
+            sum += samples[i].pages;
+            if (samples[i].pages > peak) peak = samples[i].pages;
+        }
+        printf("Working set over %zu windows: average %.1f pages, peak %u pages\n", samples.size(),
+               static_cast<double>(sum) / samples.size(), peak);
+    }
+}
+
+// One CSV row per (scope, size); scopes are "per-task" (every task with its
+// own cache), "shared" (one cache for all tasks) and each task ID
+static void writeCurveRows(FILE* out, const string& scope, const MissRatioCurve& page_curve,
+                           const MissRatioCurve& table_curve) {
+    uint32_t largest = page_curve.getMaxUsefulSize();
+    if (table_curve.getMaxUsefulSize() > largest) largest = table_curve.getMaxUsefulSize();
+    vector<uint32_t> sizes = missRatioSizes(largest > 0 ? largest : 1);
+    vector<uint64_t> page_misses = page_curve.misses(sizes);
+    vector<uint64_t> table_misses = table_curve.misses(sizes);
+    uint64_t accesses = page_curve.getAccesses();
+    for (size_t i = 0; i < sizes.size(); ++i) {
+        fprintf(out, "%s,%u,%llu,%llu,%.6f,%llu,%.6f\n", scope.c_str(), sizes[i],
+                static_cast<unsigned long long>(accesses), static_cast<unsigned long long>(page_misses[i]),
+                ratio(page_misses[i], accesses), static_cast<unsigned long long>(table_misses[i]),
+                ratio(table_misses[i], accesses));
+    }
+}
+
+static FILE* openOutput(const string& filename) {
+    FILE* out = filename == "-" ? stdout : fopen(filename.c_str(), "w");
+    if (!out) cerr << "Could not open file for writing: " << filename << endl;
+    return out;
+}
+
+static bool closeOutput(FILE* out, const string& filename) {
+    bool ok = !ferror(out);
+    if (out != stdout) ok = (fclose(out) == 0) && ok;
+    if (!ok) cerr << "Error writing " << filename << endl;
+    return ok;
+}
+
+static bool writeCurves(const Analysis& analysis, const TraceReader& reader, const string& filename) {
+    FILE* out = openOutput(filename);
+    if (!out) return false;
+    fprintf(out, "scope,entries,accesses,page_misses,page_miss_ratio,table_misses,table_miss_ratio\n");
+    writeCurveRows(out, "per-task", analysis.privatePages(), analysis.privateTables());
+    writeCurveRows(out, "shared", analysis.sharedPages(), analysis.sharedTables());
+    for (uint32_t i = 0; i < reader.getTaskCount(); ++i) {
+        const TaskStreams* streams = analysis.getTask(i);
+        if (streams != nullptr && streams->page_curve.getAccesses() > 0) {
+            writeCurveRows(out, reader.getTaskName(i), streams->page_curve, streams->table_curve);
+        }
+    }
+    return closeOutput(out, filename);
+}
+
+static bool writeSeries(const Analysis& analysis, const string& filename) {
+    FILE* out = openOutput(filename);
+    if (!out) return false;
+    fprintf(out, "records,accesses,working_set_pages,working_set_tables,active_tasks,footprint_pages\n");
+    const vector<WindowSample>& samples = analysis.getSamples();
+    for (size_t i = 0; i < samples.size(); ++i) {
+        fprintf(out, "%llu,%llu,%u,%u,%u,%u\n", static_cast<unsigned long long>(samples[i].records),
+                static_cast<unsigned long long>(samples[i].accesses), samples[i].pages, samples[i].tables,
+                samples[i].tasks, samples[i].footprint);
+    }
+    return closeOutput(out, filename);
+}
+
+static void usage(const char* program) {
+    cerr << "Usage: " << program << " [options] <trace>\n"
+         << "  Prints the LRU miss-ratio curve of every TLB size in one pass over the trace.\n"
+         << "  --page-size KB     base page size, power of two 4-64 (default: " << MIN_PAGE_SIZE_KB << ")\n"
+         << "  --interval N       working-set window, in records (default: 100000; 0 = none)\n"
+         << "  --csv FILE         write the curves (per task, all tasks) as CSV ('-' = stdout)\n"
+         << "  --series FILE      write the working set of every window as CSV ('-' = stdout)\n";
+}
+
+int main(int argc, char* argv[]) {
+    PageSizeConfig pages;
+    uint64_t interval = 100000;
+    string curve_file;
+    string series_file;
+    string trace_file;
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--page-size" && has_value) {
+            pages.page_size_kb = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--interval" && has_value) {
+            interval = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--csv" && has_value) {
+            curve_file = argv[++i];
+        } else if (arg == "--series" && has_value) {
+            series_file = argv[++i];
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            usage(argv[0]);
+            return 1;
+        } else if (trace_file.empty()) {
+            trace_file = arg;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (trace_file.empty()) {
+        usage(argv[0]);
+        return 1;
+    }
+    const char* problem = pages.validate();
+    if (problem != nullptr) {
+        cerr << "Invalid --page-size: " << problem << endl;
+        return 1;
+    }
+
+    TraceReader reader;
+    if (!reader.open(trace_file)) return 1;
+
+    // Forked tasks start with empty streams, like a new TLB
+    Analysis analysis(pages.pageShift(), interval);
+    TraceRecord record;
+    while (reader.next(record)) {
+        if (record.kind == TRACE_ACCESS) {
+            analysis.access(record.task_index, record.logical_address, record.size_in_bytes);
+        }
+        analysis.endRecord();
+    }
+    analysis.finish();
+
+    printCurves(analysis, pages.page_size_kb);
+    bool ok = true;
+    if (!curve_file.empty()) ok = writeCurves(analysis, reader, curve_file) && ok;
+    if (!series_file.empty()) ok = writeSeries(analysis, series_file) && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,108 @@
+// Converts traces between the text format and the binary format
+// described in trace_format.h (direction is picked from the input).
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "trace_format.h"
+#include "trace_reader.h"
+
+using namespace std;
+
+static int toBinary(TraceReader& reader, const string& output) {
+    // Pass 1: the reader interns the task IDs in order of first appearance
+    // (and reports bad lines)
+    TraceRecord record;
+    while (reader.next(record)) {
+    }
+    vector<string> task_ids;
+    for (uint32_t i = 0; i < reader.getTaskCount(); ++i) {
+        task_ids.push_back(reader.getTaskName(i));
+    }
+
+    BinaryTraceWriter writer;
+    if (!writer.open(output, task_ids)) return 1;
+
+    // Pass 2: records
+    reader.setReportErrors(false);
+    reader.rewind();
+    uint64_t count = 0;
+    while (reader.next(record)) {
+        if (record.kind == TRACE_FORK) {
+            writer.appendFork(record.task_index, record.parent_index);
+        } else {
+            writer.append(record.task_index, record.logical_address, record.size_in_bytes);
+        }
+        count++;
+    }
+    if (!writer.close()) {
+        cerr << "Error writing " << output << endl;
+        return 1;
+    }
+    cerr << "Wrote " << count << " records for " << task_ids.size() << " tasks to " << output << endl;
+    return 0;
+}
+
+static int toText(TraceReader& reader, const string& output) {
+    FILE* out = output == "-" ? stdout : fopen(output.c_str(), "w");
+    if (!out) {
+        cerr << "Could not open file for writing: " << output << endl;
+        return 1;
+    }
+
+    TraceRecord record;
+    uint64_t count = 0;
+    while (reader.next(record)) {
+        fwrite(record.task_id, 1, record.task_id_length, out);
+        if (record.kind == TRACE_FORK) {
+            fputs(": fork ", out);
+            fwrite(record.parent_id, 1, record.parent_id_length, out);
+            fputc('\n', out);
+        } else {
+            fprintf(out, ": 0x%llx: %uKB\n", static_cast<unsigned long long>(record.logical_address),
+                    record.size_in_bytes / 1024);
+        }
+        count++;
+    }
+
+    bool ok = !ferror(out);
+    if (out != stdout) ok = (fclose(out) == 0) && ok;
+    if (!ok) {
+        cerr << "Error writing " << output << endl;
+        return 1;
+    }
+    cerr << "Wrote " << count << " lines to " << output << endl;
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    int mode = 0;   // 0: opposite of the input, 1: to binary, 2: to text
+    vector<string> files;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--to-binary") == 0) {
+            mode = 1;
+        } else if (strcmp(argv[i], "--to-text") == 0) {
+            mode = 2;
+        } else {
+            files.push_back(argv[i]);
+        }
+    }
+    if (files.size() != 2) {
+        cerr << "Usage: " << argv[0] << " [--to-binary|--to-text] <input> <output>\n"
+             << "  Converts a text trace to binary or a binary trace to text\n"
+             << "  (input '-' reads a binary trace from stdin; output '-' writes to stdout).\n";
+        return 1;
+    }
+
+    TraceReader reader;
+    if (!reader.open(files[0])) return 1;
+    if (mode == 0) mode = reader.isBinary() ? 2 : 1;
+    if (mode == 1 && reader.isStreaming()) {
+        // The task table comes first in the output, so the input is read twice
+        cerr << "Converting to binary needs a trace file, not a stream" << endl;
+        return 1;
+    }
+
+    return mode == 1 ? toBinary(reader, files[1]) : toText(reader, files[1]);
+}